@@ -0,0 +1,180 @@
+// Comparison benchmark.
+//
+// Part one times compareValues on its own: for each operand type pair it
+// runs all six operators over a ring of prepared values and reports ns per
+// comparison, next to the old approach of comparing printed forms.
+//
+// Part two runs comparison-heavy .emo loops (every operator, for each type
+// pair) on the tree walker and on the VM and reports the run time of each.
+// Both engines must print the same result.
+//
+// usage: emojilang_compare_bench [iterations = 200000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BytecodeCompiler.hpp"
+#include "EmojiInterpreter.hpp"
+#include "EmojiTransformer.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "VirtualMachine.hpp"
+
+namespace {
+
+const CompareOp ALL_OPS[] = {
+    CompareOp::EQ, CompareOp::NE, CompareOp::LT, CompareOp::LE, CompareOp::GT, CompareOp::GE
+};
+
+struct TypePair {
+    const char* name;
+    std::vector<Value> left;
+    std::vector<Value> right;
+};
+
+std::vector<TypePair> buildPairs() {
+    const size_t count = 64;
+    std::vector<TypePair> pairs = {
+        {"int/int", {}, {}},
+        {"int/double", {}, {}},
+        {"double/double", {}, {}},
+        {"bool/bool", {}, {}},
+        {"string/string", {}, {}},
+        {"int/string", {}, {}},
+    };
+    for (size_t i = 0; i < count; ++i) {
+        int a = static_cast<int>(i * 7 % 13);
+        int b = static_cast<int>(i * 5 % 11);
+        std::string word = "w" + std::to_string(a);
+        pairs[0].left.push_back(a);
+        pairs[0].right.push_back(b);
+        pairs[1].left.push_back(a);
+        pairs[1].right.push_back(b + 0.5);
+        pairs[2].left.push_back(a * 0.25);
+        pairs[2].right.push_back(b * 0.5);
+        pairs[3].left.push_back(a % 2 == 0);
+        pairs[3].right.push_back(b % 3 == 0);
+        pairs[4].left.push_back(word);
+        pairs[4].right.push_back("w" + std::to_string(b));
+        pairs[5].left.push_back(a);
+        pairs[5].right.push_back(std::to_string(b));
+    }
+    return pairs;
+}
+
+template <typename Compare>
+double nsPerComparison(const TypePair& pair, size_t rounds, Compare compare, size_t& hits) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (CompareOp op : ALL_OPS) {
+            for (size_t i = 0; i < pair.left.size(); ++i) {
+                hits += compare(op, pair.left[i], pair.right[i]);
+            }
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(rounds * 6 * pair.left.size());
+}
+
+// What equality used to cost: format both sides and compare the text
+bool comparePrinted(CompareOp op, const Value& left, const Value& right) {
+    bool equal = left.toString() == right.toString();
+    return op == CompareOp::NE ? !equal : equal;
+}
+
+// Loop of `iterations` rounds running all six operators on `left` and
+// `right`, which the setup statements define and the update keeps changing.
+std::string comparisonLoop(const std::string& setup, const std::string& update, int iterations) {
+    const char* ops[] = {"😌😌", "❗😌", "😭", "😭😌", "😁", "😁😌"};
+    std::string source = setup + "\n📢 hits 😌 0\n📢 i 😌 0\n💿👉i 😭 " + std::to_string(iterations) + "👈🍽\n";
+    for (const char* op : ops) {
+        source += "    🚩👉left " + std::string(op) + " right👈🍽 hits 😌 hits ➕ 1 🥂\n";
+    }
+    source += "    " + update + "\n    i 😌 i ➕ 1\n🥂\n🖨👉hits👈\n";
+    return source;
+}
+
+Tree prepare(const std::string& source) {
+    Tree tree = Parser().parse(source);
+    EmojiTransformer().visit(tree);
+    Resolver().resolve(tree);
+    return tree;
+}
+
+template <typename Run>
+double timeRun(Run run, std::string& output) {
+    double best = 1e100;
+    for (int i = 0; i < 3; ++i) {
+        std::ostringstream out;
+        auto start = std::chrono::steady_clock::now();
+        run(out);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        output = out.str();
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 200000;
+
+    std::cout << "compareValues, ns per comparison (all six operators)" << std::endl;
+    size_t hits = 0;
+    for (const TypePair& pair : buildPairs()) {
+        double typed = nsPerComparison(pair, 20000, compareValues, hits);
+        double printed = nsPerComparison(pair, 2000, comparePrinted, hits);
+        std::cout << std::setw(15) << pair.name << ": " << std::fixed << std::setprecision(2) << std::setw(7)
+                  << typed << " ns  (printed form: " << std::setw(7) << printed << " ns)" << std::endl;
+    }
+
+    struct Loop {
+        const char* name;
+        std::string setup;
+        std::string update;
+    };
+    const Loop loops[] = {
+        {"int/int", "📢 left 😌 0\n📢 right 😌 3", "left 😌 i 📎 7"},
+        {"int/double", "📢 left 😌 0\n📢 right 😌 2.5", "left 😌 i 📎 5"},
+        {"double/double", "📢 left 😌 0.5\n📢 right 😌 1.5", "left 😌 i ➗ 4"},
+        {"bool/bool", "📢 left 😌 ✔\n📢 right 😌 ❌", "left 😌 right\n    right 😌 i 📎 2 😌😌 0"},
+        {"string/string", "📢 left 😌 \"apple\"\n📢 right 😌 \"banana\"\n📢 other 😌 \"cherry\"",
+         "other 😌 left\n    left 😌 right\n    right 😌 other"},
+    };
+
+    std::cout << "\ncomparison loops, " << iterations << " iterations x 6 comparisons" << std::endl;
+    for (const Loop& loop : loops) {
+        Tree tree = prepare(comparisonLoop(loop.setup, loop.update, iterations));
+        BytecodeProgram program = BytecodeCompiler().compile(tree);
+
+        std::string walkerOutput;
+        double walker = timeRun([&](std::ostream& out) {
+            std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+            EmojiInterpreter(&tree).start();
+            std::cout.rdbuf(saved);
+        }, walkerOutput);
+
+        std::string vmOutput;
+        double vm = timeRun([&](std::ostream& out) {
+            VirtualMachine(out).run(program);
+        }, vmOutput);
+
+        if (walkerOutput != vmOutput) {
+            std::cerr << "ERROR: " << loop.name << " engines disagree: " << walkerOutput << " vs " << vmOutput << std::endl;
+            return 1;
+        }
+        std::cout << std::setw(15) << loop.name << ": tree " << std::setprecision(1) << std::setw(7) << walker * 1e3
+                  << " ms, vm " << std::setw(6) << vm * 1e3 << " ms  (" << std::setprecision(2) << walker / vm
+                  << "x)" << std::endl;
+    }
+
+    // Keeps the kernel loops from being optimized away
+    return hits == 0 ? 1 : 0;
+}
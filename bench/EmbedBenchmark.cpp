@@ -0,0 +1,80 @@
+// Embedding benchmark: one program served many times through libemojilang.
+//
+// The program is run `runs` times three ways: compiled afresh for every run
+// (what a host that starts the interpreter per request pays, minus the
+// process), compiled once and run on one thread, and compiled once with the
+// runs spread over `threads` threads sharing the same EmojiProgram. Every
+// run must print the same output.
+//
+// usage: emojilang_embed_bench [file = tests/firstPrimes.emo] [threads = cores] [runs = 2000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EmojiProgram.hpp"
+#include "SourceBuffer.hpp"
+
+namespace {
+
+template <typename Run>
+double timeRuns(size_t threads, int runs, Run run) {
+    std::atomic<int> next(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            while (next.fetch_add(1) < runs) {
+                run();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "tests/firstPrimes.emo";
+    size_t threads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    int runs = argc > 3 ? std::stoi(argv[3]) : 2000;
+
+    std::string source(SourceBuffer::fromFile(path).text());
+    EmojiProgram program = EmojiProgram::compile(source);
+    std::string expected = program.run();
+    std::atomic<bool> mismatch(false);
+    auto check = [&](const std::string& output) {
+        if (output != expected) {
+            mismatch = true;
+        }
+    };
+
+    double fresh = timeRuns(1, runs, [&] { check(EmojiProgram::compile(source).run()); });
+    double single = timeRuns(1, runs, [&] { check(program.run()); });
+    double shared = timeRuns(threads, runs, [&] { check(program.run()); });
+    if (mismatch) {
+        std::cerr << "ERROR: runs printed different output" << std::endl;
+        return 1;
+    }
+
+    std::cout << path << ", " << runs << " runs" << std::endl;
+    auto report = [&](const char* label, double seconds) {
+        std::cout << std::setw(36) << label << ": " << std::fixed << std::setprecision(2) << std::setw(8)
+                  << seconds * 1e3 << " ms, " << std::setprecision(0) << std::setw(9) << runs / seconds
+                  << " runs/s" << std::endl;
+    };
+    report("compile + run each time", fresh);
+    report("compiled once, 1 thread", single);
+    std::string label = "compiled once, " + std::to_string(threads) + " threads";
+    report(label.c_str(), shared);
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Engine benchmark: the tree walker against the closure compiler.
+//
+// Every .emo file in the directory is parsed, transformed, resolved and
+// optimized once, then run `runs` times on the tree walker (without the
+// JIT, so EmojiInterpreter::visit does all the work) and `runs` times as a
+// compiled closure program. The best of three such batches is reported per
+// file, with the closure compile time on its own. Both engines must print
+// the same output.
+//
+// usage: emojilang_engine_bench [directory = tests] [runs = 200]
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ClosureCompiler.hpp"
+#include "EmojiInterpreter.hpp"
+#include "EmojiTransformer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "SourceBuffer.hpp"
+
+namespace {
+
+Tree prepare(const std::string& source) {
+    Tree tree = Parser().parse(source);
+    EmojiTransformer().visit(tree);
+    Resolver().resolve(tree);
+    Optimizer().optimize(tree);
+    return tree;
+}
+
+template <typename Run>
+double timeRuns(int runs, Run run, std::string& output) {
+    double best = 1e100;
+    for (int batch = 0; batch < 3; ++batch) {
+        std::ostringstream out;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i) {
+            out.str("");
+            run(out);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        output = out.str();
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path directory = argc > 1 ? argv[1] : "tests";
+    int runs = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".emo") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        std::cerr << "no .emo files in " << directory << std::endl;
+        return 1;
+    }
+
+    std::cout << "tree walker vs closure compiler, " << runs << " runs per file" << std::endl;
+    double treeTotal = 0;
+    double closureTotal = 0;
+    for (const auto& path : files) {
+        Tree tree = prepare(std::string(SourceBuffer::fromFile(path.string()).text()));
+
+        auto compileStart = std::chrono::steady_clock::now();
+        ClosureProgram program = ClosureCompiler().compile(tree);
+        std::chrono::duration<double> compile = std::chrono::steady_clock::now() - compileStart;
+
+        std::string treeOutput;
+        double walker = timeRuns(runs, [&](std::ostream& out) {
+            std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+            EmojiInterpreter(&tree).start();
+            std::cout.rdbuf(saved);
+        }, treeOutput);
+
+        std::string closureOutput;
+        double closure = timeRuns(runs, [&](std::ostream& out) {
+            program.run(out);
+        }, closureOutput);
+
+        if (treeOutput != closureOutput) {
+            std::cerr << "ERROR: " << path.filename().string() << ": engines disagree" << std::endl;
+            return 1;
+        }
+        treeTotal += walker;
+        closureTotal += closure;
+        std::cout << std::setw(20) << path.filename().string() << ": tree " << std::fixed << std::setprecision(2)
+                  << std::setw(8) << walker * 1e3 << " ms, closure " << std::setw(8) << closure * 1e3
+                  << " ms  (" << std::setw(5) << walker / closure << "x, compile " << std::setprecision(1)
+                  << compile.count() * 1e6 << " us)" << std::endl;
+    }
+    std::cout << std::setw(20) << "total" << ": tree " << std::setprecision(2) << std::setw(8) << treeTotal * 1e3
+              << " ms, closure " << std::setw(8) << closureTotal * 1e3 << " ms  (" << std::setw(5)
+              << treeTotal / closureTotal << "x)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Lexer throughput benchmark.
+//
+// Concatenates the .emo files of a corpus directory until the text reaches the
+// requested size, then lexes it with every scan level the CPU supports and
+// reports MB/s. Tokens are pulled one at a time with Lexer::next() and folded
+// into a checksum, so the numbers measure scanning rather than vector growth.
+// All levels must produce identical token streams.
+//
+// usage: emojilang_lexer_bench [corpus-dir = tests] [size-in-MB = 100]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Lexer.hpp"
+#include "SourceBuffer.hpp"
+
+namespace {
+
+std::string buildCorpus(const std::filesystem::path& dir, size_t targetBytes) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".emo") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    
+    std::string unit;
+    for (const auto& file : files) {
+        unit += SourceBuffer::fromFile(file.string()).text();
+        unit += "\n";
+    }
+    if (unit.empty()) return unit;
+    
+    std::string corpus;
+    corpus.reserve(targetBytes + unit.size());
+    while (corpus.size() < targetBytes) {
+        corpus += unit;
+    }
+    return corpus;
+}
+
+struct LexSummary {
+    size_t tokens = 0;
+    uint64_t checksum = 0;
+};
+
+LexSummary lexAll(const std::string& corpus, const ScanKernels& kernels) {
+    Lexer lexer(corpus, kernels);
+    LexSummary summary;
+    while (true) {
+        LexToken token = lexer.next();
+        summary.tokens++;
+        summary.checksum = summary.checksum * 1099511628211ull +
+                           (static_cast<uint64_t>(token.offset) << 24) +
+                           (static_cast<uint64_t>(token.length) << 8) +
+                           static_cast<uint64_t>(token.type) +
+                           (static_cast<uint64_t>(token.line) << 40) +
+                           static_cast<uint64_t>(token.column);
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+    return summary;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path dir = argc > 1 ? argv[1] : "tests";
+    size_t megabytes = argc > 2 ? std::stoul(argv[2]) : 100;
+    const int repetitions = 3;
+    
+    std::string corpus;
+    try {
+        corpus = buildCorpus(dir, megabytes * 1024 * 1024);
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    if (corpus.empty()) {
+        std::cerr << "ERROR: no .emo files in " << dir << std::endl;
+        return 1;
+    }
+    
+    double mb = static_cast<double>(corpus.size()) / (1024.0 * 1024.0);
+    std::cout << "corpus: " << dir.string() << " scaled to " << std::fixed << std::setprecision(1)
+              << mb << " MB" << std::endl;
+    
+    LexSummary reference;
+    double scalarRate = 0.0;
+    
+    for (ScanLevel level : {ScanLevel::SCALAR, ScanLevel::SSE2, ScanLevel::AVX2}) {
+        const ScanKernels* kernels = ScanKernels::forLevel(level);
+        if (!kernels) continue;
+        
+        double best = 1e100;
+        LexSummary summary;
+        for (int i = 0; i < repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            summary = lexAll(corpus, *kernels);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        
+        double rate = mb / best;
+        if (level == ScanLevel::SCALAR) {
+            scalarRate = rate;
+            reference = summary;
+        } else if (summary.tokens != reference.tokens || summary.checksum != reference.checksum) {
+            std::cerr << "ERROR: " << kernels->name << " token stream differs from scalar" << std::endl;
+            return 1;
+        }
+        
+        std::cout << std::setw(8) << kernels->name << ": " << std::setw(9) << std::setprecision(1) << rate
+                  << " MB/s  (" << std::setprecision(2) << rate / scalarRate << "x scalar, "
+                  << summary.tokens << " tokens)" << std::endl;
+    }
+    
+    return 0;
+}
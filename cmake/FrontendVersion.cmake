@@ -0,0 +1,24 @@
+# Writes OUTPUT, a header defining EMOJILANG_FRONTEND_VERSION: a hash of
+# SOURCES, the files that decide what tree a program compiles to and how
+# ProgramCache encodes it. Cache entries from a build with any difference in
+# them are never read.
+#
+#   cmake -DOUTPUT=<header> "-DSOURCES=<file;file;...>" -P FrontendVersion.cmake
+
+set(hashes "")
+foreach(source ${SOURCES})
+    file(SHA256 "${source}" hash)
+    string(APPEND hashes "${hash}")
+endforeach()
+string(SHA256 version "${hashes}")
+string(SUBSTRING "${version}" 0 16 version)
+
+set(header "#pragma once\n// Generated by cmake/FrontendVersion.cmake\n#define EMOJILANG_FRONTEND_VERSION 0x${version}ull\n")
+# Left alone when nothing changed, so ProgramCache.cpp is not rebuilt
+set(previous "")
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" previous)
+endif()
+if(NOT header STREQUAL previous)
+    file(WRITE "${OUTPUT}" "${header}")
+endif()
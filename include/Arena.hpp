@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for immutable strings. Text is copied into large blocks and
+// handed out as string_views that stay valid until clear() or destruction,
+// so releasing everything costs one free per block rather than per string.
+class StringArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+    StringArena();
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) noexcept = default;
+    StringArena& operator=(StringArena&&) noexcept = default;
+
+    std::string_view store(std::string_view text);
+    // Drop every stored string, keeping the first block for reuse.
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::unique_ptr<char[]>> large;
+    char* cursor;
+    size_t remaining;
+};
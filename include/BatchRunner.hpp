@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Runs one file start to finish, writing what it prints to `output` and its
+// error messages to `errors`; false if the file failed.
+using BatchJob = std::function<bool(const std::string& fileName, std::ostream& output, std::ostream& errors)>;
+
+// Runs many files at once on a work-stealing ThreadPool. Every file's output
+// is captured separately and written out in input order, as soon as that
+// file and all files before it have finished, so the result reads the same
+// as a sequential run. A summary of each file's status and run time follows.
+class BatchRunner {
+public:
+    explicit BatchRunner(size_t jobs);
+
+    // Returns the number of files that failed
+    size_t run(const std::vector<std::string>& files, const BatchJob& job, std::ostream& output,
+               std::ostream& errors);
+
+private:
+    size_t jobs;
+};
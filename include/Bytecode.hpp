@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Value.hpp"
+
+// Register-machine instruction set. Operands a, b and c are register
+// numbers unless noted; jump targets are instruction indices.
+enum class OpCode : uint8_t {
+    MOVE,           // R[a] = R[b]
+    ADD,            // R[a] = R[b] + R[c]
+    SUB,            // R[a] = R[b] - R[c]
+    MUL,            // R[a] = R[b] * R[c]
+    DIV,            // R[a] = R[b] / R[c]
+    MOD,            // R[a] = R[b] % R[c]
+    EQ,             // R[a] = R[b] == R[c]
+    NE,             // R[a] = R[b] != R[c]
+    LT,             // R[a] = R[b] < R[c]
+    LE,             // R[a] = R[b] <= R[c]
+    GT,             // R[a] = R[b] > R[c]
+    GE,             // R[a] = R[b] >= R[c]
+    BAND,           // R[a] = R[b] & R[c]
+    BOR,            // R[a] = R[b] | R[c]
+    BXOR,           // R[a] = R[b] ^ R[c]
+    AND,            // R[a] = R[b] and R[c]
+    OR,             // R[a] = R[b] or R[c]
+    NOT,            // R[a] = not R[b]
+    BNOT,           // R[a] = ~R[b]
+    JUMP,           // pc = b
+    JUMP_IF_FALSE,  // if not R[a]: pc = b
+    PRINT,          // print R[a]
+    HALT
+};
+
+const char* opCodeName(OpCode op);
+
+struct Instruction {
+    OpCode op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+// Output of BytecodeCompiler. The first constants.size() registers are
+// preloaded with the constant pool, so literals are plain register operands;
+// variables and temporaries occupy the registers after them.
+struct BytecodeProgram {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    uint32_t registerCount = 0;
+    
+    std::string disassemble() const;
+};
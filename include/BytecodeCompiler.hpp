@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bytecode.hpp"
+#include "Tree.hpp"
+
+// Lowers a transformed and resolved Tree to register bytecode. A variable
+// lives in register (constant count + its Resolver slot) for the lifetime of
+// its scope; temporaries are allocated above the live variables.
+class BytecodeCompiler {
+public:
+    BytecodeProgram compile(const Tree& tree);
+    
+private:
+    // Pending jumps for the innermost construct that break/continue leave
+    struct JumpTargets {
+        std::vector<size_t> breakJumps;
+        std::vector<size_t> continueJumps;
+    };
+    
+    const Tree* tree;
+    BytecodeProgram program;
+    // First free register when each open scope was entered
+    std::vector<uint32_t> scopes;
+    ConstantPool constants;
+    std::vector<JumpTargets> jumpTargets;
+    uint32_t nextRegister;
+    uint32_t firstVariable;
+    
+    uint32_t constant(const Value& value);
+    uint32_t literal(NodeId node);
+    
+    void enterScope();
+    void exitScope();
+    uint32_t declare(NodeId nameNode);
+    uint32_t variable(NodeId nameNode) const;
+    uint32_t allocateRegister();
+    
+    size_t emit(OpCode op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    void patchJumps(const std::vector<size_t>& jumps, size_t target);
+    
+    void compileTopLevel(NodeId node);
+    void compileStatement(NodeId node);
+    void compileSuite(NodeId node);
+    void compileDeclare(NodeId node);
+    void compileAssignment(NodeId node, bool isDeclaration);
+    void compileIf(NodeId node);
+    void compileWhile(NodeId node);
+    void compileFor(NodeId node);
+    void compileFlow(NodeId node);
+    uint32_t compileExpression(NodeId node);
+    void storeInto(uint32_t target, uint32_t source, uint32_t firstTemporary);
+};
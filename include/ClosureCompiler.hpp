@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include "EmojiInterpreter.hpp"
+#include "Tree.hpp"
+#include "Value.hpp"
+
+// What a running closure program works on
+struct ClosureContext {
+    Value* frame;
+    std::ostream& output;
+};
+
+using ClosureExpression = std::function<Value(ClosureContext&)>;
+using ClosureCondition = std::function<bool(ClosureContext&)>;
+using ClosureStatement = std::function<Completion(ClosureContext&)>;
+
+// A program compiled into nested closures. It does not refer back to the
+// tree, so it can outlive it and run any number of times.
+class ClosureProgram {
+public:
+    void run(std::ostream& output = std::cout) const;
+
+private:
+    friend class ClosureCompiler;
+
+    ClosureStatement body;
+    uint32_t frameSize = 0;
+};
+
+// Compiles a transformed and resolved Tree once into a tree of pre-bound
+// callables with the same shape as the EmojiInterpreter visitors. Operators
+// are picked, variable slots bound and literals decoded at compile time;
+// binary operators are also instantiated for the shape of their operands (a
+// variable, a literal, an int literal or a nested expression), so `i ➕ 1`
+// reads its slot directly and never tests the type of the 1. Comparisons
+// used as conditions produce a bool instead of a Value. Running the program
+// is then a chain of direct calls with no node-kind switch and no operator
+// text.
+class ClosureCompiler {
+public:
+    ClosureProgram compile(const Tree& tree);
+
+private:
+    const Tree* tree;
+
+    ClosureStatement statement(NodeId node);
+    ClosureStatement suite(NodeId node);
+    ClosureStatement ifStatement(NodeId node);
+    ClosureStatement whileStatement(NodeId node);
+    ClosureStatement forStatement(NodeId node);
+    ClosureStatement declareStatement(NodeId node);
+    ClosureStatement assignment(NodeId node);
+    ClosureExpression expression(Child child);
+    ClosureExpression binary(NodeId node);
+    ClosureCondition condition(Child child);
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Tree.hpp"
+
+// Translates a transformed and resolved Tree into one standalone C++17
+// translation unit with the same output as the interpreter.
+//
+// Every declaration becomes a C++ local in a block that mirrors its emoji
+// scope. Its type is inferred from all the values stored into it: a variable
+// that only ever holds ints becomes an int, and so on for double, bool and
+// string; one that holds more than one type falls back to rt::Value, a small
+// tagged value in the emitted runtime with the interpreter's conversions.
+// Loops become native while/for loops and print writes into a buffer that is
+// flushed when full and at exit.
+class CppEmitter {
+public:
+    std::string emit(const Tree& tree, std::string_view sourceName = "");
+
+private:
+    enum class Type : uint8_t {
+        UNKNOWN,   // no store seen yet
+        INT,
+        DOUBLE,
+        BOOL,
+        STRING,
+        VALUE      // more than one type: boxed in rt::Value
+    };
+
+    struct Variable {
+        std::string name;
+        Type type;
+    };
+    struct Store {
+        uint32_t variable;
+        NodeId value;   // 0 for a bare declaration, which stores int 0
+    };
+    struct Expression {
+        std::string code;
+        Type type;
+    };
+
+    const Tree* tree;
+    std::vector<Variable> variables;
+    std::vector<Store> stores;
+    // Variable each NAME node refers to, and the variable last declared in each slot
+    std::vector<uint32_t> nameVariable;
+    std::vector<uint32_t> slotVariable;
+    std::string out;
+    int indent;
+    int loopDepth;
+
+    void collect(NodeId node);
+    void declare(NodeId nameNode);
+    void inferTypes();
+    Type typeOf(NodeId node) const;
+    static Type join(Type left, Type right);
+    static const char* typeName(Type type);
+
+    void line(const std::string& text);
+    bool hasStrayFlow(NodeId node) const;
+    void emitTopLevel(NodeId node);
+    void emitStatement(NodeId node);
+    void emitSuite(NodeId node);
+    void emitDeclare(NodeId node);
+    std::string assignment(NodeId node, bool isDeclaration);
+    void emitIf(NodeId node);
+    void emitWhile(NodeId node);
+    void emitFor(NodeId node);
+    Expression expression(NodeId node);
+    Expression literal(const Value& value);
+    std::string condition(NodeId node);
+    std::string convert(const Expression& value, Type type) const;
+};
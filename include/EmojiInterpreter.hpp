@@ -1,61 +1,236 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ExecutionLimits.hpp"
+#include "Jit.hpp"
+#include "ThreadPool.hpp"
 #include "Tree.hpp"
-#include "SymbolTable.hpp"
+#include "Value.hpp"
+
+// How a statement finished. Break and continue travel back up to the nearest
+// enclosing loop as this status instead of as a Value.
+enum class Completion : uint8_t {
+    NORMAL,
+    BREAK,
+    CONTINUE
+};
+
+// When loops move from the walker to compiled code
+struct TieringOptions {
+    bool jit = false;
+    // Iterations a loop runs in the walker, summed over all of its runs,
+    // before it is compiled; 0 compiles every loop the first time it runs
+    uint32_t threshold = 1000;
+    // Log every tier decision to the diagnostics stream
+    bool trace = false;
+};
 
 class EmojiInterpreter {
 private:
-    SymbolTable symbolTable;
-    TreePtr parseTree;
-    bool isAssignmentDeclaration;
+    const Tree* parseTree;
+    std::ostream& output;
+    // Variable storage, indexed by the slots the Resolver assigned
+    std::vector<Value> frame;
+    
+    // Tier state of each loop that has run while the JIT was enabled
+    struct LoopState {
+        uint64_t iterations = 0;
+        std::unique_ptr<JitCode> code;
+        uint32_t failures = 0;
+        bool rejected = false;
+    };
+    TieringOptions tiering;
+    JitCompiler jit;
+    std::unordered_map<NodeId, LoopState> loopStates;
+    
+    // What a binary arithmetic or comparison node has specialized itself
+    // into; see visitSpecialized.
+    enum class Specialization : uint8_t {
+        UNINITIALIZED,
+        INT_ADD, DOUBLE_ADD, GENERIC_ADD,
+        INT_SUB, DOUBLE_SUB, GENERIC_SUB,
+        INT_MUL, DOUBLE_MUL, GENERIC_MUL,
+        DIV,
+        INT_MOD, GENERIC_MOD,
+        INT_COMPARE, GENERIC_COMPARE
+    };
+    struct NodeState {
+        Specialization specialization = Specialization::UNINITIALIZED;
+        CompareOp op = CompareOp::EQ;
+    };
+    bool specializing;
+    // Per-execution shadow of the tree's nodes, indexed by NodeId, so the
+    // Tree itself stays immutable and shareable
+    std::vector<NodeState> nodeStates;
+    
+    // A for loop of the form `i = a; i < b; i = i + c` whose body never
+    // writes i or b; see countedLoop
+    struct CountedLoop {
+        bool counted = false;
+        uint32_t slot = 0;          // induction variable
+        CompareOp op = CompareOp::LT;
+        bool boundIsSlot = false;
+        uint32_t bound = 0;         // slot of the bound variable,
+        int limit = 0;              // or the bound itself
+        int step = 0;
+    };
+    bool countingLoops;
+    std::unordered_map<NodeId, CountedLoop> countedLoops;
+    
+    // Whether the iterations of a counted for loop are independent of each
+    // other; see parallelLoop
+    struct ParallelLoop {
+        bool independent = false;
+        std::string reason;     // why not, for the report
+        bool reported = false;
+    };
+    size_t parallelThreads;
+    bool reportParallel;
+    std::ostream* diagnostics;
+    std::unique_ptr<ThreadPool> pool;
+    std::unordered_map<NodeId, ParallelLoop> parallelLoops;
+    
+    // A 🚀 block running on the task pool, in an interpreter of its own, on
+    // a snapshot of the frame taken when it was spawned
+    struct Task {
+        std::ostringstream output;
+        std::exception_ptr failure;
+        std::mutex mutex;
+        std::condition_variable done;
+        bool finished = false;
+    };
+    size_t taskThreads;
+    // Shared with the interpreters running tasks; the interpreter that
+    // spawns the first task owns it
+    ThreadPool* taskPool;
+    std::unique_ptr<ThreadPool> ownedTaskPool;
+    // Spawned here and not joined yet, in spawn order
+    std::vector<std::shared_ptr<Task>> tasks;
+    
+    // What is left of the run's ExecutionLimits, shared with the
+    // interpreters running its tasks and parallel chunks
+    struct Budget {
+        ExecutionLimits limits;
+        std::chrono::steady_clock::time_point deadline;
+        std::atomic<uint64_t> iterations{0};
+        std::atomic<uint64_t> outputBytes{0};
+    };
+    std::shared_ptr<Budget> budget;
+    // Iterations run here since the budget was last charged
+    uint32_t uncharged;
     
 public:
-    EmojiInterpreter(TreePtr tree);
+    // `tree` must have been run through the Resolver.
+    EmojiInterpreter(const Tree* tree = nullptr, std::ostream& output = std::cout);
+    // Waits for tasks that were never joined; their output and errors are lost
+    ~EmojiInterpreter();
     void start();
+    // Run one more top-level statement in the global scope set up by start().
+    void execute(const Tree& tree, NodeId statement);
+    // Hot int/bool-only loops run as native code (see JitCompiler); where
+    // the JIT is not available they all stay in the walker.
+    void setTiering(const TieringOptions& options);
+    // Binary arithmetic and comparison nodes rewrite themselves for the
+    // operand types they see (on by default).
+    void setSpecialization(bool enabled);
+    // Simple counting for loops run with a native int counter (on by default).
+    void setCountedLoops(bool enabled);
+    // Counted for loops with independent iterations run in chunks on
+    // `threads` threads (0 turns this off, the default). Each decision is
+    // reported on the diagnostics stream unless `report` is false.
+    void setParallelLoops(size_t threads, bool report = true);
+    // Threads for 🚀 tasks; 0, the default, uses one per core.
+    void setTaskThreads(size_t threads);
+    // Where TIERING and PARALLEL lines go; std::cerr by default.
+    void setDiagnostics(std::ostream& stream);
+    // Stops the run with LimitExceeded once it goes past `limits`; the
+    // timeout counts from this call. Compiled loops are not counted, so
+    // the JIT stays off while any limit is set.
+    void setLimits(const ExecutionLimits& limits);
     
 private:
-    Value visit(TreePtr tree);
-    Value visit(const TreeNode& node);
-    void visitChildren(TreePtr tree);
+    Completion exec(NodeId node);
+    Value visit(NodeId node);
+    Value visit(Child child);
     
-    // Statement visitors
-    Value visitStatement(TreePtr tree);
-    Value visitString(TreePtr tree);
-    Value visitName(TreePtr tree);
-    Value visitNumber(TreePtr tree);
-    Value visitBoolean(TreePtr tree);
+    // Leaf visitors
+    Value visitLiteral(NodeId node);
+    Value visitName(NodeId node);
     
     // Expression visitors
-    Value visitCastExpression(TreePtr tree);
-    Value visitAdditiveExpression(TreePtr tree);
-    Value visitMultiplicativeExpression(TreePtr tree);
-    Value visitEqualityExpression(TreePtr tree);
-    Value visitAndExpression(TreePtr tree);
-    Value visitExclusiveOrExpression(TreePtr tree);
-    Value visitInclusiveOrExpression(TreePtr tree);
-    Value visitLogicalAndExpression(TreePtr tree);
-    Value visitLogicalOrExpression(TreePtr tree);
-    Value visitExp(TreePtr tree);
+    Value visitCastExpression(NodeId node);
+    Value visitAdditiveExpression(NodeId node);
+    Value visitMultiplicativeExpression(NodeId node);
+    Value visitEqualityExpression(NodeId node);
+    Value visitAndExpression(NodeId node);
+    Value visitExclusiveOrExpression(NodeId node);
+    Value visitInclusiveOrExpression(NodeId node);
+    Value visitLogicalAndExpression(NodeId node);
+    Value visitLogicalOrExpression(NodeId node);
+    Value visitExp(NodeId node);
+    Value visitSpecialized(NodeId node);
+    const Value& operand(Child child, Value& scratch);
+    NodeState rewrite(NodeId node, const NodeState& state, const Value& left, const Value& right);
     
     // Statement execution
-    Value visitPrintStatement(TreePtr tree);
-    Value visitAssignmentStatement(TreePtr tree);
-    Value visitDeclareStatement(TreePtr tree);
-    Value visitSuite(TreePtr tree);
-    Value visitIfStatement(TreePtr tree);
-    Value visitWhileStatement(TreePtr tree);
-    Value visitForStatement(TreePtr tree);
-    Value visitForDecl(TreePtr tree);
-    Value visitForTest(TreePtr tree);
-    Value visitForUpdates(TreePtr tree);
-    Value visitFlowStatement(TreePtr tree);
+    Completion visitStatement(NodeId node);
+    Completion visitPrintStatement(NodeId node);
+    Completion visitAssignmentStatement(NodeId node);
+    Completion visitDeclareStatement(NodeId node);
+    Completion visitSuite(NodeId node);
+    Completion visitIfStatement(NodeId node);
+    Completion visitWhileStatement(NodeId node);
+    Completion visitForStatement(NodeId node);
+    Completion visitForDecl(NodeId node);
+    Value visitForTest(NodeId node);
+    Completion visitForUpdates(NodeId node);
+    Completion visitFlowStatement(NodeId node);
+    Completion visitSpawnStatement(NodeId node);
+    Completion visitJoinStatement(NodeId node);
+    
+    // Loops from their test onwards, without the for_decl
+    Completion runWhile(NodeId node);
+    Completion runFor(NodeId node, bool allowCounted = true);
+    const CountedLoop& countedLoop(NodeId node);
+    Completion runCounted(NodeId node, const CountedLoop& loop);
+    bool writes(NodeId node, uint32_t slot) const;
+    bool intConstant(Child child, int& value) const;
+    ParallelLoop& parallelLoop(NodeId node);
+    bool runParallel(NodeId node);
+    void runIterations(NodeId node, int first, uint64_t count);
+    void collectDeclared(NodeId node, std::vector<bool>& declared) const;
+    bool outsideWrite(NodeId node, const std::vector<bool>& declared, NodeId& target) const;
+    bool breaksOut(NodeId node) const;
+    void report(NodeId loop, ParallelLoop& state, const std::string& message);
+    void reportNested(NodeId node, NodeId outer);
+    // Settings an interpreter running part of this one's program inherits
+    void configure(EmojiInterpreter& worker) const;
+    ThreadPool& tasksPool();
+    // Writes out every unjoined task's output in spawn order, then raises
+    // the first task error
+    void joinTasks();
+    void waitFor(Task& task);
+    void countIteration();
+    void charge();
+    // Runs a hot loop as native code, from its start or from its test; false
+    // if the walker has to run it
+    bool runCompiled(NodeId loop, bool fromTest);
+    // Iteration counter of a loop that may still be compiled, or null
+    LoopState* profile(NodeId loop);
+    void trace(NodeId loop, const std::string& message) const;
+    uint32_t lineOf(NodeId node) const;
+    // Continues in the walker where compiled code bailed out
+    Completion resume(const ResumePath& path, size_t level);
     
     // Helper functions
-    std::string valueToString(const Value& value);
-    double valueToDouble(const Value& value);
-    bool valueToBool(const Value& value);
-    int valueToInt(const Value& value);
-    bool isToken(const TreeNode& node);
-    std::string getTokenValue(const TreeNode& node);
+    bool isToken(Child child);
+    std::string_view getTokenValue(Child child);
 };
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "ExecutionLimits.hpp"
+
+class Tree;
+
+struct CompileOptions {
+    // Fold constants and drop dead code before the first run (see Optimizer)
+    bool optimize = true;
+    // Reuse and keep compiled trees in this directory (see ProgramCache);
+    // empty for no cache
+    std::string cacheDirectory;
+};
+
+struct RunOptions {
+    ExecutionLimits limits;
+    // Compile hot loops to machine code; ignored while a limit is set
+    bool jit = true;
+    // Walker iterations before a loop is compiled, 0 to compile it the
+    // first time it runs
+    uint32_t jitThreshold = 1000;
+    // Log every tier change to `diagnostics`
+    bool traceTiering = false;
+    // Rewrite arithmetic and comparison nodes for the types they see
+    bool specialize = true;
+    // Run counting for loops on a native int counter
+    bool countedLoops = true;
+    // Threads for 🚀 tasks, 0 for one per core
+    size_t taskThreads = 0;
+    // Threads for counted loops with independent iterations, 0 to run
+    // them sequentially
+    size_t parallelThreads = 0;
+    // Print a PARALLEL line to `diagnostics` the first time each loop runs
+    bool reportParallel = false;
+    // Stream for the traceTiering and reportParallel lines; nullptr for
+    // std::cerr
+    std::ostream* diagnostics = nullptr;
+};
+
+// Embedding API of libemojilang. A program is parsed, resolved and
+// optimized once by compile(); the handle is immutable and cheap to copy,
+// and every copy shares the same compiled tree. run() builds all of its
+// state (variables, JIT code, task pool) per call and writes only to the
+// stream it is given, plus options.diagnostics when traceTiering or
+// reportParallel is set (std::cerr unless a stream is given), so any
+// number of threads may run the same program at once. The library keeps no
+// global state.
+class EmojiProgram {
+public:
+    // Throws std::runtime_error on syntax and scope errors
+    static EmojiProgram compile(std::string_view source, const CompileOptions& options = {});
+    static EmojiProgram compileFile(const std::string& path, const CompileOptions& options = {});
+
+    // Runs the program once on the tree walker, printing into `output`.
+    // Throws std::runtime_error if the run fails, LimitExceeded if it goes
+    // past options.limits; whatever it printed until then stays in `output`.
+    void run(std::ostream& output, const RunOptions& options = {}) const;
+    // Runs the program once and returns what it printed
+    std::string run(const RunOptions& options = {}) const;
+
+    // Compiles and runs a program pulled from `input` in chunks, one
+    // top-level statement at a time, so it is never held whole. There is no
+    // handle to keep and options.cacheDirectory is ignored.
+    static void runStream(std::istream& input, std::ostream& output, const CompileOptions& compileOptions = {},
+                          const RunOptions& runOptions = {});
+
+    // The resolved (and optimized) tree, for engines other than the walker
+    const Tree& syntaxTree() const;
+
+private:
+    std::shared_ptr<const Tree> tree;
+
+    explicit EmojiProgram(std::shared_ptr<const Tree> tree);
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+// Single source of truth for every emoji operator/keyword and its plain-text
+// spelling. Parser and EmojiTransformer both build their lookups from here.
+struct EmojiMapping {
+    std::string_view emoji;
+    std::string_view text;
+};
+
+inline constexpr EmojiMapping EMOJI_MAPPINGS[] = {
+    {"📢", "decl"},
+    {"😌", "="},
+    {"🗿", ","},
+    {"👄", ";"},
+    {"🖨", "print"},
+    {"👉", "("},
+    {"👈", ")"},
+    {"🍽", "{"},
+    {"🥂", "}"},
+    {"💿", "while"},
+    {"📀", "for"},
+    {"🚩", "if"},
+    {"🏳", "elif"},
+    {"🏁", "else"},
+    {"⏸", "break"},
+    {"⏩", "continue"},
+    {"🚀", "spawn"},
+    {"🤝", "join"},
+    {"✔", "true"},
+    {"❌", "false"},
+    {"➕", "+"},
+    {"➖", "-"},
+    {"✖", "*"},
+    {"➗", "/"},
+    {"📎", "%"},
+    {"😭", "<"},
+    {"😁", ">"},
+    {"😁😌", ">="},
+    {"😭😌", "<="},
+    {"😌😌", "=="},
+    {"❗😌", "!="},
+    {"⚛", "&"},
+    {"☯", "|"},
+    {"⚓", "xor"},
+    {"😠", "and"},
+    {"😇", "or"},
+    {"❗", "!"},
+    {"〰", "~"}
+};
+
+inline constexpr size_t EMOJI_MAPPING_COUNT = std::size(EMOJI_MAPPINGS);
+
+// Result of a longest-match lookup: index into EMOJI_MAPPINGS (-1 if nothing
+// matched) and the number of source bytes consumed.
+struct EmojiMatch {
+    int index;
+    size_t length;
+};
+
+// Upper bound on trie nodes: one per emoji byte plus the root.
+constexpr size_t emojiTrieMaxNodes() {
+    size_t total = 1;
+    for (const auto& mapping : EMOJI_MAPPINGS) {
+        total += mapping.emoji.size();
+    }
+    return total;
+}
+
+// UTF-8 byte trie over EMOJI_MAPPINGS, built entirely at compile time.
+// Children of a node form a singly linked sibling list; the root level is
+// additionally indexed by first byte so most lookups never walk a list.
+class EmojiTrie {
+public:
+    struct Node {
+        unsigned char byte;
+        int16_t firstChild;
+        int16_t nextSibling;
+        int16_t mapping;
+    };
+
+    constexpr EmojiTrie() : nodes{}, rootChild{}, nodeCount(1) {
+        nodes[0] = Node{0, -1, -1, -1};
+        for (auto& child : rootChild) {
+            child = -1;
+        }
+        for (size_t i = 0; i < EMOJI_MAPPING_COUNT; ++i) {
+            insert(EMOJI_MAPPINGS[i].emoji, static_cast<int16_t>(i));
+        }
+    }
+
+    // Longest emoji starting at `begin`; never reads past `end`.
+    constexpr EmojiMatch match(const char* begin, const char* end) const {
+        EmojiMatch best{-1, 0};
+        if (begin == end) return best;
+
+        int16_t node = rootChild[static_cast<unsigned char>(*begin)];
+        size_t depth = 1;
+        while (node != -1) {
+            if (nodes[node].mapping != -1) {
+                best = EmojiMatch{nodes[node].mapping, depth};
+            }
+            if (begin + depth == end) break;
+            node = findChild(node, static_cast<unsigned char>(begin[depth]));
+            ++depth;
+        }
+        return best;
+    }
+
+private:
+    std::array<Node, emojiTrieMaxNodes()> nodes;
+    std::array<int16_t, 256> rootChild;
+    size_t nodeCount;
+
+    constexpr int16_t findChild(int16_t parent, unsigned char byte) const {
+        for (int16_t child = nodes[parent].firstChild; child != -1; child = nodes[child].nextSibling) {
+            if (nodes[child].byte == byte) return child;
+        }
+        return -1;
+    }
+
+    constexpr int16_t addChild(int16_t parent, unsigned char byte) {
+        int16_t child = static_cast<int16_t>(nodeCount++);
+        nodes[child] = Node{byte, -1, nodes[parent].firstChild, -1};
+        nodes[parent].firstChild = child;
+        if (parent == 0) {
+            rootChild[byte] = child;
+        }
+        return child;
+    }
+
+    constexpr void insert(std::string_view emoji, int16_t mapping) {
+        int16_t node = 0;
+        for (char c : emoji) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            int16_t child = findChild(node, byte);
+            node = child != -1 ? child : addChild(node, byte);
+        }
+        nodes[node].mapping = mapping;
+    }
+};
+
+inline constexpr EmojiTrie EMOJI_TRIE{};
+
+// Compile-time sanity checks: longest match must win regardless of table order.
+static_assert(EMOJI_TRIE.match("😭😌", "😭😌" + 8).length == 8, "longest match expected");
+static_assert(EMOJI_MAPPINGS[EMOJI_TRIE.match("😭 ", "😭 " + 5).index].text == "<", "prefix match expected");
+static_assert(EMOJI_TRIE.match("a", "a" + 1).index == -1, "non-emoji must not match");
@@ -1,30 +1,24 @@
 #pragma once
-#include <memory>
+#include <string_view>
 #include <unordered_map>
 #include "Tree.hpp"
 
 class EmojiTransformer {
 private:
-    std::unordered_map<std::string, std::string> emojiMappings;
+    std::unordered_map<std::string_view, std::string_view> emojiMappings;
     void initializeMappings();
     
 public:
     EmojiTransformer();
-    void visit(TreePtr tree);
+    void visit(Tree& tree);
+    void visit(Tree& tree, NodeId node);
     
 private:
-    void visitIfStatement(TreePtr tree);
-    void visitBoolean(TreePtr tree);
-    void visitCastExpression(TreePtr tree);
-    void visitMultiplicativeExpression(TreePtr tree);
-    void visitAdditiveExpression(TreePtr tree);
-    void visitEqualityExpression(TreePtr tree);
-    void visitAndExpression(TreePtr tree);
-    void visitExclusiveOrExpression(TreePtr tree);
-    void visitInclusiveOrExpression(TreePtr tree);
-    void visitLogicalAndExpression(TreePtr tree);
-    void visitLogicalOrExpression(TreePtr tree);
+    void visitIfStatement(Tree& tree, NodeId node);
+    void visitBoolean(Tree& tree, NodeId node);
+    void visitCastExpression(Tree& tree, NodeId node);
+    void visitOperatorExpression(Tree& tree, NodeId node);
     
-    std::string getMatch(const std::string& emoji);
-    void visitChildren(TreePtr tree);
+    std::string_view getMatch(std::string_view emoji);
+    void visitChildren(Tree& tree, NodeId node);
 };
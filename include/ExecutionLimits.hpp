@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+// Bounds on one run of a program, for hosts that run programs they do not
+// trust. A bound of 0 is no bound.
+struct ExecutionLimits {
+    // Loop iterations, summed over every loop, parallel chunk and task of
+    // the run. Checked every few hundred iterations, so a run may go a
+    // little past it before it stops.
+    uint64_t maxIterations = 0;
+    // Wall-clock time, checked along with the iterations
+    std::chrono::milliseconds timeout{0};
+    // Bytes the program may print, newlines included
+    uint64_t maxOutputBytes = 0;
+
+    bool any() const { return maxIterations > 0 || timeout.count() > 0 || maxOutputBytes > 0; }
+};
+
+// Raised when a run goes past one of its ExecutionLimits
+class LimitExceeded : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Value.hpp"
+
+// Mid-level SSA intermediate representation. A program is one IrFunction:
+// a control-flow graph of basic blocks whose instructions each define at
+// most one value. Values are named by the index of the instruction that
+// defines them; variables only exist while the IrBuilder runs.
+enum class IrOp : uint8_t {
+    CONST,          // constants[constant]
+    PHI,            // one operand per predecessor, in predecessor order
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    BAND,
+    BOR,
+    BXOR,
+    AND,
+    OR,
+    NOT,
+    BNOT,
+    PRINT,          // print operand 0
+    JUMP,           // goto targets[0]
+    BRANCH,         // operand 0 ? targets[0] : targets[1]
+    RETURN
+};
+
+const char* irOpName(IrOp op);
+bool isTerminator(IrOp op);
+// No side effects and no traps: may be removed, merged or moved freely.
+// MOD is excluded because a zero divisor traps.
+bool isPure(IrOp op);
+bool isCommutative(IrOp op);
+
+using IrValue = uint32_t;
+using BlockId = uint32_t;
+
+struct IrInstruction {
+    IrOp op;
+    BlockId block;
+    uint32_t constant = 0;
+    std::vector<IrValue> operands;
+    BlockId targets[2] = {0, 0};
+    bool removed = false;
+};
+
+struct IrBlock {
+    // Phis first, the terminator last
+    std::vector<IrValue> code;
+    std::vector<BlockId> preds;
+    bool removed = false;
+};
+
+class IrFunction {
+public:
+    std::vector<IrInstruction> instructions;
+    std::vector<IrBlock> blocks;
+    ConstantPool constants;
+    BlockId entry = 0;
+
+    BlockId addBlock();
+    // Append to the end of a block (used while it is still being built)
+    IrValue append(BlockId block, IrOp op, std::vector<IrValue> operands = {});
+    // Insert before the block's terminator
+    IrValue insertBeforeTerminator(BlockId block, IrOp op, std::vector<IrValue> operands = {});
+    IrValue insertAfter(IrValue position, IrOp op, std::vector<IrValue> operands = {});
+    IrValue addPhi(BlockId block);
+    // CONST instruction for a pool entry; one per entry, kept in the entry block
+    IrValue constant(uint32_t index);
+    IrValue constant(const Value& value);
+    const Value& constantValue(IrValue value) const;
+
+    void jump(BlockId from, BlockId to);
+    void branch(BlockId from, IrValue condition, BlockId ifTrue, BlockId ifFalse);
+    // Move an instruction to just before another block's terminator
+    void moveBeforeTerminator(IrValue value, BlockId block);
+    void remove(IrValue value);
+
+    const IrInstruction& terminator(BlockId block) const;
+    std::vector<BlockId> successors(BlockId block) const;
+    std::vector<BlockId> reversePostorder() const;
+    bool hasTerminator(BlockId block) const;
+
+    // Rewrite every operand through `replacement` (value -> value, identity
+    // for values that stay), following chains.
+    void replaceUses(const std::vector<IrValue>& replacement);
+
+    std::string dump() const;
+    // Throws std::runtime_error describing the first malformed construct
+    void verify() const;
+
+private:
+    std::vector<uint32_t> constantIndex;
+};
+
+// Immediate dominators over the reachable blocks, computed with the
+// Cooper-Harvey-Kennedy iteration.
+class DominatorTree {
+public:
+    explicit DominatorTree(const IrFunction& function);
+
+    bool reachable(BlockId block) const { return order[block] != UNREACHABLE; }
+    BlockId idom(BlockId block) const { return parent[block]; }
+    bool dominates(BlockId a, BlockId b) const;
+    const std::vector<BlockId>& reversePostorder() const { return rpo; }
+    const std::vector<BlockId>& children(BlockId block) const { return kids[block]; }
+
+private:
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+    std::vector<BlockId> rpo;
+    std::vector<uint32_t> order;
+    std::vector<BlockId> parent;
+    std::vector<std::vector<BlockId>> kids;
+};
+
+// Natural loop: a header plus every block that reaches one of its back
+// edges without passing through it.
+struct IrLoop {
+    BlockId header;
+    BlockId preheader;  // UINT32_MAX when there is no dedicated preheader
+    std::vector<BlockId> latches;
+    std::vector<bool> contains;
+    uint32_t depth = 1;
+};
+
+// Loops of the function, innermost first.
+std::vector<IrLoop> findLoops(const IrFunction& function, const DominatorTree& dominators);
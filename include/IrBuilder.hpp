@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Ir.hpp"
+#include "Tree.hpp"
+
+// Lowers a transformed and resolved Tree to SSA form. Variables are the
+// Resolver's frame slots; phis are placed on the fly with the algorithm of
+// Braun et al. ("Simple and Efficient Construction of Static Single
+// Assignment Form"): a block is sealed once all of its predecessors are
+// known, reads in unsealed blocks create operandless phis that are completed
+// on sealing, and phis whose operands all agree are replaced as they appear.
+//
+// Every loop gets a dedicated preheader, so later passes always have a place
+// to hoist to.
+class IrBuilder {
+public:
+    IrFunction build(const Tree& tree);
+
+private:
+    struct LoopTargets {
+        BlockId breakTarget;
+        BlockId continueTarget;
+    };
+
+    const Tree* tree;
+    IrFunction function;
+    BlockId current;
+    uint32_t slotCount;
+    std::vector<LoopTargets> loopTargets;
+
+    // definitions[block][slot]: value the slot holds at the end of the block
+    std::vector<std::vector<IrValue>> definitions;
+    std::vector<bool> sealed;
+    std::vector<std::vector<std::pair<uint32_t, IrValue>>> incompletePhis;
+    // Removed trivial phis point at the value that replaces them
+    std::vector<IrValue> replacement;
+
+    BlockId newBlock();
+    void sealBlock(BlockId block);
+    IrValue resolve(IrValue value);
+    void writeVariable(uint32_t slot, BlockId block, IrValue value);
+    IrValue readVariable(uint32_t slot, BlockId block);
+    IrValue readVariableRecursive(uint32_t slot, BlockId block);
+    IrValue addPhiOperands(uint32_t slot, IrValue phi);
+    IrValue tryRemoveTrivialPhi(IrValue phi);
+
+    void lowerTopLevel(NodeId node);
+    void lowerStatement(NodeId node);
+    void lowerSuite(NodeId node);
+    void lowerDeclare(NodeId node);
+    void lowerAssignment(NodeId node);
+    void lowerIf(NodeId node);
+    void lowerWhile(NodeId node);
+    void lowerFor(NodeId node);
+    void lowerFlow(NodeId node);
+    IrValue lowerExpression(NodeId node);
+};
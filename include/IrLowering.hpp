@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Bytecode.hpp"
+#include "Ir.hpp"
+
+// Turns an IrFunction back into register bytecode for the VirtualMachine.
+// Constants keep their preloaded registers and every other value gets a
+// register of its own. Phis become copies at the end of each predecessor,
+// ordered so that a swap of two values goes through one scratch register;
+// on an edge out of a branch the copies are placed in a stub of their own.
+// A phi and its operands share the phi's register whenever liveness shows
+// their lifetimes never overlap, which removes most of those copies.
+class IrLowering {
+public:
+    BytecodeProgram lower(const IrFunction& function);
+
+private:
+    struct Fixup {
+        size_t instruction;
+        BlockId target;
+    };
+    struct Stub {
+        size_t branch;
+        BlockId from;
+        BlockId to;
+    };
+
+    const IrFunction* function;
+    BytecodeProgram program;
+    std::vector<uint32_t> registers;
+    std::vector<size_t> blockStart;
+    std::vector<Fixup> fixups;
+    uint32_t scratch;
+
+    void assignRegisters(const std::vector<BlockId>& order);
+    void coalesce(const std::vector<BlockId>& order);
+    bool needsCopies(BlockId from, BlockId to) const;
+    void emitCopies(BlockId from, BlockId to);
+    void emitJump(BlockId target);
+    size_t emit(OpCode op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+};
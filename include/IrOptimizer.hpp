@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Ir.hpp"
+
+// Optimization passes over an IrFunction built by the IrBuilder.
+//
+// - simplifyCfg: folds branches on constants, drops unreachable blocks and
+//   merges straight-line chains of blocks.
+// - Common-subexpression elimination: value numbering scoped by the
+//   dominator tree, so a computation is reused wherever an identical one
+//   dominates it.
+// - Loop-invariant code motion: pure instructions whose operands are all
+//   defined outside a loop move to its preheader, innermost loops first.
+// - Strength reduction on induction variables (phis stepped by a loop
+//   invariant int on the single back edge): `iv ✖ k` becomes an induction
+//   variable of its own stepped by `step ✖ k`, and `iv 📎 k`, for a constant
+//   k above the step and a non-negative constant start, becomes a remainder
+//   that is stepped and wrapped by one compare and subtract. Both need the
+//   operands proven int; like the engines they assume no signed overflow.
+//   The modulo rewrite trades one instruction for three, which only pays
+//   where division is expensive next to dispatch, so it is opt-in.
+// - Dead-code elimination from the prints and branches.
+class IrOptimizer {
+public:
+    explicit IrOptimizer(bool reduceModulo = false);
+
+    void optimize(IrFunction& function);
+
+private:
+    // Possible run-time types of a value, one bit per Value::Type
+    using TypeSet = uint8_t;
+
+    struct InductionVariable {
+        IrValue phi;
+        IrValue init;   // operand from the preheader
+        IrValue step;   // loop invariant
+        IrValue next;   // phi +/- step, flowing in over the back edge
+        bool subtract;
+    };
+
+    IrFunction* function;
+    bool reduceModuloEnabled;
+    std::vector<TypeSet> types;
+
+    bool simplifyCfg();
+    void removeEdge(BlockId from, BlockId to);
+    void replaceValue(IrValue from, IrValue to);
+    bool eliminateCommonSubexpressions();
+    bool hoistLoopInvariants();
+    bool reduceStrength();
+    bool reduceMultiply(const IrLoop& loop, const InductionVariable& iv, IrValue multiply, IrValue factor);
+    bool reduceModulo(const IrLoop& loop, const InductionVariable& iv, IrValue modulo, IrValue divisor);
+    bool eliminateDeadCode();
+
+    void inferTypes();
+    bool isInt(IrValue value) const;
+    bool isIntConstant(IrValue value, int& result) const;
+    bool mayTrap(IrValue value) const;
+    std::vector<InductionVariable> inductionVariables(const IrLoop& loop) const;
+};
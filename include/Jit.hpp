@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "Tree.hpp"
+#include "Value.hpp"
+
+// One level of the point where the tree walker picks up after compiled code
+// bails out. `index` is a child position in `node`: the statement that has
+// not run yet for a suite, for_decl or for_updates, the suite that was taken
+// for an if, and the part being run for a loop (a while's test or body, a
+// for's decl, test, updates or body).
+struct ResumeStep {
+    NodeId node;
+    uint32_t index;
+};
+
+// Steps from the compiled loop down to the innermost one
+using ResumePath = std::vector<ResumeStep>;
+
+// Native code for one loop, specialized on the types its variables had when
+// it was compiled.
+class JitCode {
+public:
+    enum class Exit {
+        FINISHED,      // the loop ran to completion
+        GUARD_FAILED,  // the frame's types differ from the compiled ones; nothing ran
+        BAILOUT        // stopped before a statement it cannot run; see the resume path
+    };
+
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+    ~JitCode();
+
+    // With `fromTest` the loop is entered at its test instead of its start:
+    // on-stack replacement of a loop the walker has already been running,
+    // with any for_decl variables taken from the frame. Prints go to `output`.
+    Exit run(Value* frame, bool fromTest, std::ostream& output, const ResumePath*& resume) const;
+    // Bytes of machine code
+    size_t codeSize() const { return length; }
+
+private:
+    friend class JitCompiler;
+
+    void* code;
+    size_t mappedSize;
+    size_t length;
+    std::vector<ResumePath> bailouts;
+
+    JitCode(void* code, size_t mappedSize, size_t length, std::vector<ResumePath> bailouts);
+};
+
+// Template JIT for the tree walker's hot loops. A while or for loop whose
+// variables hold ints and booleans is translated statement by statement into
+// x86-64 machine code that works directly on the interpreter's frame. Every
+// statement commits its result only once it has finished, so the code can
+// stop before any statement and hand the frame back unchanged:
+//
+// - on int overflow in + - ✖, and on 📎 by 0 or -1, which the walker then
+//   evaluates as every engine does (wrapping, see addInt and moduloInt);
+// - before a store that would change a variable's type;
+// - before a statement that uses doubles, strings or ➗, which it never compiles.
+//
+// Only built for x86-64 Unix; elsewhere, or with EMOJILANG_NO_JIT defined,
+// available() is false and compile() always returns null.
+class JitCompiler {
+public:
+    static bool available();
+
+    // Null when the loop's own test cannot be compiled for the current types.
+    std::unique_ptr<JitCode> compile(const Tree& tree, NodeId loop, const std::vector<Value>& frame);
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include "Scanner.hpp"
+#include "Token.hpp"
+
+// Where a Lexer stands in its source: byte offset plus the line it is on and
+// the offset at which that line starts.
+struct LexerState {
+    size_t pos;
+    uint32_t line;
+    size_t lineStart;
+};
+
+// Turns source text into LexTokens, either one at a time with next() or all
+// at once with tokenize(). Tokens are views into `source`, which must outlive
+// them.
+class Lexer {
+private:
+    std::string_view source;
+    size_t pos;
+    uint32_t line;
+    size_t lineStart;
+    bool stringTruncated;
+    const ScanKernels* kernels;
+    
+    LexToken makeToken(TokenType type, size_t start, size_t end) const;
+    [[noreturn]] void invalidUtf8(const char* at, const LinePosition& from) const;
+    void skipWhitespaceAndComments();
+    
+public:
+    explicit Lexer(std::string_view source, const ScanKernels& kernels = ScanKernels::best());
+    // Resume lexing `source` at a previously saved state (used by TokenStream
+    // when it slides its window over a larger input).
+    Lexer(std::string_view source, const LexerState& resume, const ScanKernels& kernels = ScanKernels::best());
+    
+    LexToken next();
+    std::vector<LexToken> tokenize();
+    
+    LexerState state() const;
+    // True if the last token was a string literal cut off by the end of source.
+    bool truncated() const;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Tree.hpp"
+#include "Value.hpp"
+
+// Tree-to-tree optimizations run between the Resolver and execution.
+//
+// - Literals become CONSTANT nodes, and operators whose operands are all
+//   constant are folded with the same semantics the engines use.
+// - if/elif arms whose condition folds to false are dropped, and a true one
+//   becomes the else; while and for loops whose test is false disappear.
+// - A variable stored exactly once, by a declaration with a constant value,
+//   has its reads replaced by that constant.
+// - Declarations and assignments of variables that are never read are
+//   removed, unless their value may fail at run time: a `📎` whose divisor
+//   is not a constant other than 0 and -1 keeps its store. Nothing else in
+//   an expression has side effects.
+//
+// The last two need the whole program and only run from optimize(Tree&).
+class Optimizer {
+public:
+    Optimizer();
+
+    void optimize(Tree& tree);
+    // Local rewrites only: used when statements are streamed in one at a
+    // time, since a later statement may still read any variable.
+    void optimize(Tree& tree, NodeId statement);
+
+private:
+    struct SlotUse {
+        uint32_t reads = 0;
+        uint32_t stores = 0;
+        // Node holding the value of the last store (0 for a bare declaration)
+        NodeId value = 0;
+        bool bare = false;
+    };
+
+    Tree* tree;
+    std::vector<SlotUse> slots;
+    bool changed;
+
+    void simplifyStatement(NodeId node);
+    void simplifyIf(NodeId node);
+    void simplifyWhile(NodeId node);
+    void simplifyFor(NodeId node);
+    bool simplifyExpression(NodeId node);
+    bool foldUnary(NodeId node, Value& result);
+    bool foldBinary(NodeId node, Value& result);
+    void makeConstant(NodeId node, const Value& value);
+    const Value& constantOf(NodeId node) const;
+
+    void countUses(NodeId node);
+    void countStore(NodeId nameNode, NodeId value, bool bare);
+    void propagateConstants(NodeId node);
+    void removeDeadStores(NodeId node);
+    bool isDead(NodeId statement) const;
+    bool mayTrap(NodeId node) const;
+};
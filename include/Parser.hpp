@@ -1,52 +1,64 @@
 #pragma once
+#include <functional>
+#include <istream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include "Tree.hpp"
 #include "Token.hpp"
+#include "TokenStream.hpp"
 
 class Parser {
 private:
-    std::vector<TokenPtr> tokens;
-    size_t current;
+    std::unique_ptr<TokenStream> tokens;
     std::unordered_map<std::string, std::string> emojiMappings;
+    Tree* tree;
+    // Children collected for nodes that are still being parsed
+    std::vector<Child> pending;
     
     void initializeEmojiMappings();
-    TokenPtr peek();
-    TokenPtr advance();
-    bool match(const std::string& value);
-    bool check(const std::string& value);
+    const LexToken& peek();
+    LexToken advance();
+    std::string_view text(const LexToken& token) const;
+    Child leaf(const LexToken& token);
+    NodeId wrap(NodeKind kind, Child child);
+    NodeId addPending(NodeKind kind, size_t mark);
+    NodeId literal(NodeKind kind, const Value& value);
+    Value decodeNumber(const LexToken& token);
+    bool match(std::string_view value);
+    bool check(std::string_view value);
+    bool checkNext(std::string_view value);
     bool isAtEnd();
     
-    TreePtr parseStatement();
-    TreePtr parseSimpleStatement();
-    TreePtr parseCompoundStatement();
-    TreePtr parseAssignmentStatement();
-    TreePtr parseDeclareStatement();
-    TreePtr parseFlowStatement();
-    TreePtr parsePrintStatement();
-    TreePtr parseIfStatement();
-    TreePtr parseWhileStatement();
-    TreePtr parseForStatement();
-    TreePtr parseExpression();
-    TreePtr parseLogicalOrExpression();
-    TreePtr parseLogicalAndExpression();
-    TreePtr parseInclusiveOrExpression();
-    TreePtr parseExclusiveOrExpression();
-    TreePtr parseAndExpression();
-    TreePtr parseEqualityExpression();
-    TreePtr parseAdditiveExpression();
-    TreePtr parseMultiplicativeExpression();
-    TreePtr parseCastExpression();
-    TreePtr parseArgument();
-    TreePtr parseSuite();
-    TreePtr parseForDecl();
-    TreePtr parseForTest();
-    TreePtr parseForUpdates();
+    void parseProgram();
+    NodeId parseStatement();
+    NodeId parseAssignmentStatement();
+    NodeId parseDeclareStatement();
+    NodeId parseFlowStatement();
+    NodeId parsePrintStatement();
+    NodeId parseIfStatement();
+    NodeId parseWhileStatement();
+    NodeId parseForStatement();
+    NodeId parseSpawnStatement();
+    NodeId parseExpression();
+    NodeId parseBinaryExpression(int minPrecedence);
+    NodeId parseCastExpression();
+    NodeId parseArgument();
+    NodeId parseSuite();
+    NodeId parseForDecl();
+    NodeId parseForTest();
+    NodeId parseForUpdates();
     
 public:
     Parser();
-    std::vector<TokenPtr> tokenize(const std::string& text);
-    TreePtr parse(const std::string& text);
+    std::vector<LexToken> tokenize(std::string_view text);
+    Tree parse(std::string_view text);
+    // Parse program text pulled from `input` in chunks.
+    Tree parse(std::istream& input);
+    // Parse `input` one top-level statement at a time, handing each to
+    // `onStatement` as soon as it is complete instead of building a root.
+    // The tree is cleared after every statement.
+    void parse(std::istream& input, const std::function<void(Tree&, NodeId)>& onStatement);
 };
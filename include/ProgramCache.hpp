@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "Tree.hpp"
+
+// On-disk cache of compiled programs. An entry holds a program's tree as the
+// transformer, resolver and (if `optimized`) optimizer left it, in a compact
+// versioned binary encoding, in a file named after a hash of the source and
+// of the build's front end (the sources listed as EMOJILANG_FRONTEND in
+// CMakeLists.txt). Loading an entry skips lexing, parsing and analysis, but
+// the file is mapped only to be read: every node is copied into a new tree
+// and every leaf text is interned into its arena again, so nothing refers
+// to the mapping once load() returns.
+//
+// Entries that are truncated or corrupt, were written by a build with a
+// different front end, or belong to other source text are ignored; store() then
+// replaces them. load() checks every index and the shape of each node, so a
+// damaged entry cannot make an engine read out of bounds, but it does not
+// check what the program means: treat the directory as you would the
+// sources. Entries are written to a temporary file and renamed into
+// place, so concurrent readers and writers never see half an entry.
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string directory);
+
+    // Fills `tree` from the entry for `source`; false if there is no usable one
+    bool load(std::string_view source, bool optimized, Tree& tree) const;
+    // Best effort: a cache directory that cannot be written is skipped
+    void store(std::string_view source, bool optimized, const Tree& tree) const;
+    std::string entryPath(std::string_view source, bool optimized) const;
+
+private:
+    std::string directory;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "SymbolTable.hpp"
+#include "Tree.hpp"
+
+// Static scope resolution. Every name node gets the frame slot of the
+// declaration it refers to in its payload, and tree.frameSize is set to the
+// number of slots the program needs. A variable declared at scope depth d is
+// slot (d, i); because scopes nest lexically the base offset of each depth is
+// known here, so the pair is folded into one index into a flat frame.
+//
+// Undeclared and redeclared variables are reported here, before execution,
+// and so are stores a 🚀 block makes to variables declared outside it, and
+// break or continue statements that would leave one: a spawned task only
+// reads its snapshot of the enclosing variables.
+class Resolver {
+public:
+    Resolver();
+    
+    // Resolve a whole program in a fresh global scope.
+    void resolve(Tree& tree);
+    // Resolve one more top-level statement, keeping the global scope of
+    // earlier calls (used when statements are streamed in one at a time).
+    void resolve(Tree& tree, NodeId statement);
+    
+private:
+    SymbolTable symbols;
+    Tree* tree;
+    // First slot of each 🚀 block being resolved, innermost last
+    std::vector<uint32_t> taskStarts;
+    // Loops around the current statement, inside the innermost 🚀 block
+    uint32_t loopDepth;
+    
+    void resolveStatement(NodeId node);
+    void resolveStatements(NodeId node);
+    void resolveDeclare(NodeId node);
+    void resolveAssignment(NodeId node, bool isDeclaration);
+    void resolveIf(NodeId node);
+    void resolveWhile(NodeId node);
+    void resolveFor(NodeId node);
+    void resolveSpawn(NodeId node);
+    void resolveExpression(NodeId node);
+    
+    void declare(NodeId nameNode);
+    void bind(NodeId nameNode, const std::string& errorPrefix, const std::string& errorSuffix);
+    std::string nameOf(NodeId nameNode) const;
+    std::string position(NodeId nameNode) const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+// Line bookkeeping updated by the scanners that can cross newlines.
+struct LinePosition {
+    uint32_t line;
+    const char* lineStart;
+};
+
+enum class ScanLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Byte-run scanners used by the Lexer. Every kernel takes a half-open range
+// [p, end) and returns the first byte that does not belong to the run. The
+// vector implementations process 16 (SSE2) or 32 (AVX2) bytes per step and
+// fall back to the scalar loop for the tail.
+//
+// Kernels that pass over arbitrary text (comments, string literals) also
+// validate UTF-8: `invalidUtf8` is set to the first offending byte, and is
+// left untouched when the text is well formed.
+struct ScanKernels {
+    ScanLevel level;
+    const char* name;
+    const char* (*skipWhitespace)(const char* p, const char* end, LinePosition& position);
+    const char* (*skipToNewline)(const char* p, const char* end, const char*& invalidUtf8);
+    const char* (*findQuote)(const char* p, const char* end, LinePosition& position, const char*& invalidUtf8);
+    const char* (*scanIdentifier)(const char* p, const char* end);
+    const char* (*scanNumber)(const char* p, const char* end);
+
+    // Best implementation supported by the running CPU.
+    static const ScanKernels& best();
+    // A specific implementation, or nullptr when the CPU lacks support for it.
+    static const ScanKernels* forLevel(ScanLevel level);
+};
+
+// Length of the UTF-8 sequence starting at p, or 0 if it is malformed.
+int utf8SequenceLength(const char* p, const char* end);
+
+// First malformed byte in [p, end), or nullptr when the range is valid UTF-8.
+const char* validateUtf8(const char* p, const char* end);
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a program's source text. Files are memory-mapped where the
+// platform allows it, so the lexer can hand out string_views into the mapping
+// instead of copying the program line by line.
+class SourceBuffer {
+private:
+    const char* data;
+    size_t length;
+    bool isMapped;
+    std::string owned;
+
+public:
+    SourceBuffer();
+    explicit SourceBuffer(std::string text);
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+
+    static SourceBuffer fromFile(const std::string& path);
+
+    std::string_view text() const;
+    size_t size() const;
+
+private:
+    void release();
+};
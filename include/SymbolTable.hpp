@@ -1,25 +1,43 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <string>
-#include <variant>
 #include <iostream>
 
-using Value = std::variant<std::monostate, int, double, bool, std::string>;
-
+// Compile-time scope chain used by the Resolver. Each declaration is given a
+// slot in one flat frame; slots are handed out stack-wise, so a scope's
+// slots are reused once it is closed.
 class SymbolTable {
 private:
-    std::vector<std::unordered_map<std::string, Value>> table;
+    struct Scope {
+        std::unordered_map<std::string, uint32_t> symbols;
+        uint32_t firstSlot;
+    };
+    
+    std::vector<Scope> table;
+    uint32_t nextSlot;
+    uint32_t slotCount;
     bool isDebug;
 
 public:
+    static constexpr int32_t NOT_FOUND = -1;
+    
     SymbolTable(bool debug = false);
     
     void debugSymbolTable() const;
     void addScope();
-    void addSymbol(const std::string& symbol, const Value& value = Value{});
+    // Declare `symbol` in the innermost scope and return its slot.
+    uint32_t addSymbol(const std::string& symbol);
+    bool isDeclaredInScope(const std::string& symbol) const;
     int doesSymbolExist(const std::string& symbol) const;
-    void updateSymbol(const std::string& symbol, const Value& value);
-    Value getValue(const std::string& symbol) const;
+    // Slot of the innermost visible `symbol`, or NOT_FOUND.
+    int32_t getSlot(const std::string& symbol) const;
     void removeScope();
+    // First slot of the innermost scope; every slot below it is declared
+    // in an enclosing scope.
+    uint32_t scopeStart() const;
+    // Largest number of slots live at once so far.
+    uint32_t frameSize() const;
+    size_t depth() const;
 };
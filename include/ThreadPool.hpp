@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque of tasks: what a
+// worker submits goes to the back of its own deque, and it takes work from
+// the back again (newest first, while its data is still warm). A worker
+// whose deque is empty steals the oldest task from the front of another
+// one. Tasks submitted from outside the pool are dealt out round-robin.
+//
+// A task that throws does not take the pool down; the first exception is
+// rethrown by wait().
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t threads);
+    // Finishes every queued task first
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+    // Blocks until every submitted task has finished. Must not be called
+    // from a task; a task waiting for others uses runPending() instead.
+    void wait();
+    // Runs one queued task on the calling thread; false if none was queued.
+    bool runPending();
+    size_t size() const { return workers.size(); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> unfinished;
+    std::atomic<size_t> nextWorker;
+
+    // Guards sleeping, stopping and the stored exception
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+    bool stopping;
+    std::exception_ptr failure;
+
+    void workerLoop(size_t index);
+    bool take(size_t self, bool isWorker, Task& task);
+    void execute(Task& task);
+};
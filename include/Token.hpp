@@ -1,8 +1,10 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     STRING,
     NUMBER,
     NAME,
@@ -13,6 +15,21 @@ enum class TokenType {
     END_OF_FILE
 };
 
+// Compact token produced by the Lexer. It does not own its text; offset and
+// length index into the source buffer it was lexed from. Lines and columns
+// are 1-based, columns count bytes.
+struct LexToken {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t column;
+    TokenType type;
+    
+    std::string_view text(std::string_view source) const {
+        return source.substr(offset, length);
+    }
+};
+
 class Token {
 public:
     TokenType type;
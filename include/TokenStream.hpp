@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+// Pull-based token source for the Parser. Tokens are lexed on demand into a
+// small lookahead ring, so the whole token vector never exists at once.
+//
+// Over a string_view the stream simply walks the buffer. Over a std::istream
+// it reads fixed-size chunks into a sliding window that always ends at a line
+// boundary (only string literals may span lines; those grow the window until
+// they close). Consumed text is dropped on every refill, so memory stays at
+// roughly one chunk plus the current line.
+//
+// A token's text stays valid until the next call to peek().
+class TokenStream {
+public:
+    static constexpr size_t LOOKAHEAD = 3;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+    
+    explicit TokenStream(std::string_view source);
+    explicit TokenStream(std::istream& input, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    
+    TokenStream(const TokenStream&) = delete;
+    TokenStream& operator=(const TokenStream&) = delete;
+    
+    // Token `ahead` positions past the current one (0 = current).
+    const LexToken& peek(size_t ahead = 0);
+    LexToken advance();
+    std::string_view text(const LexToken& token) const;
+    
+private:
+    std::istream* input;
+    size_t chunkSize;
+    std::string buffer;
+    std::string_view window;
+    bool inputDone;
+    Lexer lexer;
+    
+    std::array<LexToken, LOOKAHEAD> ring;
+    size_t head;
+    size_t count;
+    LexToken previous;
+    
+    LexToken lexOne();
+    void refill(LexerState resume);
+};
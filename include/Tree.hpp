@@ -1,32 +1,149 @@
 #pragma once
+#include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <memory>
-#include <variant>
+#include "Arena.hpp"
 #include "Token.hpp"
+#include "Value.hpp"
 
-class Tree;
-using TreePtr = std::shared_ptr<Tree>;
-using TreeNode = std::variant<TreePtr, TokenPtr>;
+enum class NodeKind : uint8_t {
+    STMT,
+    SUITE,
+    DECLARE_STMT,
+    ASSIGNMENT_STMT,
+    PRINT_STMT,
+    IF_STMT,
+    WHILE_STMT,
+    FOR_STMT,
+    FOR_DECL,
+    FOR_TEST,
+    FOR_UPDATES,
+    FLOW_STMT,
+    BREAK_STMT,
+    CONTINUE_STMT,
+    SPAWN_STMT,
+    JOIN_STMT,
+    NAME,
+    NUMBER,
+    STRING,
+    BOOLEAN,
+    CONSTANT,
+    CASTEXPRESSION,
+    MULTIPLICATIVEEXPRESSION,
+    ADDITIVEEXPRESSION,
+    EQUALITYEXPRESSION,
+    ANDEXPRESSION,
+    EXCLUSIVEOREXPRESSION,
+    INCLUSIVEOREXPRESSION,
+    LOGICALANDEXPRESSION,
+    LOGICALOREXPRESSION,
+    EXP
+};
+
+// Grammar rule name of a kind, as printed by Tree::pretty.
+const char* nodeKindName(NodeKind kind);
+
+using NodeId = uint32_t;
+
+// Reference to a child slot: either another node or a token leaf.
+struct Child {
+    uint32_t index;
+    bool isLeaf;
+};
+
+// Token kept in the tree. `value` points into the tree's string arena, or
+// into static storage once the transformer has rewritten it.
+struct Leaf {
+    std::string_view value;
+    TokenType type;
+    uint32_t line;
+    uint32_t column;
+};
+
+// Children of a node occupy [firstChild, firstChild + childCount) in the
+// tree's shared child array. `payload` holds per-kind data: the constant
+// pool index for literals and constants (set by the Parser and Optimizer)
+// and the frame slot for names (set by the Resolver).
+struct Node {
+    NodeKind kind;
+    uint32_t firstChild;
+    uint32_t childCount;
+    uint32_t payload;
+};
+
+class ChildRange {
+public:
+    ChildRange(const Child* first, size_t count) : first(first), count(count) {}
+
+    const Child* begin() const { return first; }
+    const Child* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Child& operator[](size_t index) const { return first[index]; }
 
+private:
+    const Child* first;
+    size_t count;
+};
+
+// Flat, arena-backed syntax tree. Nodes, child slots and leaves live in three
+// contiguous arrays of trivially destructible records and refer to each other
+// by index; leaf text is copied into a StringArena. Dropping or clear()ing a
+// tree therefore frees a handful of buffers no matter how many nodes it has.
+//
+// A node's children must be complete before the node itself is added, which
+// is the order a recursive-descent parser produces them in.
 class Tree {
 public:
-    std::string data;
-    std::vector<TreeNode> children;
-    
-    Tree(const std::string& data_name);
-    Tree(const std::string& data_name, std::vector<TreeNode> child_nodes);
-    
-    void addChild(TreeNode child);
-    void addChild(const std::string& token_value);
-    void addChild(TokenPtr token);
-    void addChild(TreePtr tree);
-    
+    NodeId root;
+    // Number of variable slots a frame needs to run this tree (set by the Resolver)
+    uint32_t frameSize;
+    // Decoded literals, shared by every literal node with the same value
+    ConstantPool constants;
+
+    Tree();
+
+    Tree(const Tree&) = delete;
+    Tree& operator=(const Tree&) = delete;
+    Tree(Tree&&) noexcept = default;
+    Tree& operator=(Tree&&) noexcept = default;
+
+    NodeId addNode(NodeKind kind, std::initializer_list<Child> children = {});
+    NodeId addNode(NodeKind kind, const Child* children, size_t count);
+    Child addLeaf(TokenType type, std::string_view value, uint32_t line = 0, uint32_t column = 0);
+    // Rewrite a node in place with a new kind and child list; the old child
+    // slots are simply abandoned.
+    void replace(NodeId node, NodeKind kind, std::initializer_list<Child> children = {});
+    void replace(NodeId node, NodeKind kind, const Child* children, size_t count);
+
+    NodeKind kind(NodeId node) const { return nodes[node].kind; }
+    ChildRange children(NodeId node) const {
+        return ChildRange(childSlots.data() + nodes[node].firstChild, nodes[node].childCount);
+    }
+    size_t size(NodeId node) const { return nodes[node].childCount; }
+    uint32_t payload(NodeId node) const { return nodes[node].payload; }
+    void setPayload(NodeId node, uint32_t value) { nodes[node].payload = value; }
+    const Leaf& leaf(Child child) const { return leaves[child.index]; }
+    Leaf& leaf(Child child) { return leaves[child.index]; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t leafCount() const { return leaves.size(); }
+
+    void clear();
+
     std::string pretty(int indent = 0) const;
-    size_t size() const;
-    TreeNode& operator[](size_t index);
-    const TreeNode& operator[](size_t index) const;
-    
+    std::string pretty(NodeId node, int indent) const;
+
 private:
-    std::string prettyNode(const TreeNode& node, int indent) const;
+    std::vector<Node> nodes;
+    std::vector<Child> childSlots;
+    std::vector<Leaf> leaves;
+    StringArena strings;
+
+    void prettyNode(std::string& out, Child child, int indent) const;
 };
+
+inline Child nodeChild(NodeId node) {
+    return Child{node, false};
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Immutable, reference-counted string storage shared by every copy of a
+// string Value. The characters follow the header in the same allocation.
+struct StringData {
+    std::atomic<uint32_t> references;
+    uint32_t length;
+
+    static StringData* create(std::string_view text);
+
+    const char* chars() const { return reinterpret_cast<const char*>(this + 1); }
+    std::string_view view() const { return std::string_view(chars(), length); }
+    void retain() { references.fetch_add(1, std::memory_order_relaxed); }
+    void release();
+};
+
+// 16-byte tagged value. Numbers and booleans are stored inline, so copying
+// them is a plain copy of two words; strings are a pointer to a shared
+// StringData and copying one only bumps its reference count.
+class Value {
+public:
+    enum class Type : uint8_t {
+        NONE,
+        INT,
+        DOUBLE,
+        BOOL,
+        STRING
+    };
+
+    Value() noexcept : tag(Type::NONE) { data.bits = 0; }
+    Value(int number) noexcept : tag(Type::INT) { data.bits = 0; data.integer = number; }
+    Value(double number) noexcept : tag(Type::DOUBLE) { data.real = number; }
+    Value(bool flag) noexcept : tag(Type::BOOL) { data.bits = 0; data.boolean = flag; }
+    Value(std::string_view text) : tag(Type::STRING) { data.string = StringData::create(text); }
+    Value(const std::string& text) : Value(std::string_view(text)) {}
+    Value(const char* text) : Value(std::string_view(text)) {}
+
+    Value(const Value& other) noexcept : tag(other.tag), data(other.data) {
+        if (tag == Type::STRING) data.string->retain();
+    }
+    Value(Value&& other) noexcept : tag(other.tag), data(other.data) {
+        other.tag = Type::NONE;
+    }
+    ~Value() {
+        if (tag == Type::STRING) data.string->release();
+    }
+
+    Value& operator=(const Value& other) noexcept {
+        // Retain first so self-assignment cannot free the string
+        if (other.tag == Type::STRING) other.data.string->retain();
+        if (tag == Type::STRING) data.string->release();
+        tag = other.tag;
+        data = other.data;
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            if (tag == Type::STRING) data.string->release();
+            tag = other.tag;
+            data = other.data;
+            other.tag = Type::NONE;
+        }
+        return *this;
+    }
+
+    // In-place stores for the engines' hot paths; they write the tag and
+    // payload directly instead of moving in a temporary Value.
+    void setInt(int number) { clearString(); tag = Type::INT; data.bits = 0; data.integer = number; }
+    void setDouble(double number) { clearString(); tag = Type::DOUBLE; data.real = number; }
+    void setBool(bool flag) { clearString(); tag = Type::BOOL; data.bits = 0; data.boolean = flag; }
+
+    // Byte offsets of the tag and the payload, for compiled code that reads
+    // and writes values in place
+    static size_t tagOffset();
+    static size_t payloadOffset();
+
+    Type type() const { return tag; }
+    bool isNone() const { return tag == Type::NONE; }
+    bool isInt() const { return tag == Type::INT; }
+    bool isDouble() const { return tag == Type::DOUBLE; }
+    bool isBool() const { return tag == Type::BOOL; }
+    bool isString() const { return tag == Type::STRING; }
+
+    // Unchecked accessors; the caller has tested the type.
+    int asInt() const { return data.integer; }
+    double asDouble() const { return data.real; }
+    bool asBool() const { return data.boolean; }
+    std::string_view asString() const { return data.string->view(); }
+
+    // Conversions shared by every execution engine, so they agree on semantics.
+    std::string toString() const;
+    double toDouble() const {
+        switch (tag) {
+            case Type::INT: return static_cast<double>(data.integer);
+            case Type::DOUBLE: return data.real;
+            case Type::BOOL: return data.boolean ? 1.0 : 0.0;
+            case Type::STRING: return stringToDouble();
+            default: return 0.0;
+        }
+    }
+    bool toBool() const {
+        switch (tag) {
+            case Type::INT: return data.integer != 0;
+            case Type::DOUBLE: return data.real != 0.0;
+            case Type::BOOL: return data.boolean;
+            case Type::STRING: return stringToBool();
+            default: return false;
+        }
+    }
+    int toInt() const {
+        switch (tag) {
+            case Type::INT: return data.integer;
+            case Type::DOUBLE: return static_cast<int>(data.real);
+            case Type::BOOL: return data.boolean ? 1 : 0;
+            case Type::STRING: return stringToInt();
+            default: return 0;
+        }
+    }
+
+private:
+    Type tag;
+    union {
+        uint64_t bits;
+        int32_t integer;
+        double real;
+        bool boolean;
+        StringData* string;
+    } data;
+
+    void clearString() {
+        if (tag == Type::STRING) data.string->release();
+    }
+    double stringToDouble() const;
+    bool stringToBool() const;
+    int stringToInt() const;
+};
+
+static_assert(sizeof(Value) == 16, "Value should stay two words");
+
+enum class CompareOp {
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE
+};
+
+// Comparison operator for an operator token, in emoji or plain-text spelling.
+CompareOp compareOpFromText(std::string_view op);
+
+// Kernel for two operands of one primitive type (int, double, bool or
+// string_view): a single compare, no conversions.
+template <typename T>
+inline bool compareSame(CompareOp op, const T& left, const T& right) {
+    switch (op) {
+        case CompareOp::EQ: return left == right;
+        case CompareOp::NE: return left != right;
+        case CompareOp::LT: return left < right;
+        case CompareOp::LE: return left <= right;
+        case CompareOp::GT: return left > right;
+        case CompareOp::GE: return left >= right;
+    }
+    return false;
+}
+
+// Type pairs other than int/int; see compareValues.
+bool compareMixed(CompareOp op, const Value& left, const Value& right);
+
+// Numbers (int or double, in any mix) compare numerically, two booleans as
+// booleans and two strings lexicographically. Any other mix falls back to
+// the printed form for == and != and to numeric conversion for orderings.
+inline bool compareValues(CompareOp op, const Value& left, const Value& right) {
+    if (left.isInt() && right.isInt()) {
+        return compareSame(op, left.asInt(), right.asInt());
+    }
+    return compareMixed(op, left, right);
+}
+
+[[noreturn]] void throwModuloByZero();
+
+// `➕ ➖ ✖` on ints wrap around in two's complement, on every engine and in
+// the emitted C++, instead of overflowing a signed int.
+inline int addInt(int left, int right) {
+    return static_cast<int>(static_cast<uint32_t>(left) + static_cast<uint32_t>(right));
+}
+
+inline int subtractInt(int left, int right) {
+    return static_cast<int>(static_cast<uint32_t>(left) - static_cast<uint32_t>(right));
+}
+
+inline int multiplyInt(int left, int right) {
+    return static_cast<int>(static_cast<uint32_t>(left) * static_cast<uint32_t>(right));
+}
+
+// `📎` on ints. A zero divisor throws rather than trapping, and INT_MIN 📎 -1,
+// which overflows the hardware division, is 0 like every other x 📎 -1.
+inline int moduloInt(int left, int right) {
+    if (right == 0) throwModuloByZero();
+    return right == -1 ? 0 : left % right;
+}
+
+// Deduplicating pool of literal values: equal literals share one index.
+class ConstantPool {
+public:
+    uint32_t add(const Value& value);
+    const Value& operator[](uint32_t index) const { return values[index]; }
+    size_t size() const { return values.size(); }
+    const std::vector<Value>& all() const { return values; }
+    void clear();
+
+private:
+    std::vector<Value> values;
+    std::unordered_map<std::string, uint32_t> indices;
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include "Bytecode.hpp"
+
+// Executes a BytecodeProgram. Dispatch uses computed goto when the compiler
+// supports it (GCC, Clang) and a switch loop otherwise.
+class VirtualMachine {
+public:
+    explicit VirtualMachine(std::ostream& output = std::cout);
+    void run(const BytecodeProgram& program);
+    
+private:
+    std::ostream& output;
+    std::vector<Value> registers;
+};
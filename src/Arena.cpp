@@ -0,0 +1,35 @@
+#include "Arena.hpp"
+#include <cstring>
+
+StringArena::StringArena() : cursor(nullptr), remaining(0) {}
+
+std::string_view StringArena::store(std::string_view text) {
+    if (text.empty()) return std::string_view{};
+
+    if (text.size() > remaining) {
+        if (text.size() > BLOCK_SIZE / 4) {
+            // Large strings get a block of their own so the current one keeps filling
+            large.emplace_back(new char[text.size()]);
+            std::memcpy(large.back().get(), text.data(), text.size());
+            return std::string_view(large.back().get(), text.size());
+        }
+        blocks.emplace_back(new char[BLOCK_SIZE]);
+        cursor = blocks.back().get();
+        remaining = BLOCK_SIZE;
+    }
+
+    std::memcpy(cursor, text.data(), text.size());
+    std::string_view stored(cursor, text.size());
+    cursor += text.size();
+    remaining -= text.size();
+    return stored;
+}
+
+void StringArena::clear() {
+    large.clear();
+    if (blocks.empty()) return;
+
+    blocks.resize(1);
+    cursor = blocks.front().get();
+    remaining = BLOCK_SIZE;
+}
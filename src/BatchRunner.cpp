@@ -0,0 +1,85 @@
+#include "BatchRunner.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include "ThreadPool.hpp"
+
+namespace {
+
+struct FileResult {
+    std::string output;
+    std::string errors;
+    bool succeeded = false;
+    double seconds = 0;
+    bool finished = false;
+};
+
+} // namespace
+
+BatchRunner::BatchRunner(size_t jobs) : jobs(jobs) {}
+
+size_t BatchRunner::run(const std::vector<std::string>& files, const BatchJob& job, std::ostream& output,
+                        std::ostream& errors) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FileResult> results(files.size());
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    ThreadPool pool(jobs);
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.submit([&, i] {
+            std::ostringstream fileOutput;
+            std::ostringstream fileErrors;
+            auto fileStart = std::chrono::steady_clock::now();
+            bool succeeded = false;
+            try {
+                succeeded = job(files[i], fileOutput, fileErrors);
+            } catch (const std::exception& e) {
+                fileErrors << "ERROR in " << files[i] << ": " << e.what() << std::endl;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - fileStart;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            FileResult& result = results[i];
+            result.output = fileOutput.str();
+            result.errors = fileErrors.str();
+            result.succeeded = succeeded;
+            result.seconds = elapsed.count();
+            result.finished = true;
+            finished.notify_all();
+        });
+    }
+
+    // Write each file out as soon as everything before it is done
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::string fileOutput;
+        std::string fileErrors;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return results[i].finished; });
+            fileOutput = std::move(results[i].output);
+            fileErrors = std::move(results[i].errors);
+        }
+        output << fileOutput << std::flush;
+        errors << fileErrors << std::flush;
+    }
+    pool.wait();
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    size_t failed = 0;
+    for (const FileResult& result : results) {
+        failed += result.succeeded ? 0 : 1;
+    }
+    std::ostringstream summary;
+    summary << "SUMMARY: " << files.size() << " files, " << files.size() - failed << " ok, " << failed
+            << " failed, " << pool.size() << " jobs, " << std::fixed << std::setprecision(1) << wall.count() * 1e3
+            << " ms wall" << std::endl;
+    for (size_t i = 0; i < files.size(); ++i) {
+        summary << "  " << std::left << std::setw(7) << (results[i].succeeded ? "ok" : "FAILED") << std::right
+                << std::setw(10) << std::setprecision(2) << results[i].seconds * 1e3 << " ms  " << files[i] << std::endl;
+    }
+    output << summary.str() << std::flush;
+    return failed;
+}
@@ -0,0 +1,70 @@
+#include "Bytecode.hpp"
+#include <iomanip>
+#include <sstream>
+
+const char* opCodeName(OpCode op) {
+    switch (op) {
+        case OpCode::MOVE: return "MOVE";
+        case OpCode::ADD: return "ADD";
+        case OpCode::SUB: return "SUB";
+        case OpCode::MUL: return "MUL";
+        case OpCode::DIV: return "DIV";
+        case OpCode::MOD: return "MOD";
+        case OpCode::EQ: return "EQ";
+        case OpCode::NE: return "NE";
+        case OpCode::LT: return "LT";
+        case OpCode::LE: return "LE";
+        case OpCode::GT: return "GT";
+        case OpCode::GE: return "GE";
+        case OpCode::BAND: return "BAND";
+        case OpCode::BOR: return "BOR";
+        case OpCode::BXOR: return "BXOR";
+        case OpCode::AND: return "AND";
+        case OpCode::OR: return "OR";
+        case OpCode::NOT: return "NOT";
+        case OpCode::BNOT: return "BNOT";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::PRINT: return "PRINT";
+        case OpCode::HALT: return "HALT";
+    }
+    return "?";
+}
+
+std::string BytecodeProgram::disassemble() const {
+    std::ostringstream out;
+    
+    for (size_t i = 0; i < constants.size(); ++i) {
+        out << "K" << i << " = " << constants[i].toString() << "\n";
+    }
+    
+    for (size_t pc = 0; pc < code.size(); ++pc) {
+        const Instruction& ins = code[pc];
+        out << std::setw(5) << pc << "  " << std::left << std::setw(14) << opCodeName(ins.op) << std::right;
+        
+        switch (ins.op) {
+            case OpCode::JUMP:
+                out << "-> " << ins.b;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                out << "R" << ins.a << " -> " << ins.b;
+                break;
+            case OpCode::PRINT:
+                out << "R" << ins.a;
+                break;
+            case OpCode::MOVE:
+            case OpCode::NOT:
+            case OpCode::BNOT:
+                out << "R" << ins.a << " R" << ins.b;
+                break;
+            case OpCode::HALT:
+                break;
+            default:
+                out << "R" << ins.a << " R" << ins.b << " R" << ins.c;
+                break;
+        }
+        out << "\n";
+    }
+    
+    return out.str();
+}
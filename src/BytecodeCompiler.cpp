@@ -0,0 +1,393 @@
+#include "BytecodeCompiler.hpp"
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+bool isBinaryExpression(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Accepts the same spellings as the tree-walking interpreter, before or after
+// the EmojiTransformer has run.
+OpCode binaryOpCode(NodeKind kind, std::string_view op) {
+    switch (kind) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") return OpCode::ADD;
+            if (op == "-" || op == "➖") return OpCode::SUB;
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") return OpCode::MUL;
+            if (op == "/" || op == "➗") return OpCode::DIV;
+            if (op == "%" || op == "mod" || op == "📎") return OpCode::MOD;
+            break;
+        case NodeKind::EQUALITYEXPRESSION:
+            switch (compareOpFromText(op)) {
+                case CompareOp::EQ: return OpCode::EQ;
+                case CompareOp::NE: return OpCode::NE;
+                case CompareOp::LT: return OpCode::LT;
+                case CompareOp::LE: return OpCode::LE;
+                case CompareOp::GT: return OpCode::GT;
+                case CompareOp::GE: return OpCode::GE;
+            }
+            break;
+        case NodeKind::ANDEXPRESSION:
+            if (op == "&" || op == "⚛") return OpCode::BAND;
+            break;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op == "|" || op == "☯") return OpCode::BOR;
+            break;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op == "^" || op == "xor" || op == "⚓") return OpCode::BXOR;
+            break;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op == "&&" || op == "and" || op == "😠") return OpCode::AND;
+            break;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op == "||" || op == "or" || op == "😇") return OpCode::OR;
+            break;
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator '" + std::string(op) + "' in " + nodeKindName(kind));
+}
+
+bool writesRegisterA(OpCode op) {
+    return op != OpCode::JUMP && op != OpCode::JUMP_IF_FALSE && op != OpCode::PRINT && op != OpCode::HALT;
+}
+
+} // namespace
+
+BytecodeProgram BytecodeCompiler::compile(const Tree& source) {
+    tree = &source;
+    program = BytecodeProgram{};
+    scopes.clear();
+    jumpTargets.clear();
+    
+    // The tree's literals keep their pool indices; 0 and true are needed for
+    // bare declarations and empty for tests. No constants are added after this.
+    constants = tree->constants;
+    constants.add(Value(0));
+    constants.add(Value(true));
+    program.constants = constants.all();
+    firstVariable = static_cast<uint32_t>(program.constants.size());
+    nextRegister = firstVariable;
+    program.registerCount = firstVariable + tree->frameSize;
+    
+    enterScope();
+    if (tree->nodeCount() > 0) {
+        if (tree->kind(tree->root) == NodeKind::STMT) {
+            for (const Child& statement : tree->children(tree->root)) {
+                compileTopLevel(statement.index);
+            }
+        } else {
+            compileTopLevel(tree->root);
+        }
+    }
+    exitScope();
+    
+    emit(OpCode::HALT);
+    tree = nullptr;
+    return std::move(program);
+}
+
+uint32_t BytecodeCompiler::constant(const Value& value) {
+    return constants.add(value);
+}
+
+uint32_t BytecodeCompiler::literal(NodeId node) {
+    return tree->payload(node);
+}
+
+void BytecodeCompiler::enterScope() {
+    scopes.push_back(nextRegister);
+}
+
+void BytecodeCompiler::exitScope() {
+    nextRegister = scopes.back();
+    scopes.pop_back();
+}
+
+uint32_t BytecodeCompiler::declare(NodeId nameNode) {
+    // Slots are handed out in the same stack order, so this is the next free register
+    uint32_t reg = variable(nameNode);
+    nextRegister = reg + 1;
+    return reg;
+}
+
+uint32_t BytecodeCompiler::variable(NodeId nameNode) const {
+    return firstVariable + tree->payload(nameNode);
+}
+
+uint32_t BytecodeCompiler::allocateRegister() {
+    uint32_t reg = nextRegister++;
+    if (nextRegister > program.registerCount) {
+        program.registerCount = nextRegister;
+    }
+    return reg;
+}
+
+size_t BytecodeCompiler::emit(OpCode op, uint32_t a, uint32_t b, uint32_t c) {
+    program.code.push_back(Instruction{op, a, b, c});
+    return program.code.size() - 1;
+}
+
+void BytecodeCompiler::patchJumps(const std::vector<size_t>& jumps, size_t target) {
+    for (size_t jump : jumps) {
+        program.code[jump].b = static_cast<uint32_t>(target);
+    }
+}
+
+void BytecodeCompiler::compileTopLevel(NodeId node) {
+    // A break or continue outside any loop skips the rest of its top-level statement
+    jumpTargets.emplace_back();
+    compileStatement(node);
+    patchJumps(jumpTargets.back().breakJumps, program.code.size());
+    patchJumps(jumpTargets.back().continueJumps, program.code.size());
+    jumpTargets.pop_back();
+}
+
+void BytecodeCompiler::compileStatement(NodeId node) {
+    uint32_t firstTemporary = nextRegister;
+    
+    switch (tree->kind(node)) {
+        case NodeKind::DECLARE_STMT:
+            compileDeclare(node);
+            return; // keeps the registers it declared
+        case NodeKind::ASSIGNMENT_STMT:
+            compileAssignment(node, false);
+            break;
+        case NodeKind::PRINT_STMT:
+            emit(OpCode::PRINT, compileExpression(tree->children(node)[0].index));
+            break;
+        case NodeKind::IF_STMT:
+            compileIf(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            compileWhile(node);
+            break;
+        case NodeKind::FOR_STMT:
+            compileFor(node);
+            break;
+        case NodeKind::FLOW_STMT:
+            compileFlow(node);
+            break;
+        case NodeKind::SUITE:
+            compileSuite(node);
+            break;
+        case NodeKind::SPAWN_STMT:
+        case NodeKind::JOIN_STMT:
+            throw std::runtime_error("Cannot compile '🚀' or '🤝': tasks only run on the tree walker");
+        default:
+            compileExpression(node); // evaluated for its errors only
+            break;
+    }
+    
+    nextRegister = firstTemporary;
+}
+
+void BytecodeCompiler::compileSuite(NodeId node) {
+    for (const Child& statement : tree->children(node)) {
+        compileStatement(statement.index);
+    }
+}
+
+void BytecodeCompiler::compileDeclare(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+            compileAssignment(child.index, true);
+        } else {
+            emit(OpCode::MOVE, declare(child.index), constant(Value(0)));
+        }
+    }
+}
+
+void BytecodeCompiler::compileAssignment(NodeId node, bool isDeclaration) {
+    auto children = tree->children(node);
+    
+    // The value is compiled first, so "📢 x 😌 x" still reads an outer x
+    uint32_t firstTemporary = nextRegister;
+    uint32_t value = compileExpression(children[1].index);
+    nextRegister = firstTemporary;
+    
+    uint32_t target = isDeclaration
+        ? declare(children[0].index)
+        : variable(children[0].index);
+    storeInto(target, value, firstTemporary);
+}
+
+void BytecodeCompiler::storeInto(uint32_t target, uint32_t source, uint32_t firstTemporary) {
+    if (source == target) return;
+    
+    // Let the instruction that produced a temporary write the target directly
+    if (source >= firstTemporary && !program.code.empty()) {
+        Instruction& last = program.code.back();
+        if (writesRegisterA(last.op) && last.a == source) {
+            last.a = target;
+            return;
+        }
+    }
+    emit(OpCode::MOVE, target, source);
+}
+
+void BytecodeCompiler::compileIf(NodeId node) {
+    auto children = tree->children(node);
+    std::vector<size_t> endJumps;
+    
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree->leaf(children[i]).value;
+        
+        if (keyword == "else" || keyword == "🏁") {
+            enterScope();
+            compileSuite(children[i + 1].index);
+            exitScope();
+            break;
+        }
+        
+        uint32_t firstTemporary = nextRegister;
+        uint32_t condition = compileExpression(children[i + 1].index);
+        nextRegister = firstTemporary;
+        size_t skip = emit(OpCode::JUMP_IF_FALSE, condition);
+        
+        enterScope();
+        compileSuite(children[i + 2].index);
+        exitScope();
+        
+        i += 3;
+        if (i < children.size()) {
+            endJumps.push_back(emit(OpCode::JUMP));
+        }
+        program.code[skip].b = static_cast<uint32_t>(program.code.size());
+    }
+    
+    patchJumps(endJumps, program.code.size());
+}
+
+void BytecodeCompiler::compileWhile(NodeId node) {
+    auto children = tree->children(node);
+    size_t top = program.code.size();
+    
+    uint32_t firstTemporary = nextRegister;
+    uint32_t condition = compileExpression(children[0].index);
+    nextRegister = firstTemporary;
+    size_t exit = emit(OpCode::JUMP_IF_FALSE, condition);
+    
+    jumpTargets.emplace_back();
+    enterScope();
+    compileSuite(children[1].index);
+    exitScope();
+    emit(OpCode::JUMP, 0, static_cast<uint32_t>(top));
+    
+    program.code[exit].b = static_cast<uint32_t>(program.code.size());
+    patchJumps(jumpTargets.back().breakJumps, program.code.size());
+    patchJumps(jumpTargets.back().continueJumps, top);
+    jumpTargets.pop_back();
+}
+
+void BytecodeCompiler::compileFor(NodeId node) {
+    auto children = tree->children(node);
+    NodeId decl = children[0].index;
+    NodeId test = children[1].index;
+    NodeId updates = children[2].index;
+    
+    enterScope();
+    for (const Child& init : tree->children(decl)) {
+        compileStatement(init.index);
+    }
+    
+    size_t top = program.code.size();
+    size_t exit = SIZE_MAX;
+    if (tree->size(test) > 0) {
+        uint32_t firstTemporary = nextRegister;
+        uint32_t condition = compileExpression(tree->children(test)[0].index);
+        nextRegister = firstTemporary;
+        exit = emit(OpCode::JUMP_IF_FALSE, condition);
+    }
+    
+    jumpTargets.emplace_back();
+    enterScope();
+    compileSuite(children[3].index);
+    exitScope();
+    
+    size_t next = program.code.size();
+    for (const Child& update : tree->children(updates)) {
+        compileStatement(update.index);
+    }
+    emit(OpCode::JUMP, 0, static_cast<uint32_t>(top));
+    
+    size_t end = program.code.size();
+    if (exit != SIZE_MAX) {
+        program.code[exit].b = static_cast<uint32_t>(end);
+    }
+    patchJumps(jumpTargets.back().breakJumps, end);
+    patchJumps(jumpTargets.back().continueJumps, next);
+    jumpTargets.pop_back();
+    exitScope();
+}
+
+void BytecodeCompiler::compileFlow(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::BREAK_STMT) {
+            jumpTargets.back().breakJumps.push_back(emit(OpCode::JUMP));
+        } else if (tree->kind(child.index) == NodeKind::CONTINUE_STMT) {
+            jumpTargets.back().continueJumps.push_back(emit(OpCode::JUMP));
+        }
+    }
+}
+
+uint32_t BytecodeCompiler::compileExpression(NodeId node) {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+    
+    if (kind == NodeKind::NAME) {
+        return variable(node);
+    }
+    if (kind == NodeKind::NUMBER || kind == NodeKind::STRING || kind == NodeKind::BOOLEAN ||
+        kind == NodeKind::CONSTANT) {
+        return literal(node);
+    }
+    
+    uint32_t firstTemporary = nextRegister;
+    
+    if (kind == NodeKind::CASTEXPRESSION) {
+        if (children.size() == 1) {
+            return compileExpression(children[0].index);
+        }
+        std::string_view op = tree->leaf(children[0]).value;
+        uint32_t operand = compileExpression(children[1].index);
+        nextRegister = firstTemporary;
+        uint32_t result = allocateRegister();
+        bool isNot = op == "!" || op == "not" || op == "❗";
+        emit(isNot ? OpCode::NOT : OpCode::BNOT, result, operand);
+        return result;
+    }
+    
+    if (isBinaryExpression(kind)) {
+        OpCode op = binaryOpCode(kind, tree->leaf(children[1]).value);
+        uint32_t left = compileExpression(children[0].index);
+        uint32_t right = compileExpression(children[2].index);
+        nextRegister = firstTemporary;
+        uint32_t result = allocateRegister();
+        emit(op, result, left, right);
+        return result;
+    }
+    
+    if (kind == NodeKind::EXP && !children.empty()) {
+        return compileExpression(children[0].index);
+    }
+    
+    throw std::runtime_error(std::string("Cannot compile '") + nodeKindName(kind) + "' as an expression");
+}
@@ -0,0 +1,563 @@
+#include "ClosureCompiler.hpp"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Operand fetchers. Each returns the operand's value, using `scratch` only
+// when it has to compute one.
+struct SlotOperand {
+    uint32_t slot;
+    const Value& operator()(ClosureContext& context, Value&) const { return context.frame[slot]; }
+};
+
+struct ConstantOperand {
+    Value value;
+    const Value& operator()(ClosureContext&, Value&) const { return value; }
+};
+
+// Int literal on the right of an operator: its type is known, so the
+// operators below skip testing it
+struct IntOperand {
+    int value;
+    int operator()(ClosureContext&, Value&) const { return value; }
+};
+
+struct NestedOperand {
+    ClosureExpression code;
+    const Value& operator()(ClosureContext& context, Value& scratch) const {
+        scratch = code(context);
+        return scratch;
+    }
+};
+
+// The interpreter's conversions, for a Value or a known int
+inline bool isInt(const Value& value) { return value.isInt(); }
+inline bool isInt(int) { return true; }
+inline int asInt(const Value& value) { return value.asInt(); }
+inline int asInt(int value) { return value; }
+inline int toInt(const Value& value) { return value.toInt(); }
+inline int toInt(int value) { return value; }
+inline double toDouble(const Value& value) { return value.toDouble(); }
+inline double toDouble(int value) { return value; }
+inline bool toBool(const Value& value) { return value.toBool(); }
+inline bool toBool(int value) { return value != 0; }
+
+struct Add {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const {
+        if (isInt(left) && isInt(right)) return addInt(asInt(left), asInt(right));
+        return toDouble(left) + toDouble(right);
+    }
+};
+
+struct Subtract {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const {
+        if (isInt(left) && isInt(right)) return subtractInt(asInt(left), asInt(right));
+        return toDouble(left) - toDouble(right);
+    }
+};
+
+struct Multiply {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const {
+        if (isInt(left) && isInt(right)) return multiplyInt(asInt(left), asInt(right));
+        return toDouble(left) * toDouble(right);
+    }
+};
+
+struct Divide {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toDouble(left) / toDouble(right); }
+};
+
+struct Modulo {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return moduloInt(toInt(left), toInt(right)); }
+};
+
+struct BitAnd {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toInt(left) & toInt(right); }
+};
+
+struct BitXor {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toInt(left) ^ toInt(right); }
+};
+
+struct BitOr {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toInt(left) | toInt(right); }
+};
+
+// Both sides are always evaluated, as in the tree walker
+struct LogicalAnd {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toBool(left) && toBool(right); }
+};
+
+struct LogicalOr {
+    template <typename R>
+    Value operator()(const Value& left, const R& right) const { return toBool(left) || toBool(right); }
+};
+
+template <CompareOp OP>
+struct Compare {
+    bool operator()(const Value& left, const Value& right) const { return compareValues(OP, left, right); }
+    bool operator()(const Value& left, int right) const {
+        if (left.isInt()) return compareSame(OP, left.asInt(), right);
+        return compareMixed(OP, left, Value(right));
+    }
+};
+
+// Calls `make` with the fetcher for one operand. `nested` is the operand's
+// compiled expression, used when it is neither a variable nor a literal.
+template <typename Make>
+auto withOperand(const Tree& tree, Child child, ClosureExpression nested, bool allowInt, Make make) {
+    if (!child.isLeaf) {
+        switch (tree.kind(child.index)) {
+            case NodeKind::NAME:
+                return make(SlotOperand{tree.payload(child.index)});
+            case NodeKind::NUMBER:
+            case NodeKind::STRING:
+            case NodeKind::BOOLEAN:
+            case NodeKind::CONSTANT: {
+                const Value& value = tree.constants[tree.payload(child.index)];
+                if (allowInt && value.isInt()) {
+                    return make(IntOperand{value.asInt()});
+                }
+                return make(ConstantOperand{value});
+            }
+            default:
+                break;
+        }
+    }
+    return make(NestedOperand{std::move(nested)});
+}
+
+// One closure per operator and operand shape
+template <typename Result, typename Op>
+Result makeBinary(const Tree& tree, Child left, Child right, ClosureExpression nestedLeft,
+                  ClosureExpression nestedRight, Op op) {
+    return withOperand(tree, left, std::move(nestedLeft), false, [&](auto leftOperand) {
+        return withOperand(tree, right, std::move(nestedRight), true, [&](auto rightOperand) -> Result {
+            return [leftOperand, rightOperand, op](ClosureContext& context) {
+                Value leftScratch;
+                Value rightScratch;
+                auto&& leftValue = leftOperand(context, leftScratch);
+                auto&& rightValue = rightOperand(context, rightScratch);
+                return op(leftValue, rightValue);
+            };
+        });
+    });
+}
+
+template <typename Result>
+Result makeCompare(CompareOp op, const Tree& tree, Child left, Child right, ClosureExpression nestedLeft,
+                   ClosureExpression nestedRight) {
+    switch (op) {
+        case CompareOp::EQ: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::EQ>{});
+        case CompareOp::NE: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::NE>{});
+        case CompareOp::LT: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::LT>{});
+        case CompareOp::LE: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::LE>{});
+        case CompareOp::GT: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::GT>{});
+        case CompareOp::GE: return makeBinary<Result>(tree, left, right, nestedLeft, nestedRight, Compare<CompareOp::GE>{});
+    }
+    throw std::runtime_error("Unknown comparison operator");
+}
+
+bool isOperand(const Tree& tree, Child child) {
+    if (child.isLeaf) {
+        return false;
+    }
+    switch (tree.kind(child.index)) {
+        case NodeKind::NAME:
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Runs statements in order and ignores how they complete, like the walker
+// does for the top level, for_decl and for_updates
+ClosureStatement sequence(std::vector<ClosureStatement> statements) {
+    return [statements = std::move(statements)](ClosureContext& context) {
+        for (const ClosureStatement& statement : statements) {
+            statement(context);
+        }
+        return Completion::NORMAL;
+    };
+}
+
+} // namespace
+
+void ClosureProgram::run(std::ostream& output) const {
+    std::vector<Value> frame(frameSize);
+    ClosureContext context{frame.data(), output};
+    if (body) {
+        body(context);
+    }
+    output.flush();
+}
+
+ClosureProgram ClosureCompiler::compile(const Tree& source) {
+    tree = &source;
+    ClosureProgram program;
+    if (tree->nodeCount() > 0) {
+        program.frameSize = tree->frameSize;
+        program.body = statement(tree->root);
+    }
+    return program;
+}
+
+ClosureStatement ClosureCompiler::statement(NodeId node) {
+    auto children = tree->children(node);
+    switch (tree->kind(node)) {
+        case NodeKind::STMT:
+        case NodeKind::FOR_DECL:
+        case NodeKind::FOR_UPDATES: {
+            std::vector<ClosureStatement> statements;
+            for (const Child& child : children) {
+                if (!child.isLeaf) {
+                    statements.push_back(statement(child.index));
+                }
+            }
+            return sequence(std::move(statements));
+        }
+        case NodeKind::SUITE:
+            return suite(node);
+        case NodeKind::SPAWN_STMT:
+        case NodeKind::JOIN_STMT:
+            throw std::runtime_error("Cannot compile '🚀' or '🤝' to closures: tasks only run on the tree walker");
+        case NodeKind::PRINT_STMT: {
+            if (children.empty()) {
+                return [](ClosureContext&) { return Completion::NORMAL; };
+            }
+            ClosureExpression value = expression(children[0]);
+            return [value](ClosureContext& context) {
+                context.output << value(context).toString() << '\n';
+                return Completion::NORMAL;
+            };
+        }
+        case NodeKind::ASSIGNMENT_STMT:
+            return assignment(node);
+        case NodeKind::DECLARE_STMT:
+            return declareStatement(node);
+        case NodeKind::IF_STMT:
+            return ifStatement(node);
+        case NodeKind::WHILE_STMT:
+            return whileStatement(node);
+        case NodeKind::FOR_STMT:
+            return forStatement(node);
+        case NodeKind::FLOW_STMT: {
+            Completion completion = Completion::NORMAL;
+            for (const Child& child : children) {
+                if (!child.isLeaf) {
+                    NodeKind kind = tree->kind(child.index);
+                    if (kind == NodeKind::BREAK_STMT) {
+                        completion = Completion::BREAK;
+                        break;
+                    } else if (kind == NodeKind::CONTINUE_STMT) {
+                        completion = Completion::CONTINUE;
+                        break;
+                    }
+                }
+            }
+            return [completion](ClosureContext&) { return completion; };
+        }
+        default: {
+            // A bare expression used as a statement
+            ClosureExpression value = expression(nodeChild(node));
+            return [value](ClosureContext& context) {
+                value(context);
+                return Completion::NORMAL;
+            };
+        }
+    }
+}
+
+ClosureStatement ClosureCompiler::suite(NodeId node) {
+    std::vector<ClosureStatement> statements;
+    for (const Child& child : tree->children(node)) {
+        if (!child.isLeaf) {
+            statements.push_back(statement(child.index));
+        }
+    }
+    return [statements = std::move(statements)](ClosureContext& context) {
+        for (const ClosureStatement& statement : statements) {
+            Completion completion = statement(context);
+            if (completion != Completion::NORMAL) {
+                return completion;
+            }
+        }
+        return Completion::NORMAL;
+    };
+}
+
+ClosureStatement ClosureCompiler::ifStatement(NodeId node) {
+    struct Branch {
+        ClosureCondition condition;
+        ClosureStatement body;
+    };
+    std::vector<Branch> branches;
+    ClosureStatement otherwise;
+
+    auto children = tree->children(node);
+    for (size_t i = 0; i < children.size() && !otherwise; ++i) {
+        if (children[i].isLeaf) {
+            std::string_view token = tree->leaf(children[i]).value;
+            if (token == "if" || token == "elif" || token == "🚩" || token == "🏳") {
+                if (i + 2 < children.size()) {
+                    branches.push_back({condition(children[i + 1]), statement(children[i + 2].index)});
+                }
+            } else if (token == "else" || token == "🏁") {
+                if (i + 1 < children.size()) {
+                    otherwise = statement(children[i + 1].index);
+                }
+            }
+        }
+    }
+
+    return [branches = std::move(branches), otherwise](ClosureContext& context) {
+        for (const Branch& branch : branches) {
+            if (branch.condition(context)) {
+                return branch.body(context);
+            }
+        }
+        return otherwise ? otherwise(context) : Completion::NORMAL;
+    };
+}
+
+ClosureStatement ClosureCompiler::whileStatement(NodeId node) {
+    auto children = tree->children(node);
+    if (children.size() < 2) {
+        return [](ClosureContext&) { return Completion::NORMAL; };
+    }
+    ClosureCondition test = condition(children[0]);
+    ClosureStatement body = statement(children[1].index);
+    return [test, body](ClosureContext& context) {
+        while (test(context)) {
+            if (body(context) == Completion::BREAK) {
+                break;
+            }
+        }
+        return Completion::NORMAL;
+    };
+}
+
+ClosureStatement ClosureCompiler::forStatement(NodeId node) {
+    auto children = tree->children(node);
+    if (children.size() < 4) {
+        return [](ClosureContext&) { return Completion::NORMAL; };
+    }
+    ClosureStatement decl = statement(children[0].index);
+    auto testChildren = tree->children(children[1].index);
+    ClosureCondition test = testChildren.empty()
+        ? ClosureCondition([](ClosureContext&) { return true; })
+        : condition(testChildren[0]);
+    ClosureStatement updates = statement(children[2].index);
+    ClosureStatement body = statement(children[3].index);
+    return [decl, test, updates, body](ClosureContext& context) {
+        decl(context);
+        while (test(context)) {
+            // CONTINUE falls through to the updates, like in C
+            if (body(context) == Completion::BREAK) {
+                break;
+            }
+            updates(context);
+        }
+        return Completion::NORMAL;
+    };
+}
+
+ClosureStatement ClosureCompiler::declareStatement(NodeId node) {
+    std::vector<ClosureStatement> statements;
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::NAME) {
+            uint32_t slot = tree->payload(child.index);
+            statements.push_back([slot](ClosureContext& context) {
+                context.frame[slot].setInt(0);
+                return Completion::NORMAL;
+            });
+        } else {
+            statements.push_back(statement(child.index));
+        }
+    }
+    return sequence(std::move(statements));
+}
+
+ClosureStatement ClosureCompiler::assignment(NodeId node) {
+    auto children = tree->children(node);
+    if (children.size() < 2) {
+        return [](ClosureContext&) { return Completion::NORMAL; };
+    }
+    uint32_t slot = tree->payload(children[0].index);
+    Child value = children[1];
+
+    if (isOperand(*tree, value) && tree->kind(value.index) == NodeKind::NAME) {
+        uint32_t source = tree->payload(value.index);
+        return [slot, source](ClosureContext& context) {
+            context.frame[slot] = context.frame[source];
+            return Completion::NORMAL;
+        };
+    }
+    if (isOperand(*tree, value)) {
+        Value constant = tree->constants[tree->payload(value.index)];
+        return [slot, constant](ClosureContext& context) {
+            context.frame[slot] = constant;
+            return Completion::NORMAL;
+        };
+    }
+    ClosureExpression code = expression(value);
+    return [slot, code](ClosureContext& context) {
+        context.frame[slot] = code(context);
+        return Completion::NORMAL;
+    };
+}
+
+ClosureExpression ClosureCompiler::expression(Child child) {
+    if (child.isLeaf) {
+        Value text = std::string(tree->leaf(child).value);
+        return [text](ClosureContext&) { return text; };
+    }
+
+    NodeId node = child.index;
+    auto children = tree->children(node);
+    switch (tree->kind(node)) {
+        case NodeKind::NAME: {
+            uint32_t slot = tree->payload(node);
+            return [slot](ClosureContext& context) { return context.frame[slot]; };
+        }
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT: {
+            Value constant = tree->constants[tree->payload(node)];
+            return [constant](ClosureContext&) { return constant; };
+        }
+        case NodeKind::CASTEXPRESSION: {
+            if (children.size() == 1) {
+                return expression(children[0]);
+            }
+            if (children.size() == 2) {
+                std::string_view op = tree->leaf(children[0]).value;
+                ClosureExpression operand = expression(children[1]);
+                if (op == "!" || op == "not" || op == "❗") {
+                    return [operand](ClosureContext& context) { return Value(!operand(context).toBool()); };
+                } else if (op == "~" || op == "〰") {
+                    return [operand](ClosureContext& context) { return Value(~operand(context).toInt()); };
+                }
+            }
+            return [](ClosureContext&) { return Value{}; };
+        }
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return binary(node);
+        case NodeKind::EXP:
+        case NodeKind::FOR_TEST:
+            if (!children.empty()) {
+                return expression(children[0]);
+            }
+            if (tree->kind(node) == NodeKind::FOR_TEST) {
+                return [](ClosureContext&) { return Value(true); };
+            }
+            return [](ClosureContext&) { return Value{}; };
+        default:
+            throw std::runtime_error(std::string("Cannot evaluate ") + nodeKindName(tree->kind(node)) + " as an expression");
+    }
+}
+
+ClosureExpression ClosureCompiler::binary(NodeId node) {
+    auto children = tree->children(node);
+    if (children.size() != 3) {
+        throw std::runtime_error(std::string("Malformed ") + nodeKindName(tree->kind(node)));
+    }
+    Child left = children[0];
+    Child right = children[2];
+    std::string_view op = tree->leaf(children[1]).value;
+    ClosureExpression nestedLeft = isOperand(*tree, left) ? nullptr : expression(left);
+    ClosureExpression nestedRight = isOperand(*tree, right) ? nullptr : expression(right);
+
+    auto make = [&](auto function) {
+        return makeBinary<ClosureExpression>(*tree, left, right, nestedLeft, nestedRight, function);
+    };
+    switch (tree->kind(node)) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") return make(Add{});
+            if (op == "-" || op == "➖") return make(Subtract{});
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") return make(Multiply{});
+            if (op == "/" || op == "➗") return make(Divide{});
+            if (op == "%" || op == "mod" || op == "📎") return make(Modulo{});
+            break;
+        case NodeKind::EQUALITYEXPRESSION:
+            return makeCompare<ClosureExpression>(compareOpFromText(op), *tree, left, right, nestedLeft, nestedRight);
+        case NodeKind::ANDEXPRESSION:
+            if (op == "&" || op == "⚛") return make(BitAnd{});
+            break;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op == "^" || op == "xor" || op == "⚓") return make(BitXor{});
+            break;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op == "|" || op == "☯") return make(BitOr{});
+            break;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op == "&&" || op == "and" || op == "😠") return make(LogicalAnd{});
+            break;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op == "||" || op == "or" || op == "😇") return make(LogicalOr{});
+            break;
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator " + std::string(op));
+}
+
+// Comparisons yield a bool directly; anything else is converted like the
+// walker's toBool()
+ClosureCondition ClosureCompiler::condition(Child child) {
+    if (!child.isLeaf) {
+        NodeId node = child.index;
+        auto children = tree->children(node);
+        switch (tree->kind(node)) {
+            case NodeKind::NAME: {
+                uint32_t slot = tree->payload(node);
+                return [slot](ClosureContext& context) { return context.frame[slot].toBool(); };
+            }
+            case NodeKind::EQUALITYEXPRESSION:
+                if (children.size() == 3) {
+                    Child left = children[0];
+                    Child right = children[2];
+                    return makeCompare<ClosureCondition>(compareOpFromText(tree->leaf(children[1]).value), *tree,
+                        left, right,
+                        isOperand(*tree, left) ? nullptr : expression(left),
+                        isOperand(*tree, right) ? nullptr : expression(right));
+                }
+                break;
+            case NodeKind::EXP:
+                if (!children.empty()) {
+                    return condition(children[0]);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    ClosureExpression value = expression(child);
+    return [value](ClosureContext& context) { return value(context).toBool(); };
+}
@@ -0,0 +1,832 @@
+#include "CppEmitter.hpp"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// Runtime copied into every emitted program. The conversions and comparisons
+// mirror Value and compareValues, so the program prints what the
+// interpreter prints.
+const char* const RUNTIME = R"(#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace rt {
+
+char outBuffer[1 << 16];
+size_t outUsed = 0;
+
+void flush() {
+    fwrite(outBuffer, 1, outUsed, stdout);
+    outUsed = 0;
+    fflush(stdout);
+}
+
+inline void write(const char* data, size_t size) {
+    if (size > sizeof(outBuffer) - outUsed) {
+        flush();
+        if (size > sizeof(outBuffer)) {
+            fwrite(data, 1, size, stdout);
+            return;
+        }
+    }
+    memcpy(outBuffer + outUsed, data, size);
+    outUsed += size;
+}
+
+// Int arithmetic wraps like every engine's (addInt and co. in Value.hpp)
+inline int add(int left, int right) { return static_cast<int>(static_cast<uint32_t>(left) + static_cast<uint32_t>(right)); }
+inline int sub(int left, int right) { return static_cast<int>(static_cast<uint32_t>(left) - static_cast<uint32_t>(right)); }
+inline int mul(int left, int right) { return static_cast<int>(static_cast<uint32_t>(left) * static_cast<uint32_t>(right)); }
+
+// Same rules as the interpreter: 0 divisors stop the program, x % -1 is 0
+inline int mod(int left, int right) {
+    if (right == 0) {
+        flush();
+        fputs("Modulo by zero\n", stderr);
+        exit(1);
+    }
+    return right == -1 ? 0 : left % right;
+}
+
+struct Value {
+    enum class Type : uint8_t { NONE, INT, DOUBLE, BOOL, STRING };
+
+    Type type = Type::NONE;
+    int integer = 0;
+    double real = 0.0;
+    bool boolean = false;
+    std::string text;
+
+    Value() = default;
+    Value(int number) : type(Type::INT), integer(number) {}
+    Value(double number) : type(Type::DOUBLE), real(number) {}
+    Value(bool flag) : type(Type::BOOL), boolean(flag) {}
+    Value(std::string string) : type(Type::STRING), text(std::move(string)) {}
+};
+
+inline double toDouble(int value) { return value; }
+inline double toDouble(double value) { return value; }
+inline double toDouble(bool value) { return value ? 1.0 : 0.0; }
+inline double toDouble(const std::string& value) {
+    try {
+        return std::stod(value);
+    } catch (const std::exception&) {
+        return 0.0;
+    }
+}
+inline double toDouble(const Value& value) {
+    switch (value.type) {
+        case Value::Type::INT: return value.integer;
+        case Value::Type::DOUBLE: return value.real;
+        case Value::Type::BOOL: return toDouble(value.boolean);
+        case Value::Type::STRING: return toDouble(value.text);
+        default: return 0.0;
+    }
+}
+
+inline int toInt(int value) { return value; }
+inline int toInt(double value) { return static_cast<int>(value); }
+inline int toInt(bool value) { return value ? 1 : 0; }
+inline int toInt(const std::string& value) {
+    try {
+        return std::stoi(value);
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+inline int toInt(const Value& value) {
+    switch (value.type) {
+        case Value::Type::INT: return value.integer;
+        case Value::Type::DOUBLE: return toInt(value.real);
+        case Value::Type::BOOL: return toInt(value.boolean);
+        case Value::Type::STRING: return toInt(value.text);
+        default: return 0;
+    }
+}
+
+inline bool toBool(int value) { return value != 0; }
+inline bool toBool(double value) { return value != 0.0; }
+inline bool toBool(bool value) { return value; }
+inline bool toBool(const std::string& value) { return !value.empty() && value != "false" && value != "0"; }
+inline bool toBool(const Value& value) {
+    switch (value.type) {
+        case Value::Type::INT: return toBool(value.integer);
+        case Value::Type::DOUBLE: return toBool(value.real);
+        case Value::Type::BOOL: return value.boolean;
+        case Value::Type::STRING: return toBool(value.text);
+        default: return false;
+    }
+}
+
+inline std::string toString(const Value& value) {
+    switch (value.type) {
+        case Value::Type::INT: return std::to_string(value.integer);
+        case Value::Type::DOUBLE: return std::to_string(value.real);
+        case Value::Type::BOOL: return value.boolean ? "true" : "false";
+        case Value::Type::STRING: return value.text;
+        default: return "0";
+    }
+}
+
+inline Value add(const Value& left, const Value& right) {
+    if (left.type == Value::Type::INT && right.type == Value::Type::INT) return add(left.integer, right.integer);
+    return toDouble(left) + toDouble(right);
+}
+inline Value sub(const Value& left, const Value& right) {
+    if (left.type == Value::Type::INT && right.type == Value::Type::INT) return sub(left.integer, right.integer);
+    return toDouble(left) - toDouble(right);
+}
+inline Value mul(const Value& left, const Value& right) {
+    if (left.type == Value::Type::INT && right.type == Value::Type::INT) return mul(left.integer, right.integer);
+    return toDouble(left) * toDouble(right);
+}
+
+enum class Op { EQ, NE, LT, LE, GT, GE };
+
+template <typename T>
+inline bool compareSame(Op op, const T& left, const T& right) {
+    switch (op) {
+        case Op::EQ: return left == right;
+        case Op::NE: return left != right;
+        case Op::LT: return left < right;
+        case Op::LE: return left <= right;
+        case Op::GT: return left > right;
+        case Op::GE: return left >= right;
+    }
+    return false;
+}
+
+inline bool compare(Op op, const Value& left, const Value& right) {
+    using Type = Value::Type;
+    if (left.type == Type::INT && right.type == Type::INT) return compareSame(op, left.integer, right.integer);
+    bool leftNumber = left.type == Type::INT || left.type == Type::DOUBLE;
+    bool rightNumber = right.type == Type::INT || right.type == Type::DOUBLE;
+    if (leftNumber && rightNumber) return compareSame(op, toDouble(left), toDouble(right));
+    if (left.type == Type::BOOL && right.type == Type::BOOL) return compareSame(op, left.boolean, right.boolean);
+    if (left.type == Type::STRING && right.type == Type::STRING) return compareSame(op, left.text, right.text);
+    if (op == Op::EQ) return toString(left) == toString(right);
+    if (op == Op::NE) return toString(left) != toString(right);
+    return compareSame(op, toDouble(left), toDouble(right));
+}
+
+inline void print(int value) {
+    char digits[16];
+    char* end = digits + sizeof(digits);
+    char* first = end;
+    *--first = '\n';
+    uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    do {
+        *--first = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--first = '-';
+    write(first, static_cast<size_t>(end - first));
+}
+inline void print(double value) {
+    char text[512];
+    int length = snprintf(text, sizeof(text) - 1, "%f", value);
+    text[length] = '\n';
+    write(text, static_cast<size_t>(length) + 1);
+}
+inline void print(bool value) { write(value ? "true\n" : "false\n", value ? 5 : 6); }
+inline void print(const std::string& value) {
+    write(value.data(), value.size());
+    write("\n", 1);
+}
+inline void print(const Value& value) {
+    switch (value.type) {
+        case Value::Type::INT: print(value.integer); break;
+        case Value::Type::DOUBLE: print(value.real); break;
+        case Value::Type::BOOL: print(value.boolean); break;
+        case Value::Type::STRING: print(value.text); break;
+        default: print(0); break;
+    }
+}
+
+} // namespace rt
+)";
+
+enum class Op {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    BAND,
+    BOR,
+    BXOR,
+    AND,
+    OR,
+    COMPARE
+};
+
+bool isBinaryExpression(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Same spellings as the BytecodeCompiler accepts
+Op binaryOp(NodeKind kind, std::string_view op) {
+    switch (kind) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") return Op::ADD;
+            if (op == "-" || op == "➖") return Op::SUB;
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") return Op::MUL;
+            if (op == "/" || op == "➗") return Op::DIV;
+            if (op == "%" || op == "mod" || op == "📎") return Op::MOD;
+            break;
+        case NodeKind::EQUALITYEXPRESSION:
+            compareOpFromText(op);
+            return Op::COMPARE;
+        case NodeKind::ANDEXPRESSION:
+            if (op == "&" || op == "⚛") return Op::BAND;
+            break;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op == "|" || op == "☯") return Op::BOR;
+            break;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op == "^" || op == "xor" || op == "⚓") return Op::BXOR;
+            break;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op == "&&" || op == "and" || op == "😠") return Op::AND;
+            break;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op == "||" || op == "or" || op == "😇") return Op::OR;
+            break;
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator '" + std::string(op) + "' in " + nodeKindName(kind));
+}
+
+bool isNot(std::string_view op) {
+    return op == "!" || op == "not" || op == "❗";
+}
+
+const char* compareOpText(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return "==";
+        case CompareOp::NE: return "!=";
+        case CompareOp::LT: return "<";
+        case CompareOp::LE: return "<=";
+        case CompareOp::GT: return ">";
+        case CompareOp::GE: return ">=";
+    }
+    return "==";
+}
+
+const char* compareOpName(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return "rt::Op::EQ";
+        case CompareOp::NE: return "rt::Op::NE";
+        case CompareOp::LT: return "rt::Op::LT";
+        case CompareOp::LE: return "rt::Op::LE";
+        case CompareOp::GT: return "rt::Op::GT";
+        case CompareOp::GE: return "rt::Op::GE";
+    }
+    return "rt::Op::EQ";
+}
+
+std::string doubleLiteral(double number) {
+    if (std::isnan(number)) return "std::numeric_limits<double>::quiet_NaN()";
+    if (std::isinf(number)) {
+        return number < 0 ? "(-std::numeric_limits<double>::infinity())" : "std::numeric_limits<double>::infinity()";
+    }
+    char text[64];
+    snprintf(text, sizeof(text), "%.17g", number);
+    std::string literal = text;
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return number < 0 || std::signbit(number) ? "(" + literal + ")" : literal;
+}
+
+std::string intLiteral(int number) {
+    if (number == INT32_MIN) return "(-2147483647 - 1)";
+    std::string literal = std::to_string(number);
+    return number < 0 ? "(" + literal + ")" : literal;
+}
+
+// Octal escapes are always three digits, so they cannot run into the next character
+std::string stringLiteral(std::string_view text) {
+    std::string literal = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if (byte >= 0x20 && byte < 0x7f) {
+            literal += c;
+        } else {
+            char escape[5];
+            snprintf(escape, sizeof(escape), "\\%03o", byte);
+            literal += escape;
+        }
+    }
+    return literal + "\"";
+}
+
+} // namespace
+
+std::string CppEmitter::emit(const Tree& source, std::string_view sourceName) {
+    tree = &source;
+    variables.clear();
+    stores.clear();
+    nameVariable.assign(tree->nodeCount(), UINT32_MAX);
+    slotVariable.assign(tree->frameSize, UINT32_MAX);
+    out.clear();
+    indent = 1;
+    loopDepth = 0;
+
+    if (tree->nodeCount() > 0) {
+        collect(tree->root);
+    }
+    inferTypes();
+
+    if (tree->nodeCount() > 0) {
+        if (tree->kind(tree->root) == NodeKind::STMT) {
+            for (const Child& statement : tree->children(tree->root)) {
+                if (!statement.isLeaf) emitTopLevel(statement.index);
+            }
+        } else {
+            emitTopLevel(tree->root);
+        }
+    }
+
+    std::string program = "// Generated by emojilang --emit-cpp";
+    if (!sourceName.empty()) {
+        program += " from " + std::string(sourceName);
+    }
+    program += "\n";
+    program += RUNTIME;
+    program += "\n";
+
+    // String literals are built once, not on every evaluation
+    for (size_t i = 0; i < tree->constants.size(); i++) {
+        const Value& value = tree->constants[static_cast<uint32_t>(i)];
+        if (value.isString()) {
+            program += "static const std::string str" + std::to_string(i) + "(" +
+                stringLiteral(value.asString()) + ", " + std::to_string(value.asString().size()) + ");\n";
+        }
+    }
+
+    program += "\nint main() {\n" + out + "    rt::flush();\n    return 0;\n}\n";
+    tree = nullptr;
+    return program;
+}
+
+void CppEmitter::collect(NodeId node) {
+    switch (tree->kind(node)) {
+        case NodeKind::DECLARE_STMT:
+            for (const Child& child : tree->children(node)) {
+                if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+                    auto children = tree->children(child.index);
+                    collect(children[1].index); // reads the outer variable in "📢 x 😌 x"
+                    declare(children[0].index);
+                    stores.push_back(Store{nameVariable[children[0].index], children[1].index});
+                } else {
+                    declare(child.index);
+                    stores.push_back(Store{nameVariable[child.index], 0});
+                }
+            }
+            return;
+        case NodeKind::ASSIGNMENT_STMT: {
+            auto children = tree->children(node);
+            collect(children[1].index);
+            collect(children[0].index);
+            stores.push_back(Store{nameVariable[children[0].index], children[1].index});
+            return;
+        }
+        case NodeKind::NAME:
+            // Slots are reused in stack order, so the last declaration of a
+            // slot is the one every later read of it refers to
+            nameVariable[node] = slotVariable[tree->payload(node)];
+            if (nameVariable[node] == UINT32_MAX) {
+                throw std::runtime_error("Name read before its declaration; was the tree resolved?");
+            }
+            return;
+        default:
+            for (const Child& child : tree->children(node)) {
+                if (!child.isLeaf) collect(child.index);
+            }
+            return;
+    }
+}
+
+void CppEmitter::declare(NodeId nameNode) {
+    uint32_t slot = tree->payload(nameNode);
+    auto children = tree->children(nameNode);
+    std::string name = children.empty() ? "v" : std::string(tree->leaf(children[0]).value);
+
+    uint32_t id = static_cast<uint32_t>(variables.size());
+    variables.push_back(Variable{name + "_" + std::to_string(slot), Type::UNKNOWN});
+    slotVariable[slot] = id;
+    nameVariable[nameNode] = id;
+}
+
+void CppEmitter::inferTypes() {
+    // Optimistic fixpoint: a variable's type only rises, to VALUE at most
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const Store& store : stores) {
+            Type stored = store.value == 0 ? Type::INT : typeOf(store.value);
+            Type joined = join(variables[store.variable].type, stored);
+            if (joined != variables[store.variable].type) {
+                variables[store.variable].type = joined;
+                changed = true;
+            }
+        }
+    }
+    for (Variable& variable : variables) {
+        if (variable.type == Type::UNKNOWN) variable.type = Type::VALUE;
+    }
+}
+
+CppEmitter::Type CppEmitter::typeOf(NodeId node) const {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+
+    switch (kind) {
+        case NodeKind::NAME:
+            return variables[nameVariable[node]].type;
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT: {
+            const Value& value = tree->constants[tree->payload(node)];
+            switch (value.type()) {
+                case Value::Type::INT: return Type::INT;
+                case Value::Type::DOUBLE: return Type::DOUBLE;
+                case Value::Type::BOOL: return Type::BOOL;
+                case Value::Type::STRING: return Type::STRING;
+                default: return Type::VALUE;
+            }
+        }
+        case NodeKind::CASTEXPRESSION:
+            if (children.size() == 1) return typeOf(children[0].index);
+            return isNot(tree->leaf(children[0]).value) ? Type::BOOL : Type::INT;
+        case NodeKind::EXP:
+            return typeOf(children[0].index);
+        case NodeKind::FOR_TEST:
+            return children.empty() ? Type::BOOL : typeOf(children[0].index);
+        default:
+            break;
+    }
+
+    if (!isBinaryExpression(kind)) {
+        throw std::runtime_error(std::string("Cannot emit '") + nodeKindName(kind) + "' as an expression");
+    }
+    switch (binaryOp(kind, tree->leaf(children[1]).value)) {
+        case Op::ADD:
+        case Op::SUB:
+        case Op::MUL: {
+            Type left = typeOf(children[0].index);
+            Type right = typeOf(children[2].index);
+            if (left == Type::UNKNOWN || right == Type::UNKNOWN) return Type::UNKNOWN;
+            if (left == Type::VALUE || right == Type::VALUE) return Type::VALUE;
+            return left == Type::INT && right == Type::INT ? Type::INT : Type::DOUBLE;
+        }
+        case Op::DIV:
+            return Type::DOUBLE;
+        case Op::MOD:
+        case Op::BAND:
+        case Op::BOR:
+        case Op::BXOR:
+            return Type::INT;
+        default:
+            return Type::BOOL;
+    }
+}
+
+CppEmitter::Type CppEmitter::join(Type left, Type right) {
+    if (left == Type::UNKNOWN) return right;
+    if (right == Type::UNKNOWN || left == right) return left;
+    return Type::VALUE;
+}
+
+const char* CppEmitter::typeName(Type type) {
+    switch (type) {
+        case Type::INT: return "int";
+        case Type::DOUBLE: return "double";
+        case Type::BOOL: return "bool";
+        case Type::STRING: return "std::string";
+        default: return "rt::Value";
+    }
+}
+
+void CppEmitter::line(const std::string& text) {
+    out.append(static_cast<size_t>(indent) * 4, ' ');
+    out += text;
+    out += '\n';
+}
+
+bool CppEmitter::hasStrayFlow(NodeId node) const {
+    NodeKind kind = tree->kind(node);
+    if (kind == NodeKind::FLOW_STMT) return true;
+    if (kind == NodeKind::WHILE_STMT || kind == NodeKind::FOR_STMT) return false;
+    for (const Child& child : tree->children(node)) {
+        if (!child.isLeaf && hasStrayFlow(child.index)) return true;
+    }
+    return false;
+}
+
+void CppEmitter::emitTopLevel(NodeId node) {
+    // A break or continue outside any loop skips the rest of its top-level
+    // statement; a do/while(false) gives both that meaning
+    if (!hasStrayFlow(node)) {
+        emitStatement(node);
+        return;
+    }
+    line("do {");
+    indent++;
+    loopDepth++;
+    emitStatement(node);
+    loopDepth--;
+    indent--;
+    line("} while (false);");
+}
+
+void CppEmitter::emitStatement(NodeId node) {
+    switch (tree->kind(node)) {
+        case NodeKind::DECLARE_STMT:
+            emitDeclare(node);
+            break;
+        case NodeKind::ASSIGNMENT_STMT:
+            line(assignment(node, false) + ";");
+            break;
+        case NodeKind::PRINT_STMT:
+            line("rt::print(" + expression(tree->children(node)[0].index).code + ");");
+            break;
+        case NodeKind::IF_STMT:
+            emitIf(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            emitWhile(node);
+            break;
+        case NodeKind::FOR_STMT:
+            emitFor(node);
+            break;
+        case NodeKind::FLOW_STMT:
+            for (const Child& child : tree->children(node)) {
+                if (child.isLeaf) continue;
+                if (tree->kind(child.index) == NodeKind::BREAK_STMT) {
+                    line("break;");
+                } else if (tree->kind(child.index) == NodeKind::CONTINUE_STMT) {
+                    line("continue;");
+                }
+            }
+            break;
+        case NodeKind::SUITE:
+            line("{");
+            indent++;
+            emitSuite(node);
+            indent--;
+            line("}");
+            break;
+        case NodeKind::SPAWN_STMT:
+        case NodeKind::JOIN_STMT:
+            throw std::runtime_error("Cannot emit '🚀' or '🤝': tasks only run on the tree walker");
+        default:
+            line("(void)(" + expression(node).code + ");");
+            break;
+    }
+}
+
+void CppEmitter::emitSuite(NodeId node) {
+    for (const Child& statement : tree->children(node)) {
+        if (!statement.isLeaf) emitStatement(statement.index);
+    }
+}
+
+void CppEmitter::emitDeclare(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+            line(assignment(child.index, true) + ";");
+        } else {
+            const Variable& variable = variables[nameVariable[child.index]];
+            line(std::string(typeName(variable.type)) + " " + variable.name + " = " +
+                convert(Expression{"0", Type::INT}, variable.type) + ";");
+        }
+    }
+}
+
+std::string CppEmitter::assignment(NodeId node, bool isDeclaration) {
+    auto children = tree->children(node);
+    const Variable& variable = variables[nameVariable[children[0].index]];
+    std::string value = convert(expression(children[1].index), variable.type);
+    if (isDeclaration) {
+        return std::string(typeName(variable.type)) + " " + variable.name + " = " + value;
+    }
+    return variable.name + " = " + value;
+}
+
+void CppEmitter::emitIf(NodeId node) {
+    auto children = tree->children(node);
+
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree->leaf(children[i]).value;
+        std::string prefix = i == 0 ? "" : "} ";
+
+        if (keyword == "else" || keyword == "🏁") {
+            line(prefix + "else {");
+            indent++;
+            emitSuite(children[i + 1].index);
+            indent--;
+            break;
+        }
+
+        line(prefix + (i == 0 ? "if (" : "else if (") + condition(children[i + 1].index) + ") {");
+        indent++;
+        emitSuite(children[i + 2].index);
+        indent--;
+        i += 3;
+    }
+    line("}");
+}
+
+void CppEmitter::emitWhile(NodeId node) {
+    auto children = tree->children(node);
+    line("while (" + condition(children[0].index) + ") {");
+    indent++;
+    loopDepth++;
+    emitSuite(children[1].index);
+    loopDepth--;
+    indent--;
+    line("}");
+}
+
+void CppEmitter::emitFor(NodeId node) {
+    auto children = tree->children(node);
+    NodeId decl = children[0].index;
+    NodeId test = children[1].index;
+    NodeId updates = children[2].index;
+
+    // The outer block scopes the loop's declarations; continue runs the updates
+    line("{");
+    indent++;
+    for (const Child& init : tree->children(decl)) {
+        emitStatement(init.index);
+    }
+
+    std::string header = "for (;";
+    if (tree->size(test) > 0) {
+        header += " " + condition(tree->children(test)[0].index);
+    }
+    header += ";";
+    bool first = true;
+    for (const Child& update : tree->children(updates)) {
+        header += first ? " " : ", ";
+        header += assignment(update.index, false);
+        first = false;
+    }
+    line(header + ") {");
+
+    indent++;
+    loopDepth++;
+    emitSuite(children[3].index);
+    loopDepth--;
+    indent--;
+    line("}");
+    indent--;
+    line("}");
+}
+
+CppEmitter::Expression CppEmitter::expression(NodeId node) {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+
+    switch (kind) {
+        case NodeKind::NAME: {
+            const Variable& variable = variables[nameVariable[node]];
+            return Expression{variable.name, variable.type};
+        }
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT: {
+            uint32_t index = tree->payload(node);
+            const Value& value = tree->constants[index];
+            if (value.isString()) {
+                return Expression{"str" + std::to_string(index), Type::STRING};
+            }
+            return literal(value);
+        }
+        case NodeKind::CASTEXPRESSION: {
+            if (children.size() == 1) return expression(children[0].index);
+            Expression operand = expression(children[1].index);
+            if (isNot(tree->leaf(children[0]).value)) {
+                return Expression{"(!" + convert(operand, Type::BOOL) + ")", Type::BOOL};
+            }
+            return Expression{"(~" + convert(operand, Type::INT) + ")", Type::INT};
+        }
+        case NodeKind::EXP:
+            return expression(children[0].index);
+        case NodeKind::FOR_TEST:
+            if (children.empty()) return Expression{"true", Type::BOOL};
+            return expression(children[0].index);
+        default:
+            break;
+    }
+
+    if (!isBinaryExpression(kind)) {
+        throw std::runtime_error(std::string("Cannot emit '") + nodeKindName(kind) + "' as an expression");
+    }
+
+    std::string_view opText = tree->leaf(children[1]).value;
+    Op op = binaryOp(kind, opText);
+    Expression left = expression(children[0].index);
+    Expression right = expression(children[2].index);
+    Type type = typeOf(node);
+
+    switch (op) {
+        case Op::ADD:
+        case Op::SUB:
+        case Op::MUL: {
+            const char* symbol = op == Op::ADD ? " + " : op == Op::SUB ? " - " : " * ";
+            const char* helper = op == Op::ADD ? "rt::add(" : op == Op::SUB ? "rt::sub(" : "rt::mul(";
+            if (type == Type::DOUBLE) {
+                return Expression{"(" + convert(left, Type::DOUBLE) + symbol + convert(right, Type::DOUBLE) + ")", type};
+            }
+            // Ints wrap; a boxed operand decides int or double at run time
+            return Expression{helper + convert(left, type) + ", " + convert(right, type) + ")", type};
+        }
+        case Op::DIV:
+            return Expression{"(" + convert(left, Type::DOUBLE) + " / " + convert(right, Type::DOUBLE) + ")", type};
+        case Op::MOD:
+            return Expression{"rt::mod(" + convert(left, Type::INT) + ", " + convert(right, Type::INT) + ")", type};
+        case Op::BAND:
+            return Expression{"(" + convert(left, Type::INT) + " & " + convert(right, Type::INT) + ")", type};
+        case Op::BOR:
+            return Expression{"(" + convert(left, Type::INT) + " | " + convert(right, Type::INT) + ")", type};
+        case Op::BXOR:
+            return Expression{"(" + convert(left, Type::INT) + " ^ " + convert(right, Type::INT) + ")", type};
+        case Op::AND:
+        case Op::OR: {
+            // Both sides are always evaluated, as in the interpreter
+            const char* symbol = op == Op::AND ? " & " : " | ";
+            return Expression{"static_cast<bool>(" + convert(left, Type::BOOL) + symbol + convert(right, Type::BOOL) + ")", type};
+        }
+        case Op::COMPARE:
+            break;
+    }
+
+    CompareOp compare = compareOpFromText(opText);
+    bool leftNumber = left.type == Type::INT || left.type == Type::DOUBLE;
+    bool rightNumber = right.type == Type::INT || right.type == Type::DOUBLE;
+    if (leftNumber && rightNumber) {
+        Type common = left.type == Type::INT && right.type == Type::INT ? Type::INT : Type::DOUBLE;
+        return Expression{"(" + convert(left, common) + " " + compareOpText(compare) + " " + convert(right, common) + ")", type};
+    }
+    if (left.type == right.type && (left.type == Type::BOOL || left.type == Type::STRING)) {
+        return Expression{"(" + left.code + " " + compareOpText(compare) + " " + right.code + ")", type};
+    }
+    return Expression{std::string("rt::compare(") + compareOpName(compare) + ", " +
+        convert(left, Type::VALUE) + ", " + convert(right, Type::VALUE) + ")", type};
+}
+
+CppEmitter::Expression CppEmitter::literal(const Value& value) {
+    switch (value.type()) {
+        case Value::Type::INT: return Expression{intLiteral(value.asInt()), Type::INT};
+        case Value::Type::DOUBLE: return Expression{doubleLiteral(value.asDouble()), Type::DOUBLE};
+        case Value::Type::BOOL: return Expression{value.asBool() ? "true" : "false", Type::BOOL};
+        default: return Expression{"rt::Value()", Type::VALUE};
+    }
+}
+
+std::string CppEmitter::condition(NodeId node) {
+    return convert(expression(node), Type::BOOL);
+}
+
+std::string CppEmitter::convert(const Expression& value, Type type) const {
+    if (value.type == type) return value.code;
+    switch (type) {
+        case Type::INT: return "rt::toInt(" + value.code + ")";
+        case Type::DOUBLE: return "rt::toDouble(" + value.code + ")";
+        case Type::BOOL: return "rt::toBool(" + value.code + ")";
+        case Type::VALUE: return "rt::Value(" + value.code + ")";
+        default: break;
+    }
+    throw std::runtime_error("Cannot convert an emitted expression to a string");
+}
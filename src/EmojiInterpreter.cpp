@@ -1,152 +1,225 @@
 #include "EmojiInterpreter.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <stdexcept>
 #include <sstream>
+#include <stdexcept>
 #include <cmath>
 
-EmojiInterpreter::EmojiInterpreter(TreePtr tree) 
-    : symbolTable(false), parseTree(tree), isAssignmentDeclaration(false) {}
+namespace {
 
-void EmojiInterpreter::start() {
-    symbolTable.addScope();
-    visit(parseTree);
-}
-
-Value EmojiInterpreter::visit(TreePtr tree) {
-    if (!tree) return Value{};
-    
-    if (tree->data == "stmt") return visitStatement(tree);
-    if (tree->data == "string") return visitString(tree);
-    if (tree->data == "name") return visitName(tree);
-    if (tree->data == "number") return visitNumber(tree);
-    if (tree->data == "boolean") return visitBoolean(tree);
-    if (tree->data == "castexpression") return visitCastExpression(tree);
-    if (tree->data == "additiveexpression") return visitAdditiveExpression(tree);
-    if (tree->data == "multiplicativeexpression") return visitMultiplicativeExpression(tree);
-    if (tree->data == "equalityexpression") return visitEqualityExpression(tree);
-    if (tree->data == "andexpression") return visitAndExpression(tree);
-    if (tree->data == "exclusiveorexpression") return visitExclusiveOrExpression(tree);
-    if (tree->data == "inclusiveorexpression") return visitInclusiveOrExpression(tree);
-    if (tree->data == "logicalandexpression") return visitLogicalAndExpression(tree);
-    if (tree->data == "logicalorexpression") return visitLogicalOrExpression(tree);
-    if (tree->data == "exp") return visitExp(tree);
-    if (tree->data == "print_stmt") return visitPrintStatement(tree);
-    if (tree->data == "assignment_stmt") return visitAssignmentStatement(tree);
-    if (tree->data == "declare_stmt") return visitDeclareStatement(tree);
-    if (tree->data == "suite") return visitSuite(tree);
-    if (tree->data == "if_stmt") return visitIfStatement(tree);
-    if (tree->data == "while_stmt") return visitWhileStatement(tree);
-    if (tree->data == "for_stmt") return visitForStatement(tree);
-    if (tree->data == "for_decl") return visitForDecl(tree);
-    if (tree->data == "for_test") return visitForTest(tree);
-    if (tree->data == "for_updates") return visitForUpdates(tree);
-    if (tree->data == "flow_stmt") return visitFlowStatement(tree);
-    
-    // Default: visit children
-    visitChildren(tree);
-    return Value{};
+// Compiled code that keeps bailing out or failing its guards costs more than
+// it saves; after this many times the loop stays in the walker.
+constexpr uint32_t MAX_JIT_FAILURES = 8;
+
+// Chunks per thread for a parallel loop, so uneven iterations still balance
+constexpr uint64_t CHUNKS_PER_THREAD = 4;
+
+// Loop iterations an interpreter runs between checks of its limits
+constexpr uint32_t CHARGE_INTERVAL = 256;
+
+// Whether a 🚀 or 🤝 appears anywhere under `node`
+bool usesTasks(const Tree& tree, NodeId node) {
+    NodeKind kind = tree.kind(node);
+    if (kind == NodeKind::SPAWN_STMT || kind == NodeKind::JOIN_STMT) {
+        return true;
+    }
+    for (const Child& child : tree.children(node)) {
+        if (!child.isLeaf && usesTasks(tree, child.index)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-Value EmojiInterpreter::visit(const TreeNode& node) {
-    if (std::holds_alternative<TreePtr>(node)) {
-        return visit(std::get<TreePtr>(node));
-    } else if (std::holds_alternative<TokenPtr>(node)) {
-        return std::get<TokenPtr>(node)->value;
+} // namespace
+
+EmojiInterpreter::EmojiInterpreter(const Tree* tree, std::ostream& output) 
+    : parseTree(tree), output(output), specializing(true), countingLoops(true), parallelThreads(0),
+      reportParallel(true), diagnostics(&std::cerr), taskThreads(0), taskPool(nullptr), uncharged(0) {}
+
+EmojiInterpreter::~EmojiInterpreter() {
+    for (const auto& task : tasks) {
+        waitFor(*task);
     }
-    return Value{};
 }
 
-void EmojiInterpreter::visitChildren(TreePtr tree) {
-    for (const auto& child : tree->children) {
-        visit(child);
+void EmojiInterpreter::setTiering(const TieringOptions& options) {
+    tiering = options;
+    if (budget) {
+        tiering.jit = false;
     }
 }
 
-Value EmojiInterpreter::visitStatement(TreePtr tree) {
-    Value result;
-    for (const auto& child : tree->children) {
-        result = visit(child);
+void EmojiInterpreter::setSpecialization(bool enabled) {
+    specializing = enabled;
+}
+
+void EmojiInterpreter::setCountedLoops(bool enabled) {
+    countingLoops = enabled;
+}
+
+void EmojiInterpreter::setParallelLoops(size_t threads, bool report) {
+    parallelThreads = threads;
+    reportParallel = report;
+    pool.reset();
+}
+
+void EmojiInterpreter::setTaskThreads(size_t threads) {
+    taskThreads = threads;
+}
+
+void EmojiInterpreter::setDiagnostics(std::ostream& stream) {
+    diagnostics = &stream;
+}
+
+void EmojiInterpreter::setLimits(const ExecutionLimits& limits) {
+    budget.reset();
+    if (limits.any()) {
+        budget = std::make_shared<Budget>();
+        budget->limits = limits;
+        budget->deadline = std::chrono::steady_clock::now() + limits.timeout;
+        tiering.jit = false;
     }
-    return result;
 }
 
-Value EmojiInterpreter::visitString(TreePtr tree) {
-    if (!tree->children.empty() && isToken(tree->children[0])) {
-        return getTokenValue(tree->children[0]);
+void EmojiInterpreter::start() {
+    if (parseTree && parseTree->nodeCount() > 0) {
+        frame.assign(parseTree->frameSize, Value{});
+        nodeStates.assign(parseTree->nodeCount(), NodeState{});
+        exec(parseTree->root);
+        joinTasks();
     }
-    return std::string{};
 }
 
-Value EmojiInterpreter::visitName(TreePtr tree) {
-    if (!tree->children.empty() && isToken(tree->children[0])) {
-        std::string name = getTokenValue(tree->children[0]);
-        return symbolTable.getValue(name);
+void EmojiInterpreter::execute(const Tree& tree, NodeId statement) {
+    parseTree = &tree;
+    // Node ids are reused once the streaming parser moves on
+    loopStates.clear();
+    countedLoops.clear();
+    parallelLoops.clear();
+    nodeStates.assign(tree.nodeCount(), NodeState{});
+    if (frame.size() < tree.frameSize) {
+        frame.resize(tree.frameSize);
     }
-    return Value{};
+    exec(statement);
+    // The statement's tree is discarded once it has run
+    joinTasks();
 }
 
-Value EmojiInterpreter::visitNumber(TreePtr tree) {
-    if (!tree->children.empty() && isToken(tree->children[0])) {
-        std::string numStr = getTokenValue(tree->children[0]);
-        try {
-            if (numStr.find('.') != std::string::npos) {
-                return std::stod(numStr);
-            } else {
-                return std::stoi(numStr);
-            }
-        } catch (const std::exception&) {
-            return 0;
-        }
+Completion EmojiInterpreter::exec(NodeId node) {
+    switch (parseTree->kind(node)) {
+        case NodeKind::STMT: return visitStatement(node);
+        case NodeKind::PRINT_STMT: return visitPrintStatement(node);
+        case NodeKind::ASSIGNMENT_STMT: return visitAssignmentStatement(node);
+        case NodeKind::DECLARE_STMT: return visitDeclareStatement(node);
+        case NodeKind::SUITE: return visitSuite(node);
+        case NodeKind::IF_STMT: return visitIfStatement(node);
+        case NodeKind::WHILE_STMT: return visitWhileStatement(node);
+        case NodeKind::FOR_STMT: return visitForStatement(node);
+        case NodeKind::FOR_DECL: return visitForDecl(node);
+        case NodeKind::FOR_UPDATES: return visitForUpdates(node);
+        case NodeKind::FLOW_STMT: return visitFlowStatement(node);
+        case NodeKind::SPAWN_STMT: return visitSpawnStatement(node);
+        case NodeKind::JOIN_STMT: return visitJoinStatement(node);
+        default:
+            // A bare expression used as a statement
+            visit(node);
+            return Completion::NORMAL;
     }
-    return 0;
 }
 
-Value EmojiInterpreter::visitBoolean(TreePtr tree) {
-    if (!tree->children.empty() && isToken(tree->children[0])) {
-        std::string boolStr = getTokenValue(tree->children[0]);
-        return boolStr == "true" || boolStr == "✔";
+Value EmojiInterpreter::visit(NodeId node) {
+    switch (parseTree->kind(node)) {
+        case NodeKind::STRING: return visitLiteral(node);
+        case NodeKind::NAME: return visitName(node);
+        case NodeKind::NUMBER: return visitLiteral(node);
+        case NodeKind::BOOLEAN: return visitLiteral(node);
+        case NodeKind::CONSTANT: return visitLiteral(node);
+        case NodeKind::CASTEXPRESSION: return visitCastExpression(node);
+        case NodeKind::ADDITIVEEXPRESSION: return visitAdditiveExpression(node);
+        case NodeKind::MULTIPLICATIVEEXPRESSION: return visitMultiplicativeExpression(node);
+        case NodeKind::EQUALITYEXPRESSION: return visitEqualityExpression(node);
+        case NodeKind::ANDEXPRESSION: return visitAndExpression(node);
+        case NodeKind::EXCLUSIVEOREXPRESSION: return visitExclusiveOrExpression(node);
+        case NodeKind::INCLUSIVEOREXPRESSION: return visitInclusiveOrExpression(node);
+        case NodeKind::LOGICALANDEXPRESSION: return visitLogicalAndExpression(node);
+        case NodeKind::LOGICALOREXPRESSION: return visitLogicalOrExpression(node);
+        case NodeKind::EXP: return visitExp(node);
+        case NodeKind::FOR_TEST: return visitForTest(node);
+        default:
+            throw std::runtime_error(std::string("Cannot evaluate ") + nodeKindName(parseTree->kind(node)) + " as an expression");
     }
-    return false;
 }
 
-Value EmojiInterpreter::visitCastExpression(TreePtr tree) {
-    if (tree->children.size() == 1) {
-        return visit(tree->children[0]);
-    } else if (tree->children.size() == 2) {
-        std::string op = getTokenValue(tree->children[0]);
-        Value operand = visit(tree->children[1]);
+Value EmojiInterpreter::visit(Child child) {
+    if (child.isLeaf) {
+        return std::string(parseTree->leaf(child).value);
+    }
+    return visit(child.index);
+}
+
+Completion EmojiInterpreter::visitStatement(NodeId node) {
+    // Top level: a stray break/continue only ends the statement it appears in
+    for (const Child& child : parseTree->children(node)) {
+        if (!isToken(child)) {
+            exec(child.index);
+        }
+    }
+    return Completion::NORMAL;
+}
+
+Value EmojiInterpreter::visitLiteral(NodeId node) {
+    return parseTree->constants[parseTree->payload(node)];
+}
+
+Value EmojiInterpreter::visitName(NodeId node) {
+    return frame[parseTree->payload(node)];
+}
+
+Value EmojiInterpreter::visitCastExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.size() == 1) {
+        return visit(children[0]);
+    } else if (children.size() == 2) {
+        std::string_view op = getTokenValue(children[0]);
+        Value operand = visit(children[1]);
         
         if (op == "!" || op == "not" || op == "❗") {
-            return !valueToBool(operand);
+            return !operand.toBool();
         } else if (op == "~" || op == "〰") {
-            return ~valueToInt(operand);
+            return ~operand.toInt();
         }
     }
     return Value{};
 }
 
-Value EmojiInterpreter::visitAdditiveExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitAdditiveExpression(NodeId node) {
+    if (specializing && parseTree->size(node) == 3) {
+        return visitSpecialized(node);
+    }
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "+" || op == "➕") {
-            if (std::holds_alternative<int>(value) && std::holds_alternative<int>(right)) {
-                value = std::get<int>(value) + std::get<int>(right);
+            if (value.isInt() && right.isInt()) {
+                value = addInt(value.asInt(), right.asInt());
             } else {
-                value = valueToDouble(value) + valueToDouble(right);
+                value = value.toDouble() + right.toDouble();
             }
         } else if (op == "-" || op == "➖") {
-            if (std::holds_alternative<int>(value) && std::holds_alternative<int>(right)) {
-                value = std::get<int>(value) - std::get<int>(right);
+            if (value.isInt() && right.isInt()) {
+                value = subtractInt(value.asInt(), right.asInt());
             } else {
-                value = valueToDouble(value) - valueToDouble(right);
+                value = value.toDouble() - right.toDouble();
             }
         }
     }
@@ -154,410 +227,1069 @@ Value EmojiInterpreter::visitAdditiveExpression(TreePtr tree) {
     return value;
 }
 
-Value EmojiInterpreter::visitMultiplicativeExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitMultiplicativeExpression(NodeId node) {
+    if (specializing && parseTree->size(node) == 3) {
+        return visitSpecialized(node);
+    }
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "*" || op == "✖") {
-            if (std::holds_alternative<int>(value) && std::holds_alternative<int>(right)) {
-                value = std::get<int>(value) * std::get<int>(right);
+            if (value.isInt() && right.isInt()) {
+                value = multiplyInt(value.asInt(), right.asInt());
             } else {
-                value = valueToDouble(value) * valueToDouble(right);
+                value = value.toDouble() * right.toDouble();
             }
         } else if (op == "/" || op == "➗") {
-            value = valueToDouble(value) / valueToDouble(right);
+            value = value.toDouble() / right.toDouble();
         } else if (op == "%" || op == "mod" || op == "📎") {
-            value = valueToInt(value) % valueToInt(right);
+            value = moduloInt(value.toInt(), right.toInt());
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitEqualityExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitEqualityExpression(NodeId node) {
+    if (specializing && parseTree->size(node) == 3) {
+        return visitSpecialized(node);
+    }
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    std::stringstream ss;
-    ss << valueToString(visit(tree->children[0])) << " ";
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        ss << op << " ";
-        ss << valueToString(visit(tree->children[i + 1])) << " ";
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
+        value = compareValues(compareOpFromText(op), value, right);
     }
     
-    std::string expr = ss.str();
-    // Simple evaluation - in a real implementation, you'd want proper expression evaluation
-    // For now, we'll handle basic cases
-    if (expr.find("==") != std::string::npos) {
-        Value left = visit(tree->children[0]);
-        Value right = visit(tree->children[2]);
-        return valueToString(left) == valueToString(right);
-    }
-    
-    return false;
+    return value;
 }
 
-Value EmojiInterpreter::visitAndExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitAndExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "&" || op == "⚛") {
-            value = valueToInt(value) & valueToInt(right);
+            value = value.toInt() & right.toInt();
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitExclusiveOrExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitExclusiveOrExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "^" || op == "xor" || op == "⚓") {
-            value = valueToInt(value) ^ valueToInt(right);
+            value = value.toInt() ^ right.toInt();
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitInclusiveOrExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitInclusiveOrExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "|" || op == "☯") {
-            value = valueToInt(value) | valueToInt(right);
+            value = value.toInt() | right.toInt();
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitLogicalAndExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitLogicalAndExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "&&" || op == "and" || op == "😠") {
-            value = valueToBool(value) && valueToBool(right);
+            value = value.toBool() && right.toBool();
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitLogicalOrExpression(TreePtr tree) {
-    if (tree->children.empty()) return Value{};
+Value EmojiInterpreter::visitLogicalOrExpression(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) return Value{};
     
-    Value value = visit(tree->children[0]);
+    Value value = visit(children[0]);
     
-    for (size_t i = 1; i < tree->children.size(); i += 2) {
-        if (i + 1 >= tree->children.size()) break;
+    for (size_t i = 1; i < children.size(); i += 2) {
+        if (i + 1 >= children.size()) break;
         
-        std::string op = getTokenValue(tree->children[i]);
-        Value right = visit(tree->children[i + 1]);
+        std::string_view op = getTokenValue(children[i]);
+        Value right = visit(children[i + 1]);
         
         if (op == "||" || op == "or" || op == "😇") {
-            value = valueToBool(value) || valueToBool(right);
+            value = value.toBool() || right.toBool();
         }
     }
     
     return value;
 }
 
-Value EmojiInterpreter::visitExp(TreePtr tree) {
-    if (!tree->children.empty()) {
-        return visit(tree->children[0]);
+// Truffle-style node rewriting. A binary node starts out uninitialized; its
+// first evaluation rewrites it into the variant for its operator and the
+// operand types it saw (IntAdd, DoubleMul, ...), which re-checks only those
+// types and no operator text. When that check fails the node rewrites
+// itself into the generic variant of its operator and stays there.
+Value EmojiInterpreter::visitSpecialized(NodeId node) {
+    auto children = parseTree->children(node);
+    Value leftScratch;
+    Value rightScratch;
+    const Value& left = operand(children[0], leftScratch);
+    const Value& right = operand(children[2], rightScratch);
+    NodeState& state = nodeStates[node];
+    
+    while (true) {
+        switch (state.specialization) {
+            case Specialization::UNINITIALIZED:
+                break;
+            case Specialization::INT_ADD:
+                if (left.isInt() && right.isInt()) return addInt(left.asInt(), right.asInt());
+                break;
+            case Specialization::DOUBLE_ADD:
+                if (left.isDouble() || right.isDouble()) return left.toDouble() + right.toDouble();
+                break;
+            case Specialization::GENERIC_ADD:
+                if (left.isInt() && right.isInt()) return addInt(left.asInt(), right.asInt());
+                return left.toDouble() + right.toDouble();
+            case Specialization::INT_SUB:
+                if (left.isInt() && right.isInt()) return subtractInt(left.asInt(), right.asInt());
+                break;
+            case Specialization::DOUBLE_SUB:
+                if (left.isDouble() || right.isDouble()) return left.toDouble() - right.toDouble();
+                break;
+            case Specialization::GENERIC_SUB:
+                if (left.isInt() && right.isInt()) return subtractInt(left.asInt(), right.asInt());
+                return left.toDouble() - right.toDouble();
+            case Specialization::INT_MUL:
+                if (left.isInt() && right.isInt()) return multiplyInt(left.asInt(), right.asInt());
+                break;
+            case Specialization::DOUBLE_MUL:
+                if (left.isDouble() || right.isDouble()) return left.toDouble() * right.toDouble();
+                break;
+            case Specialization::GENERIC_MUL:
+                if (left.isInt() && right.isInt()) return multiplyInt(left.asInt(), right.asInt());
+                return left.toDouble() * right.toDouble();
+            case Specialization::DIV:
+                return left.toDouble() / right.toDouble();
+            case Specialization::INT_MOD:
+                if (left.isInt() && right.isInt()) return moduloInt(left.asInt(), right.asInt());
+                break;
+            case Specialization::GENERIC_MOD:
+                return moduloInt(left.toInt(), right.toInt());
+            case Specialization::INT_COMPARE:
+                if (left.isInt() && right.isInt()) return compareSame(state.op, left.asInt(), right.asInt());
+                break;
+            case Specialization::GENERIC_COMPARE:
+                return compareValues(state.op, left, right);
+        }
+        state = rewrite(node, state, left, right);
     }
-    return Value{};
 }
 
-Value EmojiInterpreter::visitPrintStatement(TreePtr tree) {
-    if (!tree->children.empty()) {
-        Value value = visit(tree->children[0]);
-        std::cout << valueToString(value) << std::endl;
+// Variables and literals are read in place instead of being copied out
+const Value& EmojiInterpreter::operand(Child child, Value& scratch) {
+    switch (parseTree->kind(child.index)) {
+        case NodeKind::NAME:
+            return frame[parseTree->payload(child.index)];
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT:
+            return parseTree->constants[parseTree->payload(child.index)];
+        default:
+            scratch = visit(child.index);
+            return scratch;
     }
-    return Value{};
 }
 
-Value EmojiInterpreter::visitAssignmentStatement(TreePtr tree) {
-    if (tree->children.size() >= 2) {
-        std::string symbol;
-        
-        // Get symbol name from name tree
-        if (std::holds_alternative<TreePtr>(tree->children[0])) {
-            auto nameTree = std::get<TreePtr>(tree->children[0]);
-            if (!nameTree->children.empty() && isToken(nameTree->children[0])) {
-                symbol = getTokenValue(nameTree->children[0]);
+// The DOUBLE variants take any pair the generic operator would compute in
+// doubles, as long as one side already is a double.
+EmojiInterpreter::NodeState EmojiInterpreter::rewrite(NodeId node, const NodeState& state,
+                                                      const Value& left, const Value& right) {
+    bool ints = left.isInt() && right.isInt();
+    bool doubles = left.isDouble() || right.isDouble();
+    bool first = state.specialization == Specialization::UNINITIALIZED;
+    std::string_view op = getTokenValue(parseTree->children(node)[1]);
+    
+    switch (parseTree->kind(node)) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") {
+                if (first && ints) return {Specialization::INT_ADD};
+                if (first && doubles) return {Specialization::DOUBLE_ADD};
+                return {Specialization::GENERIC_ADD};
             }
+            if (op == "-" || op == "➖") {
+                if (first && ints) return {Specialization::INT_SUB};
+                if (first && doubles) return {Specialization::DOUBLE_SUB};
+                return {Specialization::GENERIC_SUB};
+            }
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") {
+                if (first && ints) return {Specialization::INT_MUL};
+                if (first && doubles) return {Specialization::DOUBLE_MUL};
+                return {Specialization::GENERIC_MUL};
+            }
+            if (op == "/" || op == "➗") {
+                return {Specialization::DIV};
+            }
+            if (op == "%" || op == "mod" || op == "📎") {
+                if (first && ints) return {Specialization::INT_MOD};
+                return {Specialization::GENERIC_MOD};
+            }
+            break;
+        case NodeKind::EQUALITYEXPRESSION: {
+            CompareOp compare = first ? compareOpFromText(op) : state.op;
+            if (first && ints) return {Specialization::INT_COMPARE, compare};
+            return {Specialization::GENERIC_COMPARE, compare};
         }
-        
-        Value value = visit(tree->children[1]);
-        
-        if (isAssignmentDeclaration) {
-            symbolTable.addSymbol(symbol, value);
-        } else {
-            symbolTable.updateSymbol(symbol, value);
-        }
-        
-        symbolTable.debugSymbolTable();
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator " + std::string(op));
+}
+
+Value EmojiInterpreter::visitExp(NodeId node) {
+    auto children = parseTree->children(node);
+    if (!children.empty()) {
+        return visit(children[0]);
     }
     return Value{};
 }
 
-Value EmojiInterpreter::visitDeclareStatement(TreePtr tree) {
-    isAssignmentDeclaration = true;
-    
-    for (const auto& child : tree->children) {
-        if (std::holds_alternative<TreePtr>(child)) {
-            auto childTree = std::get<TreePtr>(child);
-            if (childTree->data == "name") {
-                if (!childTree->children.empty() && isToken(childTree->children[0])) {
-                    std::string symbol = getTokenValue(childTree->children[0]);
-                    symbolTable.addSymbol(symbol);
-                }
-            } else if (childTree->data == "assignment_stmt") {
-                visit(child);
-            }
+Completion EmojiInterpreter::visitPrintStatement(NodeId node) {
+    auto children = parseTree->children(node);
+    if (!children.empty()) {
+        std::string text = visit(children[0]).toString();
+        if (budget && budget->limits.maxOutputBytes > 0 &&
+            budget->outputBytes.fetch_add(text.size() + 1) + text.size() + 1 > budget->limits.maxOutputBytes) {
+            throw LimitExceeded("Output limit of " + std::to_string(budget->limits.maxOutputBytes) + " bytes exceeded");
         }
+        output << text << std::endl;
     }
-    
-    isAssignmentDeclaration = false;
-    symbolTable.debugSymbolTable();
-    return Value{};
+    return Completion::NORMAL;
 }
 
-Value EmojiInterpreter::visitSuite(TreePtr tree) {
-    for (size_t i = 0; i < tree->children.size(); ++i) {
-        if (std::holds_alternative<TreePtr>(tree->children[i])) {
-            Value ret = visit(tree->children[i]);
-            if (std::holds_alternative<std::string>(ret)) {
-                std::string retStr = std::get<std::string>(ret);
-                if (retStr == "break" || retStr == "continue") {
-                    return ret;
-                }
+Completion EmojiInterpreter::visitAssignmentStatement(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.size() >= 2) {
+        // Declarations and plain assignments both just store into the resolved slot
+        frame[parseTree->payload(children[0].index)] = visit(children[1]);
+    }
+    return Completion::NORMAL;
+}
+
+Completion EmojiInterpreter::visitDeclareStatement(NodeId node) {
+    for (const Child& child : parseTree->children(node)) {
+        if (parseTree->kind(child.index) == NodeKind::NAME) {
+            frame[parseTree->payload(child.index)] = 0;
+        } else {
+            exec(child.index);
+        }
+    }
+    return Completion::NORMAL;
+}
+
+Completion EmojiInterpreter::visitSuite(NodeId node) {
+    for (const Child& child : parseTree->children(node)) {
+        if (!isToken(child)) {
+            Completion completion = exec(child.index);
+            if (completion != Completion::NORMAL) {
+                return completion;
             }
         }
     }
-    return Value{};
+    return Completion::NORMAL;
 }
 
-Value EmojiInterpreter::visitIfStatement(TreePtr tree) {
-    for (size_t i = 0; i < tree->children.size(); ++i) {
-        if (std::holds_alternative<TokenPtr>(tree->children[i])) {
-            std::string token = getTokenValue(tree->children[i]);
+Completion EmojiInterpreter::visitIfStatement(NodeId node) {
+    auto children = parseTree->children(node);
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (isToken(children[i])) {
+            std::string_view token = getTokenValue(children[i]);
             if (token == "if" || token == "elif" || token == "🚩" || token == "🏳") {
-                if (i + 2 < tree->children.size()) {
-                    Value cond = visit(tree->children[i + 1]);
-                    if (valueToBool(cond)) {
-                        symbolTable.addScope();
-                        Value ret = visit(tree->children[i + 2]);
-                        symbolTable.removeScope();
-                        return ret;
+                if (i + 2 < children.size()) {
+                    Value cond = visit(children[i + 1]);
+                    if (cond.toBool()) {
+                        return exec(children[i + 2].index);
                     }
                 }
             } else if (token == "else" || token == "🏁") {
-                if (i + 1 < tree->children.size()) {
-                    symbolTable.addScope();
-                    Value ret = visit(tree->children[i + 1]);
-                    symbolTable.removeScope();
-                    return ret;
+                if (i + 1 < children.size()) {
+                    return exec(children[i + 1].index);
                 }
             }
         }
     }
-    return Value{};
+    return Completion::NORMAL;
 }
 
-Value EmojiInterpreter::visitWhileStatement(TreePtr tree) {
-    if (tree->children.size() >= 2) {
-        while (true) {
-            Value cond = visit(tree->children[0]);
-            if (!valueToBool(cond)) break;
-            
-            symbolTable.addScope();
-            Value ret = visit(tree->children[1]);
-            symbolTable.removeScope();
-            
-            if (std::holds_alternative<std::string>(ret) && std::get<std::string>(ret) == "break") {
+// Loops consume BREAK and CONTINUE from their own body, so an inner loop's
+// flow statements never reach an outer one.
+Completion EmojiInterpreter::visitWhileStatement(NodeId node) {
+    if (tiering.jit && runCompiled(node, false)) {
+        return Completion::NORMAL;
+    }
+    return runWhile(node);
+}
+
+// Each finished iteration counts towards the loop's threshold; crossing it
+// moves the rest of this very run into compiled code at the next test.
+Completion EmojiInterpreter::runWhile(NodeId node) {
+    auto children = parseTree->children(node);
+    LoopState* state = profile(node);
+    if (children.size() >= 2) {
+        while (visit(children[0]).toBool()) {
+            if (exec(children[1].index) == Completion::BREAK) {
                 break;
             }
+            countIteration();
+            if (state && ++state->iterations >= tiering.threshold) {
+                if (runCompiled(node, true)) {
+                    return Completion::NORMAL;
+                }
+                state = nullptr;
+            }
         }
     }
-    return Value{};
+    return Completion::NORMAL;
 }
 
-Value EmojiInterpreter::visitForStatement(TreePtr tree) {
-    if (tree->children.size() >= 4) {
-        symbolTable.addScope(); // outer scope
-        
-        visit(tree->children[0]); // for_decl
-        
-        while (true) {
-            Value cond = visit(tree->children[1]); // for_test
-            if (!valueToBool(cond)) break;
-            
-            symbolTable.addScope(); // inner scope
-            Value ret = visit(tree->children[3]); // loop body
-            symbolTable.removeScope();
-            
-            if (std::holds_alternative<std::string>(ret) && std::get<std::string>(ret) == "break") {
+Completion EmojiInterpreter::visitForStatement(NodeId node) {
+    // A loop that may run in parallel is not handed to the JIT first
+    bool parallel = parallelThreads > 0 && parallelLoop(node).independent;
+    if (tiering.jit && !parallel && runCompiled(node, false)) {
+        return Completion::NORMAL;
+    }
+    auto children = parseTree->children(node);
+    if (children.size() >= 4) {
+        exec(children[0].index); // for_decl
+    }
+    return runFor(node);
+}
+
+Completion EmojiInterpreter::runFor(NodeId node, bool allowCounted) {
+    auto children = parseTree->children(node);
+    if (allowCounted && parallelThreads > 0 && children.size() >= 4 && runParallel(node)) {
+        return Completion::NORMAL;
+    }
+    if (allowCounted && countingLoops && children.size() >= 4) {
+        const CountedLoop& loop = countedLoop(node);
+        if (loop.counted && frame[loop.slot].isInt() && (!loop.boundIsSlot || frame[loop.bound].isInt())) {
+            return runCounted(node, loop);
+        }
+    }
+    
+    LoopState* state = profile(node);
+    if (children.size() >= 4) {
+        while (visit(children[1]).toBool()) { // for_test
+            // CONTINUE falls through to the updates, like in C
+            if (exec(children[3].index) == Completion::BREAK) {
                 break;
             }
             
-            visit(tree->children[2]); // for_updates
+            exec(children[2].index); // for_updates
+            countIteration();
+            if (state && ++state->iterations >= tiering.threshold) {
+                if (runCompiled(node, true)) {
+                    return Completion::NORMAL;
+                }
+                state = nullptr;
+            }
+        }
+    }
+    return Completion::NORMAL;
+}
+
+// The counter lives in a local int: the test is a single int compare and
+// the update a single add, and the frame slot is only written so the body
+// can read it. Nothing in the loop can change the counter's type or the
+// bound, so the only way out of the fast path is leaving the int range,
+// where the update runs in the walker and the loop carries on there.
+Completion EmojiInterpreter::runCounted(NodeId node, const CountedLoop& loop) {
+    auto children = parseTree->children(node);
+    NodeId body = children[3].index;
+    int value = frame[loop.slot].asInt();
+    int limit = loop.boundIsSlot ? frame[loop.bound].asInt() : loop.limit;
+    LoopState* state = profile(node);
+    
+    while (compareSame(loop.op, value, limit)) {
+        // CONTINUE falls through to the update, like in C
+        if (exec(body) == Completion::BREAK) {
+            break;
         }
         
-        symbolTable.removeScope();
+        int64_t next = static_cast<int64_t>(value) + loop.step;
+        if (next < INT32_MIN || next > INT32_MAX) {
+            exec(children[2].index); // for_updates
+            return runFor(node, false);
+        }
+        value = static_cast<int>(next);
+        frame[loop.slot].setInt(value);
+        countIteration();
+        if (state && ++state->iterations >= tiering.threshold) {
+            if (runCompiled(node, true)) {
+                return Completion::NORMAL;
+            }
+            state = nullptr;
+        }
     }
-    return Value{};
+    return Completion::NORMAL;
 }
 
-Value EmojiInterpreter::visitForDecl(TreePtr tree) {
-    visitChildren(tree);
-    return Value{};
+// Recognized once per loop: a test comparing the counter with an int
+// literal or a variable, and a single update adding or subtracting an int
+// literal. The test may also be written with the counter on the right.
+const EmojiInterpreter::CountedLoop& EmojiInterpreter::countedLoop(NodeId node) {
+    auto found = countedLoops.find(node);
+    if (found != countedLoops.end()) {
+        return found->second;
+    }
+    CountedLoop& loop = countedLoops[node];
+    auto children = parseTree->children(node);
+    
+    auto updates = parseTree->children(children[2].index);
+    if (updates.size() != 1 || parseTree->kind(updates[0].index) != NodeKind::ASSIGNMENT_STMT) {
+        return loop;
+    }
+    auto assignment = parseTree->children(updates[0].index);
+    uint32_t slot = parseTree->payload(assignment[0].index);
+    if (assignment[1].isLeaf || parseTree->kind(assignment[1].index) != NodeKind::ADDITIVEEXPRESSION) {
+        return loop;
+    }
+    auto sum = parseTree->children(assignment[1].index);
+    int step = 0;
+    if (sum.size() != 3 || sum[0].isLeaf || parseTree->kind(sum[0].index) != NodeKind::NAME ||
+        parseTree->payload(sum[0].index) != slot || !intConstant(sum[2], step) || step == INT32_MIN) {
+        return loop;
+    }
+    std::string_view sign = getTokenValue(sum[1]);
+    if (sign == "-" || sign == "➖") {
+        step = -step;
+    } else if (sign != "+" && sign != "➕") {
+        return loop;
+    }
+    
+    auto test = parseTree->children(children[1].index);
+    if (test.size() != 1 || test[0].isLeaf || parseTree->kind(test[0].index) != NodeKind::EQUALITYEXPRESSION) {
+        return loop;
+    }
+    auto compare = parseTree->children(test[0].index);
+    if (compare.size() != 3) {
+        return loop;
+    }
+    auto isCounter = [&](Child child) {
+        return !child.isLeaf && parseTree->kind(child.index) == NodeKind::NAME && parseTree->payload(child.index) == slot;
+    };
+    CompareOp op = compareOpFromText(getTokenValue(compare[1]));
+    Child bound = compare[2];
+    if (!isCounter(compare[0])) {
+        if (!isCounter(compare[2])) {
+            return loop;
+        }
+        bound = compare[0];
+        // b < i is i > b
+        switch (op) {
+            case CompareOp::LT: op = CompareOp::GT; break;
+            case CompareOp::LE: op = CompareOp::GE; break;
+            case CompareOp::GT: op = CompareOp::LT; break;
+            case CompareOp::GE: op = CompareOp::LE; break;
+            default: break;
+        }
+    }
+    
+    NodeId body = children[3].index;
+    if (intConstant(bound, loop.limit)) {
+        loop.boundIsSlot = false;
+    } else if (!bound.isLeaf && parseTree->kind(bound.index) == NodeKind::NAME &&
+               parseTree->payload(bound.index) != slot && !writes(body, parseTree->payload(bound.index))) {
+        loop.boundIsSlot = true;
+        loop.bound = parseTree->payload(bound.index);
+    } else {
+        return loop;
+    }
+    if (writes(body, slot)) {
+        return loop;
+    }
+    
+    loop.counted = true;
+    loop.slot = slot;
+    loop.op = op;
+    loop.step = step;
+    return loop;
 }
 
-Value EmojiInterpreter::visitForTest(TreePtr tree) {
-    if (tree->children.empty()) {
-        return true; // infinite loop condition
+// Whether anything under `node` stores into `slot`
+bool EmojiInterpreter::writes(NodeId node, uint32_t slot) const {
+    NodeKind kind = parseTree->kind(node);
+    auto children = parseTree->children(node);
+    if (kind == NodeKind::ASSIGNMENT_STMT && !children.empty() && parseTree->payload(children[0].index) == slot) {
+        return true;
     }
-    return visit(tree->children[0]);
+    for (const Child& child : children) {
+        if (child.isLeaf) {
+            continue;
+        }
+        if (kind == NodeKind::DECLARE_STMT && parseTree->kind(child.index) == NodeKind::NAME &&
+            parseTree->payload(child.index) == slot) {
+            return true;
+        }
+        if (writes(child.index, slot)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-Value EmojiInterpreter::visitForUpdates(TreePtr tree) {
-    visitChildren(tree);
-    return Value{};
+bool EmojiInterpreter::intConstant(Child child, int& value) const {
+    if (child.isLeaf) {
+        return false;
+    }
+    NodeKind kind = parseTree->kind(child.index);
+    if (kind != NodeKind::NUMBER && kind != NodeKind::CONSTANT) {
+        return false;
+    }
+    const Value& constant = parseTree->constants[parseTree->payload(child.index)];
+    if (!constant.isInt()) {
+        return false;
+    }
+    value = constant.asInt();
+    return true;
 }
 
-Value EmojiInterpreter::visitFlowStatement(TreePtr tree) {
-    for (const auto& child : tree->children) {
-        if (std::holds_alternative<TreePtr>(child)) {
-            auto childTree = std::get<TreePtr>(child);
-            if (childTree->data == "break_stmt") {
-                return std::string("break");
-            } else if (childTree->data == "continue_stmt") {
-                return std::string("continue");
+// A counted loop is independent when its body cannot break out of it and
+// only stores into variables declared inside the body, which start afresh
+// every iteration. Reads of anything else see the same value in every
+// iteration, and the counter is known up front for each one.
+EmojiInterpreter::ParallelLoop& EmojiInterpreter::parallelLoop(NodeId node) {
+    auto found = parallelLoops.find(node);
+    if (found != parallelLoops.end()) {
+        return found->second;
+    }
+    ParallelLoop& state = parallelLoops[node];
+    auto children = parseTree->children(node);
+    if (children.size() < 4 || !countedLoop(node).counted) {
+        state.reason = "it is not a counting loop over an int range with a fixed bound and step";
+        return state;
+    }
+    NodeId body = children[3].index;
+    if (breaksOut(body)) {
+        state.reason = "its body can break out of it";
+        return state;
+    }
+    if (usesTasks(*parseTree, body)) {
+        // Tasks spawned by a chunk would be joined at its end, not where the program joins them
+        state.reason = "its body spawns or joins tasks";
+        return state;
+    }
+    std::vector<bool> declared(parseTree->frameSize, false);
+    collectDeclared(body, declared);
+    NodeId written = 0;
+    if (outsideWrite(body, declared, written)) {
+        state.reason = "its body stores into `" + std::string(parseTree->leaf(parseTree->children(written)[0]).value) +
+            "`, which is declared outside it";
+        return state;
+    }
+    state.independent = true;
+    return state;
+}
+
+// Splits the iterations into contiguous chunks, each run by its own
+// interpreter on a copy of the frame and printing into its own buffer.
+// The buffers are written out in iteration order, so the output is the
+// same as running the loop sequentially; a chunk that fails writes what it
+// printed up to the error, and the error is raised after it.
+bool EmojiInterpreter::runParallel(NodeId node) {
+    ParallelLoop& state = parallelLoop(node);
+    if (!state.independent) {
+        report(node, state, "stays sequential: " + state.reason);
+        return false;
+    }
+    const CountedLoop& loop = countedLoop(node);
+    if (!frame[loop.slot].isInt() || (loop.boundIsSlot && !frame[loop.bound].isInt())) {
+        report(node, state, "stays sequential: its counter or bound does not hold an int");
+        return false;
+    }
+    
+    // Number of iterations of an ascending < or <=, or descending > or >=, range
+    int64_t value = frame[loop.slot].asInt();
+    int64_t limit = loop.boundIsSlot ? frame[loop.bound].asInt() : loop.limit;
+    int64_t step = loop.step;
+    uint64_t count = 0;
+    if (step > 0 && (loop.op == CompareOp::LT || loop.op == CompareOp::LE)) {
+        int64_t last = loop.op == CompareOp::LT ? limit - 1 : limit;
+        count = value <= last ? static_cast<uint64_t>((last - value) / step + 1) : 0;
+    } else if (step < 0 && (loop.op == CompareOp::GT || loop.op == CompareOp::GE)) {
+        int64_t last = loop.op == CompareOp::GT ? limit + 1 : limit;
+        count = value >= last ? static_cast<uint64_t>((value - last) / -step + 1) : 0;
+    } else {
+        report(node, state, "stays sequential: its test and step do not describe a finite range");
+        return false;
+    }
+    int64_t end = value + static_cast<int64_t>(count) * step;
+    if (end < INT32_MIN || end > INT32_MAX) {
+        report(node, state, "stays sequential: its counter would overflow");
+        return false;
+    }
+    if (count < 2) {
+        return false;
+    }
+    
+    if (!pool) {
+        pool = std::make_unique<ThreadPool>(parallelThreads);
+    }
+    uint64_t chunks = std::min<uint64_t>(count, parallelThreads * CHUNKS_PER_THREAD);
+    report(node, state, "runs in parallel: " + std::to_string(count) + " iterations in " +
+        std::to_string(chunks) + " chunks on " + std::to_string(pool->size()) + " threads");
+    reportNested(parseTree->children(node)[3].index, node);
+    
+    struct Chunk {
+        std::ostringstream output;
+        std::vector<Value> frame;
+        std::exception_ptr failure;
+    };
+    std::vector<Chunk> results(chunks);
+    uint64_t first = 0;
+    for (uint64_t i = 0; i < chunks; ++i) {
+        uint64_t size = count / chunks + (i < count % chunks ? 1 : 0);
+        int start = static_cast<int>(value + static_cast<int64_t>(first) * step);
+        first += size;
+        pool->submit([this, node, start, size, &chunk = results[i]] {
+            try {
+                EmojiInterpreter worker(parseTree, chunk.output);
+                configure(worker);
+                worker.frame = frame;
+                worker.nodeStates.assign(parseTree->nodeCount(), NodeState{});
+                worker.runIterations(node, start, size);
+                chunk.frame = std::move(worker.frame);
+            } catch (...) {
+                chunk.failure = std::current_exception();
             }
+        });
+    }
+    pool->wait();
+    
+    for (Chunk& chunk : results) {
+        output << chunk.output.str();
+        if (chunk.failure) {
+            output.flush();
+            std::rethrow_exception(chunk.failure);
         }
     }
-    return Value{};
+    // Locals are left as the last iteration left them, and the counter one step past the end
+    frame = std::move(results.back().frame);
+    frame[loop.slot].setInt(static_cast<int>(end));
+    return true;
 }
 
-// Helper functions
-std::string EmojiInterpreter::valueToString(const Value& value) {
-    if (std::holds_alternative<std::monostate>(value)) {
-        return "0";
-    } else if (std::holds_alternative<int>(value)) {
-        return std::to_string(std::get<int>(value));
-    } else if (std::holds_alternative<double>(value)) {
-        return std::to_string(std::get<double>(value));
-    } else if (std::holds_alternative<bool>(value)) {
-        return std::get<bool>(value) ? "true" : "false";
-    } else if (std::holds_alternative<std::string>(value)) {
-        return std::get<std::string>(value);
+void EmojiInterpreter::runIterations(NodeId node, int first, uint64_t count) {
+    const CountedLoop& loop = countedLoop(node);
+    NodeId body = parseTree->children(node)[3].index;
+    int value = first;
+    for (uint64_t i = 0; i < count; ++i, value += loop.step) {
+        frame[loop.slot].setInt(value);
+        exec(body);
+        countIteration();
     }
-    return "";
 }
 
-double EmojiInterpreter::valueToDouble(const Value& value) {
-    if (std::holds_alternative<std::monostate>(value)) {
-        return 0.0;
-    } else if (std::holds_alternative<int>(value)) {
-        return static_cast<double>(std::get<int>(value));
-    } else if (std::holds_alternative<double>(value)) {
-        return std::get<double>(value);
-    } else if (std::holds_alternative<bool>(value)) {
-        return std::get<bool>(value) ? 1.0 : 0.0;
-    } else if (std::holds_alternative<std::string>(value)) {
-        try {
-            return std::stod(std::get<std::string>(value));
-        } catch (const std::exception&) {
-            return 0.0;
+void EmojiInterpreter::collectDeclared(NodeId node, std::vector<bool>& declared) const {
+    NodeKind kind = parseTree->kind(node);
+    for (const Child& child : parseTree->children(node)) {
+        if (child.isLeaf) {
+            continue;
         }
+        NodeKind childKind = parseTree->kind(child.index);
+        if (kind == NodeKind::DECLARE_STMT && childKind == NodeKind::NAME) {
+            declared[parseTree->payload(child.index)] = true;
+        } else if (kind == NodeKind::DECLARE_STMT && childKind == NodeKind::ASSIGNMENT_STMT) {
+            declared[parseTree->payload(parseTree->children(child.index)[0].index)] = true;
+        }
+        collectDeclared(child.index, declared);
     }
-    return 0.0;
 }
 
-bool EmojiInterpreter::valueToBool(const Value& value) {
-    if (std::holds_alternative<std::monostate>(value)) {
+// Finds the first store into a slot that is not declared under the loop body
+bool EmojiInterpreter::outsideWrite(NodeId node, const std::vector<bool>& declared, NodeId& target) const {
+    auto children = parseTree->children(node);
+    if (parseTree->kind(node) == NodeKind::ASSIGNMENT_STMT && !children.empty() &&
+        !declared[parseTree->payload(children[0].index)]) {
+        target = children[0].index;
+        return true;
+    }
+    for (const Child& child : children) {
+        if (!child.isLeaf && outsideWrite(child.index, declared, target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A break that is not inside a nested loop of its own
+bool EmojiInterpreter::breaksOut(NodeId node) const {
+    NodeKind kind = parseTree->kind(node);
+    if (kind == NodeKind::BREAK_STMT) {
+        return true;
+    }
+    if (kind == NodeKind::WHILE_STMT || kind == NodeKind::FOR_STMT) {
         return false;
-    } else if (std::holds_alternative<int>(value)) {
-        return std::get<int>(value) != 0;
-    } else if (std::holds_alternative<double>(value)) {
-        return std::get<double>(value) != 0.0;
-    } else if (std::holds_alternative<bool>(value)) {
-        return std::get<bool>(value);
-    } else if (std::holds_alternative<std::string>(value)) {
-        std::string str = std::get<std::string>(value);
-        return !str.empty() && str != "false" && str != "0";
+    }
+    for (const Child& child : parseTree->children(node)) {
+        if (!child.isLeaf && breaksOut(child.index)) {
+            return true;
+        }
     }
     return false;
 }
 
-int EmojiInterpreter::valueToInt(const Value& value) {
-    if (std::holds_alternative<std::monostate>(value)) {
-        return 0;
-    } else if (std::holds_alternative<int>(value)) {
-        return std::get<int>(value);
-    } else if (std::holds_alternative<double>(value)) {
-        return static_cast<int>(std::get<double>(value));
-    } else if (std::holds_alternative<bool>(value)) {
-        return std::get<bool>(value) ? 1 : 0;
-    } else if (std::holds_alternative<std::string>(value)) {
+// Each loop's decision is reported the first time it is made
+void EmojiInterpreter::report(NodeId loop, ParallelLoop& state, const std::string& message) {
+    if (reportParallel && !state.reported) {
+        state.reported = true;
+        *diagnostics << "PARALLEL: loop at line " << lineOf(loop) << " " << message << std::endl;
+    }
+}
+
+// Workers run without parallel loops, so the loops in a parallel loop's
+// body run sequentially in every chunk; waiting on the pool from inside
+// one of its own chunks could deadlock, and the chunks use every thread
+void EmojiInterpreter::reportNested(NodeId node, NodeId outer) {
+    for (const Child& child : parseTree->children(node)) {
+        if (child.isLeaf) {
+            continue;
+        }
+        if (parseTree->kind(child.index) == NodeKind::FOR_STMT) {
+            report(child.index, parallelLoop(child.index),
+                "stays sequential: it is nested in the parallel loop at line " + std::to_string(lineOf(outer)));
+        }
+        reportNested(child.index, outer);
+    }
+}
+
+void EmojiInterpreter::configure(EmojiInterpreter& worker) const {
+    worker.budget = budget;
+    TieringOptions options = tiering;
+    options.trace = false;
+    worker.setTiering(options);
+    worker.setSpecialization(specializing);
+    worker.setCountedLoops(countingLoops);
+    worker.diagnostics = diagnostics;
+    worker.taskThreads = taskThreads;
+    worker.taskPool = taskPool;
+}
+
+void EmojiInterpreter::countIteration() {
+    if (budget && ++uncharged == CHARGE_INTERVAL) {
+        charge();
+    }
+}
+
+void EmojiInterpreter::charge() {
+    uint64_t iterations = budget->iterations.fetch_add(uncharged) + uncharged;
+    uncharged = 0;
+    const ExecutionLimits& limits = budget->limits;
+    if (limits.maxIterations > 0 && iterations > limits.maxIterations) {
+        throw LimitExceeded("Iteration limit of " + std::to_string(limits.maxIterations) + " exceeded");
+    }
+    if (limits.timeout.count() > 0 && std::chrono::steady_clock::now() > budget->deadline) {
+        throw LimitExceeded("Time limit of " + std::to_string(limits.timeout.count()) + " ms exceeded");
+    }
+}
+
+Completion EmojiInterpreter::visitForDecl(NodeId node) {
+    for (const Child& child : parseTree->children(node)) {
+        exec(child.index);
+    }
+    return Completion::NORMAL;
+}
+
+Value EmojiInterpreter::visitForTest(NodeId node) {
+    auto children = parseTree->children(node);
+    if (children.empty()) {
+        return true; // infinite loop condition
+    }
+    return visit(children[0]);
+}
+
+Completion EmojiInterpreter::visitForUpdates(NodeId node) {
+    for (const Child& child : parseTree->children(node)) {
+        exec(child.index);
+    }
+    return Completion::NORMAL;
+}
+
+Completion EmojiInterpreter::visitFlowStatement(NodeId node) {
+    for (const Child& child : parseTree->children(node)) {
+        if (!isToken(child)) {
+            NodeKind kind = parseTree->kind(child.index);
+            if (kind == NodeKind::BREAK_STMT) {
+                return Completion::BREAK;
+            } else if (kind == NodeKind::CONTINUE_STMT) {
+                return Completion::CONTINUE;
+            }
+        }
+    }
+    return Completion::NORMAL;
+}
+
+// The Resolver has made sure the block never stores into a variable
+// declared outside it and never breaks out of it, so it only needs a copy of
+// the frame. Its output is kept until it is joined.
+Completion EmojiInterpreter::visitSpawnStatement(NodeId node) {
+    ThreadPool& pool = tasksPool();
+    auto task = std::make_shared<Task>();
+    tasks.push_back(task);
+    NodeId body = parseTree->children(node)[0].index;
+    pool.submit([this, body, task, snapshot = frame]() mutable {
         try {
-            return std::stoi(std::get<std::string>(value));
-        } catch (const std::exception&) {
-            return 0;
+            EmojiInterpreter worker(parseTree, task->output);
+            configure(worker);
+            worker.frame = std::move(snapshot);
+            worker.nodeStates.assign(parseTree->nodeCount(), NodeState{});
+            worker.exec(body);
+            worker.joinTasks();
+        } catch (...) {
+            task->failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->finished = true;
+        task->done.notify_all();
+    });
+    return Completion::NORMAL;
+}
+
+Completion EmojiInterpreter::visitJoinStatement(NodeId) {
+    joinTasks();
+    return Completion::NORMAL;
+}
+
+ThreadPool& EmojiInterpreter::tasksPool() {
+    if (!taskPool) {
+        size_t threads = taskThreads > 0 ? taskThreads : std::max(1u, std::thread::hardware_concurrency());
+        ownedTaskPool = std::make_unique<ThreadPool>(threads);
+        taskPool = ownedTaskPool.get();
+    }
+    return *taskPool;
+}
+
+void EmojiInterpreter::joinTasks() {
+    std::vector<std::shared_ptr<Task>> joined;
+    joined.swap(tasks);
+    for (const auto& task : joined) {
+        waitFor(*task);
+    }
+    for (const auto& task : joined) {
+        output << task->output.str();
+        if (task->failure) {
+            output.flush();
+            std::rethrow_exception(task->failure);
+        }
+    }
+}
+
+// A joining thread runs queued tasks itself rather than block, so tasks that
+// join their own subtasks cannot use up every worker. When nothing is
+// queued the task is running elsewhere; the wait is short, to pick up any
+// tasks it spawns meanwhile.
+void EmojiInterpreter::waitFor(Task& task) {
+    std::unique_lock<std::mutex> lock(task.mutex);
+    while (!task.finished) {
+        lock.unlock();
+        bool ran = taskPool->runPending();
+        lock.lock();
+        if (!ran) {
+            task.done.wait_for(lock, std::chrono::milliseconds(1), [&task] { return task.finished; });
+        }
+    }
+}
+
+bool EmojiInterpreter::runCompiled(NodeId loop, bool fromTest) {
+    LoopState& state = loopStates[loop];
+    if (state.rejected) {
+        return false;
+    }
+    if (!state.code) {
+        if (state.iterations < tiering.threshold) {
+            return false;
+        }
+        state.code = jit.compile(*parseTree, loop, frame);
+        if (!state.code) {
+            state.rejected = true;
+            trace(loop, JitCompiler::available()
+                ? "cannot be compiled for its current types; it stays in the walker"
+                : "is hot, but this build has no JIT; it stays in the walker");
+            return false;
+        }
+        trace(loop, "is hot after " + std::to_string(state.iterations) + " iterations; compiled to " +
+            std::to_string(state.code->codeSize()) + " bytes of machine code");
+    }
+    if (fromTest) {
+        trace(loop, "enters compiled code at its test (on-stack replacement)");
+    }
+    
+    const ResumePath* path = nullptr;
+    JitCode::Exit exit = state.code->run(frame.data(), fromTest, output, path);
+    if (exit == JitCode::Exit::FINISHED) {
+        return true;
+    }
+    
+    if (exit == JitCode::Exit::GUARD_FAILED) {
+        trace(loop, "was compiled for other variable types; the walker runs it");
+    } else {
+        const ResumeStep& last = path->back();
+        trace(loop, "bails out to the walker before line " +
+            std::to_string(lineOf(parseTree->children(last.node)[last.index].index)));
+    }
+    if (++state.failures >= MAX_JIT_FAILURES) {
+        state.rejected = true;
+        trace(loop, "left compiled code " + std::to_string(state.failures) + " times; it stays in the walker");
+    }
+    if (exit == JitCode::Exit::GUARD_FAILED) {
+        return false;
+    }
+    // The code stays alive while the walker follows its resume path
+    resume(*path, 0);
+    return true;
+}
+
+EmojiInterpreter::LoopState* EmojiInterpreter::profile(NodeId loop) {
+    if (!tiering.jit) {
+        return nullptr;
+    }
+    LoopState& state = loopStates[loop];
+    return state.rejected ? nullptr : &state;
+}
+
+void EmojiInterpreter::trace(NodeId loop, const std::string& message) const {
+    if (tiering.trace) {
+        *diagnostics << "TIERING: loop at line " << lineOf(loop) << " " << message << std::endl;
+    }
+}
+
+// Line of the first token under a node
+uint32_t EmojiInterpreter::lineOf(NodeId node) const {
+    for (const Child& child : parseTree->children(node)) {
+        if (child.isLeaf) {
+            return parseTree->leaf(child).line;
+        }
+        uint32_t line = lineOf(child.index);
+        if (line != 0) {
+            return line;
         }
     }
     return 0;
 }
 
-bool EmojiInterpreter::isToken(const TreeNode& node) {
-    return std::holds_alternative<TokenPtr>(node);
+// The last step is where the walker starts; every step above it finishes
+// the statement it is inside of and then carries on like the walker would.
+Completion EmojiInterpreter::resume(const ResumePath& path, size_t level) {
+    const ResumeStep& step = path[level];
+    bool inside = level + 1 < path.size();
+    auto children = parseTree->children(step.node);
+    
+    switch (parseTree->kind(step.node)) {
+        case NodeKind::WHILE_STMT:
+            if (inside && resume(path, level + 1) == Completion::BREAK) {
+                return Completion::NORMAL;
+            }
+            return runWhile(step.node);
+        case NodeKind::FOR_STMT:
+            if (inside) {
+                Completion completion = resume(path, level + 1);
+                if (step.index == 3) {
+                    if (completion == Completion::BREAK) {
+                        return Completion::NORMAL;
+                    }
+                    exec(children[2].index); // for_updates
+                }
+            }
+            return runFor(step.node);
+        case NodeKind::IF_STMT:
+            return resume(path, level + 1);
+        default: {
+            // A suite, for_decl or for_updates
+            size_t next = step.index;
+            if (inside) {
+                Completion completion = resume(path, level + 1);
+                if (completion != Completion::NORMAL) {
+                    return completion;
+                }
+                next++;
+            }
+            for (size_t i = next; i < children.size(); i++) {
+                if (!isToken(children[i])) {
+                    Completion completion = exec(children[i].index);
+                    if (completion != Completion::NORMAL) {
+                        return completion;
+                    }
+                }
+            }
+            return Completion::NORMAL;
+        }
+    }
+}
+
+// Helper functions
+bool EmojiInterpreter::isToken(Child child) {
+    return child.isLeaf;
 }
 
-std::string EmojiInterpreter::getTokenValue(const TreeNode& node) {
-    if (std::holds_alternative<TokenPtr>(node)) {
-        return std::get<TokenPtr>(node)->value;
+std::string_view EmojiInterpreter::getTokenValue(Child child) {
+    if (child.isLeaf) {
+        return parseTree->leaf(child).value;
     }
     return "";
 }
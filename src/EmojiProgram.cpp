@@ -0,0 +1,92 @@
+#include "EmojiProgram.hpp"
+#include <sstream>
+#include "EmojiInterpreter.hpp"
+#include "EmojiTransformer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "ProgramCache.hpp"
+#include "Resolver.hpp"
+#include "SourceBuffer.hpp"
+
+namespace {
+
+void configure(EmojiInterpreter& interpreter, const RunOptions& options) {
+    TieringOptions tiering;
+    tiering.jit = options.jit;
+    tiering.threshold = options.jitThreshold;
+    tiering.trace = options.traceTiering;
+    interpreter.setTiering(tiering);
+    interpreter.setSpecialization(options.specialize);
+    interpreter.setCountedLoops(options.countedLoops);
+    interpreter.setTaskThreads(options.taskThreads);
+    interpreter.setParallelLoops(options.parallelThreads, options.reportParallel);
+    interpreter.setLimits(options.limits);
+    if (options.diagnostics) {
+        interpreter.setDiagnostics(*options.diagnostics);
+    }
+}
+
+} // namespace
+
+EmojiProgram::EmojiProgram(std::shared_ptr<const Tree> tree) : tree(std::move(tree)) {}
+
+EmojiProgram EmojiProgram::compile(std::string_view source, const CompileOptions& options) {
+    auto compiled = std::make_shared<Tree>();
+    std::unique_ptr<ProgramCache> cache;
+    if (!options.cacheDirectory.empty()) {
+        cache = std::make_unique<ProgramCache>(options.cacheDirectory);
+        if (cache->load(source, options.optimize, *compiled)) {
+            return EmojiProgram(std::move(compiled));
+        }
+    }
+    // The tree copies the text it keeps, so `source` is not needed afterwards
+    *compiled = Parser().parse(source);
+    EmojiTransformer().visit(*compiled);
+    Resolver().resolve(*compiled);
+    if (options.optimize) {
+        Optimizer().optimize(*compiled);
+    }
+    if (cache) {
+        cache->store(source, options.optimize, *compiled);
+    }
+    return EmojiProgram(std::move(compiled));
+}
+
+EmojiProgram EmojiProgram::compileFile(const std::string& path, const CompileOptions& options) {
+    SourceBuffer source = SourceBuffer::fromFile(path);
+    return compile(source.text(), options);
+}
+
+void EmojiProgram::run(std::ostream& output, const RunOptions& options) const {
+    EmojiInterpreter interpreter(tree.get(), output);
+    configure(interpreter, options);
+    interpreter.start();
+}
+
+std::string EmojiProgram::run(const RunOptions& options) const {
+    std::ostringstream output;
+    run(output, options);
+    return output.str();
+}
+
+void EmojiProgram::runStream(std::istream& input, std::ostream& output, const CompileOptions& compileOptions,
+                             const RunOptions& runOptions) {
+    EmojiTransformer transformer;
+    Resolver resolver;
+    Optimizer optimizer;
+    EmojiInterpreter interpreter(nullptr, output);
+    configure(interpreter, runOptions);
+    interpreter.start();
+    Parser().parse(input, [&](Tree& tree, NodeId statement) {
+        transformer.visit(tree, statement);
+        resolver.resolve(tree, statement);
+        if (compileOptions.optimize) {
+            optimizer.optimize(tree, statement);
+        }
+        interpreter.execute(tree, statement);
+    });
+}
+
+const Tree& EmojiProgram::syntaxTree() const {
+    return *tree;
+}
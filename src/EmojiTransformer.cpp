@@ -1,4 +1,5 @@
 #include "EmojiTransformer.hpp"
+#include "EmojiTable.hpp"
 #include <iostream>
 
 EmojiTransformer::EmojiTransformer() {
@@ -6,190 +7,95 @@ EmojiTransformer::EmojiTransformer() {
 }
 
 void EmojiTransformer::initializeMappings() {
-    emojiMappings = {
-        {"😭", "<"},
-        {"😁", ">"},
-        {"😁😌", ">="},
-        {"😭😌", "<="},
-        {"😌😌", "=="},
-        {"❗😌", "!="}
-    };
-}
-
-void EmojiTransformer::visit(TreePtr tree) {
-    if (!tree) return;
-    
-    if (tree->data == "if_stmt") {
-        visitIfStatement(tree);
-    } else if (tree->data == "boolean") {
-        visitBoolean(tree);
-    } else if (tree->data == "castexpression") {
-        visitCastExpression(tree);
-    } else if (tree->data == "multiplicativeexpression") {
-        visitMultiplicativeExpression(tree);
-    } else if (tree->data == "additiveexpression") {
-        visitAdditiveExpression(tree);
-    } else if (tree->data == "equalityexpression") {
-        visitEqualityExpression(tree);
-    } else if (tree->data == "andexpression") {
-        visitAndExpression(tree);
-    } else if (tree->data == "exclusiveorexpression") {
-        visitExclusiveOrExpression(tree);
-    } else if (tree->data == "inclusiveorexpression") {
-        visitInclusiveOrExpression(tree);
-    } else if (tree->data == "logicalandexpression") {
-        visitLogicalAndExpression(tree);
-    } else if (tree->data == "logicalorexpression") {
-        visitLogicalOrExpression(tree);
-    }
-    
-    visitChildren(tree);
-}
-
-void EmojiTransformer::visitChildren(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TreePtr>(child)) {
-            visit(std::get<TreePtr>(child));
-        }
+    emojiMappings.clear();
+    for (const auto& mapping : EMOJI_MAPPINGS) {
+        emojiMappings.emplace(mapping.emoji, mapping.text);
     }
 }
 
-void EmojiTransformer::visitIfStatement(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "🚩") {
-                token->value = "if";
-            } else if (token->value == "🏳") {
-                token->value = "elif";
-            } else if (token->value == "🏁") {
-                token->value = "else";
-            }
-        }
-    }
-}
-
-void EmojiTransformer::visitBoolean(TreePtr tree) {
-    if (!tree->children.empty() && std::holds_alternative<TokenPtr>(tree->children[0])) {
-        auto token = std::get<TokenPtr>(tree->children[0]);
-        if (token->value == "✔") {
-            token->value = "true";
-        } else if (token->value == "❌") {
-            token->value = "false";
-        }
+void EmojiTransformer::visit(Tree& tree) {
+    if (tree.nodeCount() == 0) return;
+    visit(tree, tree.root);
+}
+
+void EmojiTransformer::visit(Tree& tree, NodeId node) {
+    switch (tree.kind(node)) {
+        case NodeKind::IF_STMT:
+            visitIfStatement(tree, node);
+            break;
+        case NodeKind::BOOLEAN:
+            visitBoolean(tree, node);
+            break;
+        case NodeKind::CASTEXPRESSION:
+            visitCastExpression(tree, node);
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            visitOperatorExpression(tree, node);
+            break;
+        default:
+            break;
     }
-}
-
-void EmojiTransformer::visitCastExpression(TreePtr tree) {
-    if (tree->children.size() <= 1) return;
     
-    if (std::holds_alternative<TokenPtr>(tree->children[0])) {
-        auto token = std::get<TokenPtr>(tree->children[0]);
-        if (token->value == "❗") {
-            token->value = "!";
-        } else if (token->value == "〰") {
-            token->value = "~";
-        }
-    }
-}
-
-void EmojiTransformer::visitMultiplicativeExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "✖") {
-                token->value = "*";
-            } else if (token->value == "➗") {
-                token->value = "/";
-            } else if (token->value == "📎") {
-                token->value = "%";
-            }
-        }
-    }
-}
-
-void EmojiTransformer::visitAdditiveExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "➕") {
-                token->value = "+";
-            } else if (token->value == "➖") {
-                token->value = "-";
-            }
-        }
-    }
-}
-
-void EmojiTransformer::visitEqualityExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (emojiMappings.find(token->value) != emojiMappings.end()) {
-                token->value = emojiMappings[token->value];
-            }
-        }
-    }
+    visitChildren(tree, node);
 }
 
-void EmojiTransformer::visitAndExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "⚛") {
-                token->value = "&";
-            }
+void EmojiTransformer::visitChildren(Tree& tree, NodeId node) {
+    for (const Child& child : tree.children(node)) {
+        if (!child.isLeaf) {
+            visit(tree, child.index);
         }
     }
 }
 
-void EmojiTransformer::visitExclusiveOrExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "⚓") {
-                token->value = "xor";
-            }
+void EmojiTransformer::visitIfStatement(Tree& tree, NodeId node) {
+    // The only direct token children of an if_stmt are the if/elif/else keywords
+    for (const Child& child : tree.children(node)) {
+        if (child.isLeaf) {
+            Leaf& token = tree.leaf(child);
+            token.value = getMatch(token.value);
         }
     }
 }
 
-void EmojiTransformer::visitInclusiveOrExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "☯") {
-                token->value = "|";
-            }
-        }
+void EmojiTransformer::visitBoolean(Tree& tree, NodeId node) {
+    auto children = tree.children(node);
+    if (!children.empty() && children[0].isLeaf) {
+        Leaf& token = tree.leaf(children[0]);
+        token.value = getMatch(token.value);
     }
 }
 
-void EmojiTransformer::visitLogicalAndExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "😠") {
-                token->value = "and";
-            }
-        }
+void EmojiTransformer::visitCastExpression(Tree& tree, NodeId node) {
+    auto children = tree.children(node);
+    if (children.size() <= 1) return;
+    
+    if (children[0].isLeaf) {
+        Leaf& token = tree.leaf(children[0]);
+        token.value = getMatch(token.value);
     }
 }
 
-void EmojiTransformer::visitLogicalOrExpression(TreePtr tree) {
-    for (auto& child : tree->children) {
-        if (std::holds_alternative<TokenPtr>(child)) {
-            auto token = std::get<TokenPtr>(child);
-            if (token->value == "😇") {
-                token->value = "or";
-            }
+void EmojiTransformer::visitOperatorExpression(Tree& tree, NodeId node) {
+    // Operands are always subtrees, so every direct token child is an operator
+    for (const Child& child : tree.children(node)) {
+        if (child.isLeaf) {
+            Leaf& token = tree.leaf(child);
+            token.value = getMatch(token.value);
         }
     }
 }
 
-std::string EmojiTransformer::getMatch(const std::string& emoji) {
-    if (emojiMappings.find(emoji) != emojiMappings.end()) {
-        return emojiMappings[emoji];
+std::string_view EmojiTransformer::getMatch(std::string_view emoji) {
+    auto it = emojiMappings.find(emoji);
+    if (it != emojiMappings.end()) {
+        return it->second;
     }
     return emoji;
 }
@@ -0,0 +1,465 @@
+#include "Ir.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+const char* irOpName(IrOp op) {
+    switch (op) {
+        case IrOp::CONST: return "const";
+        case IrOp::PHI: return "phi";
+        case IrOp::ADD: return "add";
+        case IrOp::SUB: return "sub";
+        case IrOp::MUL: return "mul";
+        case IrOp::DIV: return "div";
+        case IrOp::MOD: return "mod";
+        case IrOp::EQ: return "eq";
+        case IrOp::NE: return "ne";
+        case IrOp::LT: return "lt";
+        case IrOp::LE: return "le";
+        case IrOp::GT: return "gt";
+        case IrOp::GE: return "ge";
+        case IrOp::BAND: return "band";
+        case IrOp::BOR: return "bor";
+        case IrOp::BXOR: return "bxor";
+        case IrOp::AND: return "and";
+        case IrOp::OR: return "or";
+        case IrOp::NOT: return "not";
+        case IrOp::BNOT: return "bnot";
+        case IrOp::PRINT: return "print";
+        case IrOp::JUMP: return "jump";
+        case IrOp::BRANCH: return "branch";
+        case IrOp::RETURN: return "return";
+    }
+    return "?";
+}
+
+bool isTerminator(IrOp op) {
+    return op == IrOp::JUMP || op == IrOp::BRANCH || op == IrOp::RETURN;
+}
+
+bool isPure(IrOp op) {
+    return op != IrOp::MOD && op != IrOp::PRINT && op != IrOp::PHI && !isTerminator(op);
+}
+
+bool isCommutative(IrOp op) {
+    switch (op) {
+        case IrOp::ADD:
+        case IrOp::MUL:
+        case IrOp::EQ:
+        case IrOp::NE:
+        case IrOp::BAND:
+        case IrOp::BOR:
+        case IrOp::BXOR:
+        case IrOp::AND:
+        case IrOp::OR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+namespace {
+
+bool definesValue(IrOp op) {
+    return op != IrOp::PRINT && !isTerminator(op);
+}
+
+size_t operandCount(IrOp op) {
+    switch (op) {
+        case IrOp::CONST:
+        case IrOp::JUMP:
+        case IrOp::RETURN:
+            return 0;
+        case IrOp::NOT:
+        case IrOp::BNOT:
+        case IrOp::PRINT:
+        case IrOp::BRANCH:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+} // namespace
+
+BlockId IrFunction::addBlock() {
+    blocks.emplace_back();
+    return static_cast<BlockId>(blocks.size() - 1);
+}
+
+IrValue IrFunction::append(BlockId block, IrOp op, std::vector<IrValue> operands) {
+    IrInstruction instruction;
+    instruction.op = op;
+    instruction.block = block;
+    instruction.operands = std::move(operands);
+    instructions.push_back(std::move(instruction));
+    IrValue value = static_cast<IrValue>(instructions.size() - 1);
+    blocks[block].code.push_back(value);
+    return value;
+}
+
+IrValue IrFunction::insertBeforeTerminator(BlockId block, IrOp op, std::vector<IrValue> operands) {
+    IrValue value = append(block, op, std::move(operands));
+    std::vector<IrValue>& code = blocks[block].code;
+    if (code.size() >= 2 && isTerminator(instructions[code[code.size() - 2]].op)) {
+        std::swap(code[code.size() - 1], code[code.size() - 2]);
+    }
+    return value;
+}
+
+IrValue IrFunction::insertAfter(IrValue position, IrOp op, std::vector<IrValue> operands) {
+    BlockId block = instructions[position].block;
+    IrValue value = append(block, op, std::move(operands));
+    std::vector<IrValue>& code = blocks[block].code;
+    code.pop_back();
+    code.insert(std::find(code.begin(), code.end(), position) + 1, value);
+    return value;
+}
+
+IrValue IrFunction::addPhi(BlockId block) {
+    IrValue value = append(block, IrOp::PHI);
+    std::vector<IrValue>& code = blocks[block].code;
+    code.pop_back();
+    auto position = std::find_if(code.begin(), code.end(), [&](IrValue v) {
+        return instructions[v].op != IrOp::PHI;
+    });
+    code.insert(position, value);
+    return value;
+}
+
+IrValue IrFunction::constant(uint32_t index) {
+    if (constantIndex.size() <= index) {
+        constantIndex.resize(index + 1, UINT32_MAX);
+    }
+    if (constantIndex[index] == UINT32_MAX || instructions[constantIndex[index]].removed) {
+        IrValue value = append(entry, IrOp::CONST);
+        instructions[value].constant = index;
+        std::vector<IrValue>& code = blocks[entry].code;
+        code.pop_back();
+        code.insert(code.begin(), value);
+        constantIndex[index] = value;
+    }
+    return constantIndex[index];
+}
+
+IrValue IrFunction::constant(const Value& value) {
+    return constant(constants.add(value));
+}
+
+const Value& IrFunction::constantValue(IrValue value) const {
+    return constants[instructions[value].constant];
+}
+
+void IrFunction::jump(BlockId from, BlockId to) {
+    IrValue value = append(from, IrOp::JUMP);
+    instructions[value].targets[0] = to;
+    blocks[to].preds.push_back(from);
+}
+
+void IrFunction::branch(BlockId from, IrValue condition, BlockId ifTrue, BlockId ifFalse) {
+    if (ifTrue == ifFalse) {
+        jump(from, ifTrue);
+        return;
+    }
+    IrValue value = append(from, IrOp::BRANCH, {condition});
+    instructions[value].targets[0] = ifTrue;
+    instructions[value].targets[1] = ifFalse;
+    blocks[ifTrue].preds.push_back(from);
+    blocks[ifFalse].preds.push_back(from);
+}
+
+void IrFunction::moveBeforeTerminator(IrValue value, BlockId block) {
+    std::vector<IrValue>& from = blocks[instructions[value].block].code;
+    from.erase(std::find(from.begin(), from.end(), value));
+    std::vector<IrValue>& to = blocks[block].code;
+    to.insert(hasTerminator(block) ? to.end() - 1 : to.end(), value);
+    instructions[value].block = block;
+}
+
+void IrFunction::remove(IrValue value) {
+    std::vector<IrValue>& code = blocks[instructions[value].block].code;
+    code.erase(std::find(code.begin(), code.end(), value));
+    instructions[value].removed = true;
+}
+
+const IrInstruction& IrFunction::terminator(BlockId block) const {
+    return instructions[blocks[block].code.back()];
+}
+
+bool IrFunction::hasTerminator(BlockId block) const {
+    return !blocks[block].code.empty() && isTerminator(terminator(block).op);
+}
+
+std::vector<BlockId> IrFunction::successors(BlockId block) const {
+    if (!hasTerminator(block)) return {};
+    const IrInstruction& last = terminator(block);
+    if (last.op == IrOp::JUMP) return {last.targets[0]};
+    if (last.op == IrOp::BRANCH) return {last.targets[0], last.targets[1]};
+    return {};
+}
+
+std::vector<BlockId> IrFunction::reversePostorder() const {
+    std::vector<BlockId> postorder;
+    std::vector<bool> visited(blocks.size(), false);
+    // (block, next successor to visit)
+    std::vector<std::pair<BlockId, size_t>> stack{{entry, 0}};
+    visited[entry] = true;
+
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        std::vector<BlockId> succs = successors(block);
+        if (next < succs.size()) {
+            BlockId succ = succs[next++];
+            if (!visited[succ]) {
+                visited[succ] = true;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    std::reverse(postorder.begin(), postorder.end());
+    return postorder;
+}
+
+void IrFunction::replaceUses(const std::vector<IrValue>& replacement) {
+    auto resolve = [&](IrValue value) {
+        while (value < replacement.size() && replacement[value] != value) {
+            value = replacement[value];
+        }
+        return value;
+    };
+    for (IrInstruction& instruction : instructions) {
+        if (instruction.removed) continue;
+        for (IrValue& operand : instruction.operands) {
+            operand = resolve(operand);
+        }
+    }
+}
+
+std::string IrFunction::dump() const {
+    std::ostringstream out;
+
+    for (BlockId block : reversePostorder()) {
+        out << "b" << block << ":";
+        if (!blocks[block].preds.empty()) {
+            out << "  ; preds";
+            for (BlockId pred : blocks[block].preds) out << " b" << pred;
+        }
+        out << "\n";
+
+        for (IrValue value : blocks[block].code) {
+            const IrInstruction& instruction = instructions[value];
+            out << "    ";
+            if (definesValue(instruction.op)) out << "v" << value << " = ";
+            out << irOpName(instruction.op);
+
+            if (instruction.op == IrOp::CONST) {
+                const Value& constant = constants[instruction.constant];
+                if (constant.isString()) {
+                    out << " \"" << constant.toString() << "\"";
+                } else {
+                    out << " " << constant.toString();
+                }
+            } else if (instruction.op == IrOp::PHI) {
+                for (size_t i = 0; i < instruction.operands.size(); ++i) {
+                    out << " [b" << blocks[block].preds[i] << ": v" << instruction.operands[i] << "]";
+                }
+            } else {
+                for (IrValue operand : instruction.operands) out << " v" << operand;
+            }
+
+            if (instruction.op == IrOp::JUMP) {
+                out << " b" << instruction.targets[0];
+            } else if (instruction.op == IrOp::BRANCH) {
+                out << " b" << instruction.targets[0] << " b" << instruction.targets[1];
+            }
+            out << "\n";
+        }
+    }
+
+    return out.str();
+}
+
+void IrFunction::verify() const {
+    auto fail = [](const std::string& message) {
+        throw std::runtime_error("IR verification failed: " + message);
+    };
+    auto name = [](IrValue value) { return "v" + std::to_string(value); };
+
+    if (!blocks[entry].preds.empty()) fail("entry block has predecessors");
+
+    DominatorTree dominators(*this);
+    // Position of each instruction within its block, for same-block ordering
+    std::vector<size_t> position(instructions.size(), 0);
+    for (const IrBlock& block : blocks) {
+        for (size_t i = 0; i < block.code.size(); ++i) position[block.code[i]] = i;
+    }
+
+    for (BlockId b = 0; b < blocks.size(); ++b) {
+        const IrBlock& block = blocks[b];
+        if (block.removed) continue;
+        std::string where = " in b" + std::to_string(b);
+
+        if (block.code.empty() || !isTerminator(terminator(b).op)) fail("block does not end in a terminator" + where);
+
+        std::vector<BlockId> succs = successors(b);
+        for (BlockId succ : succs) {
+            if (blocks[succ].removed) fail("branch to removed block b" + std::to_string(succ) + where);
+            size_t edges = std::count(succs.begin(), succs.end(), succ);
+            size_t back = std::count(blocks[succ].preds.begin(), blocks[succ].preds.end(), b);
+            if (edges != back) fail("b" + std::to_string(succ) + " does not list b" + std::to_string(b) + " as a predecessor");
+        }
+        for (BlockId pred : block.preds) {
+            std::vector<BlockId> predSuccs = successors(pred);
+            if (blocks[pred].removed || std::find(predSuccs.begin(), predSuccs.end(), b) == predSuccs.end()) {
+                fail("predecessor b" + std::to_string(pred) + " does not branch to b" + std::to_string(b));
+            }
+        }
+
+        bool pastPhis = false;
+        for (size_t i = 0; i < block.code.size(); ++i) {
+            IrValue value = block.code[i];
+            const IrInstruction& instruction = instructions[value];
+            std::string what = name(value) + where;
+
+            if (instruction.removed) fail("removed instruction " + what + " still listed");
+            if (instruction.block != b) fail(what + " records the wrong block");
+            if (isTerminator(instruction.op) && i + 1 != block.code.size()) fail("terminator " + what + " is not last");
+            if (instruction.op == IrOp::PHI) {
+                if (pastPhis) fail("phi " + what + " follows a non-phi");
+                if (instruction.operands.size() != block.preds.size()) fail("phi " + what + " operand count differs from predecessor count");
+            } else {
+                pastPhis = true;
+                if (instruction.operands.size() != operandCount(instruction.op)) fail(what + " has the wrong number of operands");
+            }
+            if (instruction.op == IrOp::CONST && instruction.constant >= constants.size()) fail(what + " names a missing constant");
+
+            for (size_t k = 0; k < instruction.operands.size(); ++k) {
+                IrValue operand = instruction.operands[k];
+                if (operand >= instructions.size() || instructions[operand].removed ||
+                    !definesValue(instructions[operand].op)) {
+                    fail(what + " uses " + name(operand) + ", which is not a live value");
+                }
+                if (!dominators.reachable(b)) continue;
+
+                BlockId defBlock = instructions[operand].block;
+                if (instruction.op == IrOp::PHI) {
+                    BlockId pred = block.preds[k];
+                    if (dominators.reachable(pred) && !dominators.dominates(defBlock, pred)) {
+                        fail(what + " uses " + name(operand) + " from b" + std::to_string(pred) + ", which it does not dominate");
+                    }
+                } else if (defBlock == b ? position[operand] >= i : !dominators.dominates(defBlock, b)) {
+                    fail(what + " uses " + name(operand) + " before its definition");
+                }
+            }
+        }
+    }
+}
+
+DominatorTree::DominatorTree(const IrFunction& function)
+    : rpo(function.reversePostorder()),
+      order(function.blocks.size(), UNREACHABLE),
+      parent(function.blocks.size(), UNREACHABLE),
+      kids(function.blocks.size()) {
+    for (size_t i = 0; i < rpo.size(); ++i) order[rpo[i]] = static_cast<uint32_t>(i);
+
+    BlockId entry = function.entry;
+    parent[entry] = entry;
+
+    auto intersect = [&](BlockId a, BlockId b) {
+        while (a != b) {
+            while (order[a] > order[b]) a = parent[a];
+            while (order[b] > order[a]) b = parent[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BlockId block : rpo) {
+            if (block == entry) continue;
+            BlockId idom = UNREACHABLE;
+            for (BlockId pred : function.blocks[block].preds) {
+                if (order[pred] == UNREACHABLE || parent[pred] == UNREACHABLE) continue;
+                idom = idom == UNREACHABLE ? pred : intersect(pred, idom);
+            }
+            if (idom != parent[block]) {
+                parent[block] = idom;
+                changed = true;
+            }
+        }
+    }
+
+    for (BlockId block : rpo) {
+        if (block != entry) kids[parent[block]].push_back(block);
+    }
+}
+
+bool DominatorTree::dominates(BlockId a, BlockId b) const {
+    if (!reachable(b) || !reachable(a)) return false;
+    while (true) {
+        if (a == b) return true;
+        BlockId up = parent[b];
+        if (up == b) return false;
+        b = up;
+    }
+}
+
+std::vector<IrLoop> findLoops(const IrFunction& function, const DominatorTree& dominators) {
+    std::vector<IrLoop> loops;
+
+    for (BlockId block : dominators.reversePostorder()) {
+        for (BlockId succ : function.successors(block)) {
+            if (!dominators.dominates(succ, block)) continue;
+
+            auto existing = std::find_if(loops.begin(), loops.end(), [&](const IrLoop& loop) {
+                return loop.header == succ;
+            });
+            if (existing == loops.end()) {
+                IrLoop loop;
+                loop.header = succ;
+                loop.preheader = UINT32_MAX;
+                loop.contains.assign(function.blocks.size(), false);
+                loop.contains[succ] = true;
+                loops.push_back(std::move(loop));
+                existing = loops.end() - 1;
+            }
+            existing->latches.push_back(block);
+
+            std::vector<BlockId> work{block};
+            while (!work.empty()) {
+                BlockId current = work.back();
+                work.pop_back();
+                if (existing->contains[current]) continue;
+                existing->contains[current] = true;
+                for (BlockId pred : function.blocks[current].preds) {
+                    if (dominators.reachable(pred)) work.push_back(pred);
+                }
+            }
+        }
+    }
+
+    for (IrLoop& loop : loops) {
+        std::vector<BlockId> outside;
+        for (BlockId pred : function.blocks[loop.header].preds) {
+            if (!loop.contains[pred]) outside.push_back(pred);
+        }
+        if (outside.size() == 1 && function.successors(outside[0]).size() == 1) {
+            loop.preheader = outside[0];
+        }
+        for (const IrLoop& other : loops) {
+            if (&other != &loop && other.contains[loop.header] &&
+                std::count(other.contains.begin(), other.contains.end(), true) >
+                std::count(loop.contains.begin(), loop.contains.end(), true)) {
+                loop.depth++;
+            }
+        }
+    }
+
+    std::sort(loops.begin(), loops.end(), [](const IrLoop& a, const IrLoop& b) { return a.depth > b.depth; });
+    return loops;
+}
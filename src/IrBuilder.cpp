@@ -0,0 +1,428 @@
+#include "IrBuilder.hpp"
+#include <stdexcept>
+
+namespace {
+
+constexpr IrValue NO_VALUE = UINT32_MAX;
+
+bool isBinaryExpression(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Same spellings as the BytecodeCompiler accepts
+IrOp binaryOp(NodeKind kind, std::string_view op) {
+    switch (kind) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") return IrOp::ADD;
+            if (op == "-" || op == "➖") return IrOp::SUB;
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") return IrOp::MUL;
+            if (op == "/" || op == "➗") return IrOp::DIV;
+            if (op == "%" || op == "mod" || op == "📎") return IrOp::MOD;
+            break;
+        case NodeKind::EQUALITYEXPRESSION:
+            switch (compareOpFromText(op)) {
+                case CompareOp::EQ: return IrOp::EQ;
+                case CompareOp::NE: return IrOp::NE;
+                case CompareOp::LT: return IrOp::LT;
+                case CompareOp::LE: return IrOp::LE;
+                case CompareOp::GT: return IrOp::GT;
+                case CompareOp::GE: return IrOp::GE;
+            }
+            break;
+        case NodeKind::ANDEXPRESSION:
+            if (op == "&" || op == "⚛") return IrOp::BAND;
+            break;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op == "|" || op == "☯") return IrOp::BOR;
+            break;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op == "^" || op == "xor" || op == "⚓") return IrOp::BXOR;
+            break;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op == "&&" || op == "and" || op == "😠") return IrOp::AND;
+            break;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op == "||" || op == "or" || op == "😇") return IrOp::OR;
+            break;
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator '" + std::string(op) + "' in " + nodeKindName(kind));
+}
+
+} // namespace
+
+IrFunction IrBuilder::build(const Tree& source) {
+    tree = &source;
+    function = IrFunction{};
+    // Literal nodes keep their pool indices
+    function.constants = tree->constants;
+    slotCount = tree->frameSize;
+    loopTargets.clear();
+    definitions.clear();
+    sealed.clear();
+    incompletePhis.clear();
+    replacement.clear();
+
+    function.entry = newBlock();
+    sealBlock(function.entry);
+    current = function.entry;
+
+    if (tree->nodeCount() > 0) {
+        if (tree->kind(tree->root) == NodeKind::STMT) {
+            for (const Child& statement : tree->children(tree->root)) {
+                lowerTopLevel(statement.index);
+            }
+        } else {
+            lowerTopLevel(tree->root);
+        }
+    }
+    function.append(current, IrOp::RETURN);
+
+    std::vector<IrValue> resolved(function.instructions.size());
+    for (IrValue value = 0; value < resolved.size(); ++value) {
+        resolved[value] = resolve(value);
+    }
+    function.replaceUses(resolved);
+
+    tree = nullptr;
+    return std::move(function);
+}
+
+BlockId IrBuilder::newBlock() {
+    definitions.emplace_back(slotCount, NO_VALUE);
+    sealed.push_back(false);
+    incompletePhis.emplace_back();
+    return function.addBlock();
+}
+
+void IrBuilder::sealBlock(BlockId block) {
+    for (auto [slot, phi] : incompletePhis[block]) {
+        addPhiOperands(slot, phi);
+    }
+    incompletePhis[block].clear();
+    sealed[block] = true;
+}
+
+IrValue IrBuilder::resolve(IrValue value) {
+    while (value < replacement.size() && replacement[value] != NO_VALUE) {
+        value = replacement[value];
+    }
+    return value;
+}
+
+void IrBuilder::writeVariable(uint32_t slot, BlockId block, IrValue value) {
+    definitions[block][slot] = value;
+}
+
+IrValue IrBuilder::readVariable(uint32_t slot, BlockId block) {
+    IrValue value = definitions[block][slot];
+    if (value != NO_VALUE) return resolve(value);
+    return readVariableRecursive(slot, block);
+}
+
+IrValue IrBuilder::readVariableRecursive(uint32_t slot, BlockId block) {
+    const std::vector<BlockId>& preds = function.blocks[block].preds;
+    IrValue value;
+
+    if (!sealed[block]) {
+        // More predecessors may still appear: complete the phi on sealing
+        value = function.addPhi(block);
+        incompletePhis[block].emplace_back(slot, value);
+    } else if (preds.size() == 1) {
+        value = readVariable(slot, preds[0]);
+    } else if (preds.empty()) {
+        // Entry or unreachable code: the slot was never written
+        value = function.constant(Value());
+    } else {
+        // Write the phi first so a cycle through a loop finds it
+        IrValue phi = function.addPhi(block);
+        writeVariable(slot, block, phi);
+        value = addPhiOperands(slot, phi);
+    }
+
+    writeVariable(slot, block, value);
+    return value;
+}
+
+IrValue IrBuilder::addPhiOperands(uint32_t slot, IrValue phi) {
+    std::vector<BlockId> preds = function.blocks[function.instructions[phi].block].preds;
+    for (BlockId pred : preds) {
+        IrValue operand = readVariable(slot, pred);
+        function.instructions[phi].operands.push_back(operand);
+    }
+    return tryRemoveTrivialPhi(phi);
+}
+
+IrValue IrBuilder::tryRemoveTrivialPhi(IrValue phi) {
+    IrValue same = NO_VALUE;
+    for (IrValue operand : function.instructions[phi].operands) {
+        operand = resolve(operand);
+        if (operand == same || operand == phi) continue;
+        if (same != NO_VALUE) return phi; // merges at least two values
+        same = operand;
+    }
+    if (same == NO_VALUE) {
+        same = function.constant(Value());
+    }
+
+    if (replacement.size() <= phi) {
+        replacement.resize(function.instructions.size(), NO_VALUE);
+    }
+    replacement[phi] = same;
+    function.remove(phi);
+
+    // Complete phis that used this one may have become trivial in turn
+    for (IrValue user = 0; user < function.instructions.size(); ++user) {
+        const IrInstruction& instruction = function.instructions[user];
+        if (instruction.removed || instruction.op != IrOp::PHI || !sealed[instruction.block] ||
+            instruction.operands.size() != function.blocks[instruction.block].preds.size()) {
+            continue;
+        }
+        for (IrValue operand : instruction.operands) {
+            if (operand != user && resolve(operand) == same) {
+                tryRemoveTrivialPhi(user);
+                break;
+            }
+        }
+    }
+
+    return same;
+}
+
+void IrBuilder::lowerTopLevel(NodeId node) {
+    // A break or continue outside any loop skips the rest of its top-level statement
+    BlockId after = newBlock();
+    loopTargets.push_back({after, after});
+    lowerStatement(node);
+    loopTargets.pop_back();
+    function.jump(current, after);
+    sealBlock(after);
+    current = after;
+}
+
+void IrBuilder::lowerStatement(NodeId node) {
+    switch (tree->kind(node)) {
+        case NodeKind::DECLARE_STMT:
+            lowerDeclare(node);
+            break;
+        case NodeKind::ASSIGNMENT_STMT:
+            lowerAssignment(node);
+            break;
+        case NodeKind::PRINT_STMT:
+            function.append(current, IrOp::PRINT, {lowerExpression(tree->children(node)[0].index)});
+            break;
+        case NodeKind::IF_STMT:
+            lowerIf(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            lowerWhile(node);
+            break;
+        case NodeKind::FOR_STMT:
+            lowerFor(node);
+            break;
+        case NodeKind::FLOW_STMT:
+            lowerFlow(node);
+            break;
+        case NodeKind::SUITE:
+            lowerSuite(node);
+            break;
+        case NodeKind::SPAWN_STMT:
+        case NodeKind::JOIN_STMT:
+            throw std::runtime_error("Cannot lower '🚀' or '🤝' to IR: tasks only run on the tree walker");
+        default:
+            lowerExpression(node); // evaluated for its errors only
+            break;
+    }
+}
+
+void IrBuilder::lowerSuite(NodeId node) {
+    for (const Child& statement : tree->children(node)) {
+        lowerStatement(statement.index);
+    }
+}
+
+void IrBuilder::lowerDeclare(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+            lowerAssignment(child.index);
+        } else {
+            writeVariable(tree->payload(child.index), current, function.constant(Value(0)));
+        }
+    }
+}
+
+void IrBuilder::lowerAssignment(NodeId node) {
+    auto children = tree->children(node);
+    // The value is read first, so "📢 x 😌 x" still reads an outer x
+    IrValue value = lowerExpression(children[1].index);
+    writeVariable(tree->payload(children[0].index), current, value);
+}
+
+void IrBuilder::lowerIf(NodeId node) {
+    auto children = tree->children(node);
+    BlockId end = newBlock();
+
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree->leaf(children[i]).value;
+        if (keyword == "else" || keyword == "🏁") {
+            lowerSuite(children[i + 1].index);
+            break;
+        }
+
+        IrValue condition = lowerExpression(children[i + 1].index);
+        BlockId then = newBlock();
+        BlockId next = newBlock();
+        function.branch(current, condition, then, next);
+        sealBlock(then);
+        sealBlock(next);
+
+        current = then;
+        lowerSuite(children[i + 2].index);
+        function.jump(current, end);
+
+        current = next;
+        i += 3;
+    }
+
+    function.jump(current, end);
+    sealBlock(end);
+    current = end;
+}
+
+void IrBuilder::lowerWhile(NodeId node) {
+    auto children = tree->children(node);
+
+    BlockId preheader = newBlock();
+    function.jump(current, preheader);
+    sealBlock(preheader);
+    BlockId header = newBlock();
+    function.jump(preheader, header);
+
+    BlockId body = newBlock();
+    BlockId exit = newBlock();
+    current = header;
+    IrValue condition = lowerExpression(children[0].index);
+    function.branch(current, condition, body, exit);
+    sealBlock(body);
+
+    loopTargets.push_back({exit, header});
+    current = body;
+    lowerSuite(children[1].index);
+    function.jump(current, header);
+    loopTargets.pop_back();
+
+    sealBlock(header);
+    sealBlock(exit);
+    current = exit;
+}
+
+void IrBuilder::lowerFor(NodeId node) {
+    auto children = tree->children(node);
+    NodeId decl = children[0].index;
+    NodeId test = children[1].index;
+    NodeId updates = children[2].index;
+
+    for (const Child& init : tree->children(decl)) {
+        lowerStatement(init.index);
+    }
+
+    BlockId preheader = newBlock();
+    function.jump(current, preheader);
+    sealBlock(preheader);
+    BlockId header = newBlock();
+    function.jump(preheader, header);
+
+    BlockId body = newBlock();
+    BlockId next = newBlock();
+    BlockId exit = newBlock();
+    current = header;
+    if (tree->size(test) > 0) {
+        IrValue condition = lowerExpression(tree->children(test)[0].index);
+        function.branch(current, condition, body, exit);
+    } else {
+        function.jump(current, body);
+    }
+    sealBlock(body);
+
+    loopTargets.push_back({exit, next});
+    current = body;
+    lowerSuite(children[3].index);
+    function.jump(current, next);
+    loopTargets.pop_back();
+
+    sealBlock(next);
+    current = next;
+    for (const Child& update : tree->children(updates)) {
+        lowerStatement(update.index);
+    }
+    function.jump(current, header);
+
+    sealBlock(header);
+    sealBlock(exit);
+    current = exit;
+}
+
+void IrBuilder::lowerFlow(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        NodeKind kind = tree->kind(child.index);
+        if (kind != NodeKind::BREAK_STMT && kind != NodeKind::CONTINUE_STMT) continue;
+
+        const LoopTargets& targets = loopTargets.back();
+        function.jump(current, kind == NodeKind::BREAK_STMT ? targets.breakTarget : targets.continueTarget);
+        // Whatever follows in the suite is unreachable
+        current = newBlock();
+        sealBlock(current);
+    }
+}
+
+IrValue IrBuilder::lowerExpression(NodeId node) {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+
+    if (kind == NodeKind::NAME) {
+        return readVariable(tree->payload(node), current);
+    }
+    if (kind == NodeKind::NUMBER || kind == NodeKind::STRING || kind == NodeKind::BOOLEAN ||
+        kind == NodeKind::CONSTANT) {
+        return function.constant(tree->payload(node));
+    }
+
+    if (kind == NodeKind::CASTEXPRESSION) {
+        if (children.size() == 1) {
+            return lowerExpression(children[0].index);
+        }
+        std::string_view op = tree->leaf(children[0]).value;
+        IrValue operand = lowerExpression(children[1].index);
+        bool isNot = op == "!" || op == "not" || op == "❗";
+        return function.append(current, isNot ? IrOp::NOT : IrOp::BNOT, {operand});
+    }
+
+    if (isBinaryExpression(kind)) {
+        IrOp op = binaryOp(kind, tree->leaf(children[1]).value);
+        IrValue left = lowerExpression(children[0].index);
+        IrValue right = lowerExpression(children[2].index);
+        return function.append(current, op, {left, right});
+    }
+
+    if (kind == NodeKind::EXP && !children.empty()) {
+        return lowerExpression(children[0].index);
+    }
+
+    throw std::runtime_error(std::string("Cannot lower '") + nodeKindName(kind) + "' to IR");
+}
@@ -0,0 +1,326 @@
+#include "IrLowering.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t NO_REGISTER = UINT32_MAX;
+
+OpCode opCode(IrOp op) {
+    switch (op) {
+        case IrOp::ADD: return OpCode::ADD;
+        case IrOp::SUB: return OpCode::SUB;
+        case IrOp::MUL: return OpCode::MUL;
+        case IrOp::DIV: return OpCode::DIV;
+        case IrOp::MOD: return OpCode::MOD;
+        case IrOp::EQ: return OpCode::EQ;
+        case IrOp::NE: return OpCode::NE;
+        case IrOp::LT: return OpCode::LT;
+        case IrOp::LE: return OpCode::LE;
+        case IrOp::GT: return OpCode::GT;
+        case IrOp::GE: return OpCode::GE;
+        case IrOp::BAND: return OpCode::BAND;
+        case IrOp::BOR: return OpCode::BOR;
+        case IrOp::BXOR: return OpCode::BXOR;
+        case IrOp::AND: return OpCode::AND;
+        case IrOp::OR: return OpCode::OR;
+        case IrOp::NOT: return OpCode::NOT;
+        case IrOp::BNOT: return OpCode::BNOT;
+        default:
+            throw std::runtime_error(std::string("No bytecode for IR op ") + irOpName(op));
+    }
+}
+
+size_t predIndex(const IrFunction& function, BlockId from, BlockId to) {
+    const std::vector<BlockId>& preds = function.blocks[to].preds;
+    return static_cast<size_t>(std::find(preds.begin(), preds.end(), from) - preds.begin());
+}
+
+// Reverse postorder with the true side of each branch visited last, so that
+// it lands directly after the branch and the false side is the jump
+std::vector<BlockId> layoutOrder(const IrFunction& function) {
+    std::vector<BlockId> postorder;
+    std::vector<bool> visited(function.blocks.size(), false);
+    std::vector<std::pair<BlockId, std::vector<BlockId>>> stack;
+    auto push = [&](BlockId block) {
+        visited[block] = true;
+        std::vector<BlockId> succs = function.successors(block);
+        stack.emplace_back(block, std::vector<BlockId>(succs.begin(), succs.end()));
+    };
+
+    push(function.entry);
+    while (!stack.empty()) {
+        std::vector<BlockId>& pending = stack.back().second;
+        if (pending.empty()) {
+            postorder.push_back(stack.back().first);
+            stack.pop_back();
+            continue;
+        }
+        BlockId succ = pending.back();
+        pending.pop_back();
+        if (!visited[succ]) push(succ);
+    }
+
+    std::reverse(postorder.begin(), postorder.end());
+    return postorder;
+}
+
+} // namespace
+
+BytecodeProgram IrLowering::lower(const IrFunction& source) {
+    function = &source;
+    program = BytecodeProgram{};
+    program.constants = source.constants.all();
+    fixups.clear();
+
+    std::vector<BlockId> order = layoutOrder(source);
+    assignRegisters(order);
+    blockStart.assign(source.blocks.size(), 0);
+    std::vector<Stub> stubs;
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        BlockId block = order[i];
+        BlockId next = i + 1 < order.size() ? order[i + 1] : UINT32_MAX;
+        blockStart[block] = program.code.size();
+
+        for (IrValue value : source.blocks[block].code) {
+            const IrInstruction& instruction = source.instructions[value];
+            switch (instruction.op) {
+                case IrOp::CONST:
+                case IrOp::PHI:
+                    break;
+                case IrOp::PRINT:
+                    emit(OpCode::PRINT, registers[instruction.operands[0]]);
+                    break;
+                case IrOp::JUMP:
+                    emitCopies(block, instruction.targets[0]);
+                    if (instruction.targets[0] != next) emitJump(instruction.targets[0]);
+                    break;
+                case IrOp::BRANCH: {
+                    BlockId ifTrue = instruction.targets[0];
+                    BlockId ifFalse = instruction.targets[1];
+                    size_t skip = emit(OpCode::JUMP_IF_FALSE, registers[instruction.operands[0]]);
+                    if (needsCopies(block, ifFalse)) {
+                        stubs.push_back({skip, block, ifFalse});
+                    } else {
+                        fixups.push_back({skip, ifFalse});
+                    }
+                    emitCopies(block, ifTrue);
+                    if (ifTrue != next) emitJump(ifTrue);
+                    break;
+                }
+                case IrOp::RETURN:
+                    emit(OpCode::HALT);
+                    break;
+                default: {
+                    uint32_t right = instruction.operands.size() > 1 ? registers[instruction.operands[1]] : 0;
+                    emit(opCode(instruction.op), registers[value], registers[instruction.operands[0]], right);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Copies for the false edge of a branch
+    for (const Stub& stub : stubs) {
+        program.code[stub.branch].b = static_cast<uint32_t>(program.code.size());
+        emitCopies(stub.from, stub.to);
+        emitJump(stub.to);
+    }
+    for (const Fixup& fixup : fixups) {
+        program.code[fixup.instruction].b = static_cast<uint32_t>(blockStart[fixup.target]);
+    }
+    // Jumps to jumps go straight to the final target
+    for (Instruction& instruction : program.code) {
+        if (instruction.op != OpCode::JUMP && instruction.op != OpCode::JUMP_IF_FALSE) continue;
+        for (size_t hops = 0; hops < program.code.size() && program.code[instruction.b].op == OpCode::JUMP; ++hops) {
+            instruction.b = program.code[instruction.b].b;
+        }
+    }
+
+    function = nullptr;
+    return std::move(program);
+}
+
+void IrLowering::assignRegisters(const std::vector<BlockId>& order) {
+    const IrFunction& source = *function;
+    registers.assign(source.instructions.size(), NO_REGISTER);
+
+    uint32_t next = static_cast<uint32_t>(program.constants.size());
+    for (BlockId block : order) {
+        for (IrValue value : source.blocks[block].code) {
+            const IrInstruction& instruction = source.instructions[value];
+            if (instruction.op == IrOp::CONST) {
+                registers[value] = instruction.constant;
+            } else if (instruction.op != IrOp::PRINT && !isTerminator(instruction.op)) {
+                registers[value] = next++;
+            }
+        }
+    }
+    scratch = next;
+    program.registerCount = next + 1;
+
+    coalesce(order);
+}
+
+void IrLowering::coalesce(const std::vector<BlockId>& order) {
+    const IrFunction& source = *function;
+    size_t words = (source.instructions.size() + 63) / 64;
+    using Bits = std::vector<uint64_t>;
+    auto test = [](const Bits& bits, IrValue value) { return (bits[value / 64] >> (value % 64)) & 1; };
+    auto set = [](Bits& bits, IrValue value) { bits[value / 64] |= uint64_t(1) << (value % 64); };
+    auto reset = [](Bits& bits, IrValue value) { bits[value / 64] &= ~(uint64_t(1) << (value % 64)); };
+    auto isVariable = [&](IrValue value) { return source.instructions[value].op != IrOp::CONST; };
+
+    // Liveness; a phi operand is live out of the predecessor it comes from
+    std::vector<Bits> liveIn(source.blocks.size(), Bits(words, 0));
+    std::vector<Bits> liveOut(source.blocks.size(), Bits(words, 0));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            BlockId block = *it;
+            Bits live(words, 0);
+            for (BlockId succ : source.successors(block)) {
+                size_t index = predIndex(source, block, succ);
+                for (size_t w = 0; w < words; ++w) live[w] |= liveIn[succ][w];
+                for (IrValue phi : source.blocks[succ].code) {
+                    if (source.instructions[phi].op != IrOp::PHI) break;
+                    IrValue operand = source.instructions[phi].operands[index];
+                    if (isVariable(operand)) set(live, operand);
+                }
+            }
+            liveOut[block] = live;
+
+            const std::vector<IrValue>& code = source.blocks[block].code;
+            for (auto at = code.rbegin(); at != code.rend(); ++at) {
+                const IrInstruction& instruction = source.instructions[*at];
+                reset(live, *at);
+                if (instruction.op == IrOp::PHI) continue;
+                for (IrValue operand : instruction.operands) {
+                    if (isVariable(operand)) set(live, operand);
+                }
+            }
+            if (live != liveIn[block]) {
+                liveIn[block] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+
+    // Is `value` still needed right after `definition` executes? Phis of a
+    // block are all written at once on entry.
+    auto liveAt = [&](IrValue definition, IrValue value) {
+        const IrInstruction& instruction = source.instructions[definition];
+        BlockId block = instruction.block;
+        if (instruction.op == IrOp::PHI) {
+            const IrInstruction& other = source.instructions[value];
+            return test(liveIn[block], value) || (other.op == IrOp::PHI && other.block == block);
+        }
+        if (test(liveOut[block], value)) return true;
+        const std::vector<IrValue>& code = source.blocks[block].code;
+        return std::any_of(std::find(code.begin(), code.end(), definition) + 1, code.end(), [&](IrValue user) {
+            const std::vector<IrValue>& operands = source.instructions[user].operands;
+            return source.instructions[user].op != IrOp::PHI &&
+                   std::find(operands.begin(), operands.end(), value) != operands.end();
+        });
+    };
+
+    // A phi and its operands share one register when no two of them
+    // interfere, i.e. none is live where another one is written. Values
+    // merged this way form classes that grow one phi at a time.
+    std::vector<IrValue> leader(source.instructions.size());
+    std::vector<std::vector<IrValue>> members(source.instructions.size());
+    for (IrValue value = 0; value < leader.size(); ++value) {
+        leader[value] = value;
+        members[value] = {value};
+    }
+    auto find = [&](IrValue value) {
+        while (leader[value] != value) value = leader[value] = leader[leader[value]];
+        return value;
+    };
+
+    for (BlockId block : order) {
+        for (IrValue phi : source.blocks[block].code) {
+            if (source.instructions[phi].op != IrOp::PHI) break;
+
+            for (IrValue value : source.instructions[phi].operands) {
+                IrValue root = find(phi);
+                IrValue other = find(value);
+                if (source.instructions[value].op == IrOp::CONST || other == root) continue;
+
+                bool interferes = false;
+                for (IrValue a : members[root]) {
+                    for (IrValue b : members[other]) {
+                        if (liveAt(a, b) || liveAt(b, a)) interferes = true;
+                    }
+                }
+                if (interferes) continue;
+
+                leader[other] = root;
+                members[root].insert(members[root].end(), members[other].begin(), members[other].end());
+                members[other].clear();
+            }
+        }
+    }
+
+    for (IrValue value = 0; value < registers.size(); ++value) {
+        if (registers[value] != NO_REGISTER && source.instructions[value].op != IrOp::CONST) {
+            registers[value] = registers[find(value)];
+        }
+    }
+}
+
+bool IrLowering::needsCopies(BlockId from, BlockId to) const {
+    const IrFunction& source = *function;
+    size_t index = predIndex(source, from, to);
+    for (IrValue phi : source.blocks[to].code) {
+        if (source.instructions[phi].op != IrOp::PHI) break;
+        if (registers[phi] != registers[source.instructions[phi].operands[index]]) return true;
+    }
+    return false;
+}
+
+void IrLowering::emitCopies(BlockId from, BlockId to) {
+    const IrFunction& source = *function;
+    size_t index = predIndex(source, from, to);
+
+    // (destination, source) pairs, to be performed as if in parallel
+    std::vector<std::pair<uint32_t, uint32_t>> copies;
+    for (IrValue phi : source.blocks[to].code) {
+        if (source.instructions[phi].op != IrOp::PHI) break;
+        uint32_t target = registers[phi];
+        uint32_t value = registers[source.instructions[phi].operands[index]];
+        if (target != value) copies.emplace_back(target, value);
+    }
+
+    while (!copies.empty()) {
+        // A copy whose destination no other copy still reads can go now
+        auto ready = std::find_if(copies.begin(), copies.end(), [&](const auto& copy) {
+            return std::none_of(copies.begin(), copies.end(), [&](const auto& other) {
+                return other.second == copy.first;
+            });
+        });
+        if (ready != copies.end()) {
+            emit(OpCode::MOVE, ready->first, ready->second);
+            copies.erase(ready);
+            continue;
+        }
+
+        // Only cycles are left: save one destination and read it from there
+        uint32_t saved = copies.front().first;
+        emit(OpCode::MOVE, scratch, saved);
+        for (auto& copy : copies) {
+            if (copy.second == saved) copy.second = scratch;
+        }
+    }
+}
+
+void IrLowering::emitJump(BlockId target) {
+    fixups.push_back({emit(OpCode::JUMP), target});
+}
+
+size_t IrLowering::emit(OpCode op, uint32_t a, uint32_t b, uint32_t c) {
+    program.code.push_back(Instruction{op, a, b, c});
+    return program.code.size() - 1;
+}
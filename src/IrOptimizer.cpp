@@ -0,0 +1,504 @@
+#include "IrOptimizer.hpp"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace {
+
+constexpr IrValue NO_VALUE = UINT32_MAX;
+
+uint8_t typeBit(Value::Type type) {
+    return static_cast<uint8_t>(1u << static_cast<unsigned>(type));
+}
+
+const uint8_t INT_TYPE = typeBit(Value::Type::INT);
+const uint8_t DOUBLE_TYPE = typeBit(Value::Type::DOUBLE);
+const uint8_t BOOL_TYPE = typeBit(Value::Type::BOOL);
+
+} // namespace
+
+IrOptimizer::IrOptimizer(bool reduceModulo) : function(nullptr), reduceModuloEnabled(reduceModulo) {}
+
+void IrOptimizer::optimize(IrFunction& target) {
+    function = &target;
+
+    simplifyCfg();
+    eliminateCommonSubexpressions();
+    hoistLoopInvariants();
+    while (reduceStrength()) {
+    }
+    // Reduction leaves products of invariants behind in the preheaders
+    eliminateCommonSubexpressions();
+    hoistLoopInvariants();
+    eliminateDeadCode();
+    simplifyCfg();
+
+    function = nullptr;
+}
+
+void IrOptimizer::removeEdge(BlockId from, BlockId to) {
+    IrBlock& block = function->blocks[to];
+    auto position = std::find(block.preds.begin(), block.preds.end(), from);
+    if (position == block.preds.end()) return;
+    size_t index = static_cast<size_t>(position - block.preds.begin());
+    block.preds.erase(position);
+    for (IrValue value : block.code) {
+        IrInstruction& instruction = function->instructions[value];
+        if (instruction.op != IrOp::PHI) break;
+        instruction.operands.erase(instruction.operands.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+}
+
+void IrOptimizer::replaceValue(IrValue from, IrValue to) {
+    for (IrInstruction& instruction : function->instructions) {
+        if (instruction.removed) continue;
+        std::replace(instruction.operands.begin(), instruction.operands.end(), from, to);
+    }
+}
+
+bool IrOptimizer::simplifyCfg() {
+    IrFunction& f = *function;
+    bool changed = false;
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+
+        // Branches on a constant condition become jumps
+        for (BlockId block = 0; block < f.blocks.size(); ++block) {
+            if (f.blocks[block].removed || !f.hasTerminator(block)) continue;
+            const IrInstruction& last = f.terminator(block);
+            if (last.op != IrOp::BRANCH || f.instructions[last.operands[0]].op != IrOp::CONST) continue;
+
+            bool taken = f.constantValue(last.operands[0]).toBool();
+            BlockId keep = last.targets[taken ? 0 : 1];
+            BlockId drop = last.targets[taken ? 1 : 0];
+            f.remove(f.blocks[block].code.back());
+            f.instructions[f.append(block, IrOp::JUMP)].targets[0] = keep;
+            removeEdge(block, drop);
+            progress = true;
+        }
+
+        // Unreachable blocks disappear along with their outgoing edges
+        std::vector<bool> reachable(f.blocks.size(), false);
+        for (BlockId block : f.reversePostorder()) reachable[block] = true;
+        for (BlockId block = 0; block < f.blocks.size(); ++block) {
+            if (f.blocks[block].removed || reachable[block]) continue;
+            for (BlockId succ : f.successors(block)) removeEdge(block, succ);
+            for (IrValue value : f.blocks[block].code) f.instructions[value].removed = true;
+            f.blocks[block].code.clear();
+            f.blocks[block].preds.clear();
+            f.blocks[block].removed = true;
+            progress = true;
+        }
+
+        // Phis left with a single distinct operand
+        for (IrValue value = 0; value < f.instructions.size(); ++value) {
+            const IrInstruction& instruction = f.instructions[value];
+            if (instruction.removed || instruction.op != IrOp::PHI) continue;
+            IrValue same = NO_VALUE;
+            bool trivial = true;
+            for (IrValue operand : instruction.operands) {
+                if (operand == value || operand == same) continue;
+                if (same != NO_VALUE) {
+                    trivial = false;
+                    break;
+                }
+                same = operand;
+            }
+            if (!trivial || same == NO_VALUE) continue;
+            replaceValue(value, same);
+            f.remove(value);
+            progress = true;
+        }
+
+        // A block whose only successor has it as only predecessor absorbs it
+        for (BlockId block = 0; block < f.blocks.size(); ++block) {
+            if (f.blocks[block].removed || !f.hasTerminator(block)) continue;
+            const IrInstruction& last = f.terminator(block);
+            if (last.op != IrOp::JUMP) continue;
+            BlockId succ = last.targets[0];
+            if (succ == block || succ == f.entry || f.blocks[succ].preds.size() != 1) continue;
+            if (f.instructions[f.blocks[succ].code.front()].op == IrOp::PHI) continue;
+
+            f.remove(f.blocks[block].code.back());
+            for (IrValue value : f.blocks[succ].code) {
+                f.instructions[value].block = block;
+                f.blocks[block].code.push_back(value);
+            }
+            for (BlockId next : f.successors(block)) {
+                std::replace(f.blocks[next].preds.begin(), f.blocks[next].preds.end(), succ, block);
+            }
+            f.blocks[succ].code.clear();
+            f.blocks[succ].preds.clear();
+            f.blocks[succ].removed = true;
+            progress = true;
+        }
+
+        // Edges into a block that only jumps on go straight to its target,
+        // unless that target has phis to feed
+        for (BlockId block = 0; block < f.blocks.size(); ++block) {
+            IrBlock& empty = f.blocks[block];
+            if (empty.removed || block == f.entry || empty.code.size() != 1) continue;
+            const IrInstruction& only = f.instructions[empty.code.front()];
+            BlockId target = only.targets[0];
+            if (only.op != IrOp::JUMP || target == block || f.instructions[f.blocks[target].code.front()].op == IrOp::PHI) {
+                continue;
+            }
+
+            std::vector<BlockId> preds = empty.preds;
+            for (BlockId pred : preds) {
+                IrInstruction& jump = f.instructions[f.blocks[pred].code.back()];
+                if (jump.targets[0] == target || (jump.op == IrOp::BRANCH && jump.targets[1] == target)) {
+                    continue; // would give a branch the same target twice
+                }
+                for (BlockId& destination : jump.targets) {
+                    if (destination == block) destination = target;
+                }
+                removeEdge(pred, block);
+                f.blocks[target].preds.push_back(pred);
+                progress = true;
+            }
+        }
+
+        changed |= progress;
+    }
+
+    return changed;
+}
+
+bool IrOptimizer::eliminateCommonSubexpressions() {
+    IrFunction& f = *function;
+    DominatorTree dominators(f);
+
+    using Key = std::tuple<IrOp, IrValue, IrValue>;
+    std::map<Key, IrValue> available;
+    std::vector<Key> scopeKeys;
+    std::vector<IrValue> replacement(f.instructions.size());
+    for (IrValue value = 0; value < replacement.size(); ++value) replacement[value] = value;
+    bool changed = false;
+
+    // Preorder walk of the dominator tree: (block, keys in scope on entry)
+    std::vector<std::pair<BlockId, size_t>> stack{{f.entry, 0}};
+    std::vector<size_t> childIndex(f.blocks.size(), 0);
+    while (!stack.empty()) {
+        auto [block, mark] = stack.back();
+
+        if (childIndex[block] == 0) {
+            for (IrValue value : f.blocks[block].code) {
+                IrInstruction& instruction = f.instructions[value];
+                if (!isPure(instruction.op) && instruction.op != IrOp::MOD) continue;
+                if (instruction.op == IrOp::CONST) continue;
+
+                for (IrValue& operand : instruction.operands) operand = replacement[operand];
+                IrValue a = instruction.operands[0];
+                IrValue b = instruction.operands.size() > 1 ? instruction.operands[1] : NO_VALUE;
+                if (isCommutative(instruction.op) && b < a) std::swap(a, b);
+
+                Key key{instruction.op, a, b};
+                auto found = available.find(key);
+                if (found != available.end()) {
+                    replacement[value] = found->second;
+                    changed = true;
+                } else {
+                    available.emplace(key, value);
+                    scopeKeys.push_back(key);
+                }
+            }
+        }
+
+        const std::vector<BlockId>& children = dominators.children(block);
+        if (childIndex[block] < children.size()) {
+            BlockId child = children[childIndex[block]++];
+            stack.emplace_back(child, scopeKeys.size());
+            continue;
+        }
+
+        while (scopeKeys.size() > mark) {
+            available.erase(scopeKeys.back());
+            scopeKeys.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    if (!changed) return false;
+    f.replaceUses(replacement);
+    for (IrValue value = 0; value < replacement.size(); ++value) {
+        if (replacement[value] != value && !f.instructions[value].removed) f.remove(value);
+    }
+    return true;
+}
+
+bool IrOptimizer::hoistLoopInvariants() {
+    IrFunction& f = *function;
+    DominatorTree dominators(f);
+    bool changed = false;
+
+    for (const IrLoop& loop : findLoops(f, dominators)) {
+        if (loop.preheader == UINT32_MAX) continue;
+
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (BlockId block : dominators.reversePostorder()) {
+                if (!loop.contains[block]) continue;
+                std::vector<IrValue> code = f.blocks[block].code;
+                for (IrValue value : code) {
+                    const IrInstruction& instruction = f.instructions[value];
+                    if (instruction.op == IrOp::CONST || mayTrap(value)) continue;
+                    if (!isPure(instruction.op) && instruction.op != IrOp::MOD) continue;
+                    bool invariant = std::none_of(instruction.operands.begin(), instruction.operands.end(),
+                        [&](IrValue operand) { return loop.contains[f.instructions[operand].block]; });
+                    if (!invariant) continue;
+                    f.moveBeforeTerminator(value, loop.preheader);
+                    moved = changed = true;
+                }
+            }
+        }
+    }
+
+    return changed;
+}
+
+std::vector<IrOptimizer::InductionVariable> IrOptimizer::inductionVariables(const IrLoop& loop) const {
+    const IrFunction& f = *function;
+    std::vector<InductionVariable> result;
+
+    const std::vector<BlockId>& preds = f.blocks[loop.header].preds;
+    if (loop.preheader == UINT32_MAX || preds.size() != 2 || loop.latches.size() != 1) return result;
+    size_t entryIndex = preds[0] == loop.preheader ? 0 : 1;
+    size_t latchIndex = 1 - entryIndex;
+    if (preds[entryIndex] != loop.preheader || f.terminator(preds[latchIndex]).op != IrOp::JUMP) return result;
+
+    for (IrValue value : f.blocks[loop.header].code) {
+        const IrInstruction& phi = f.instructions[value];
+        if (phi.op != IrOp::PHI) break;
+        if (!isInt(value)) continue;
+
+        IrValue next = phi.operands[latchIndex];
+        const IrInstruction& update = f.instructions[next];
+        IrValue step = NO_VALUE;
+        if (update.op == IrOp::ADD && update.operands[0] == value) step = update.operands[1];
+        else if (update.op == IrOp::ADD && update.operands[1] == value) step = update.operands[0];
+        else if (update.op == IrOp::SUB && update.operands[0] == value) step = update.operands[1];
+        if (step == NO_VALUE || !isInt(step) || loop.contains[f.instructions[step].block]) continue;
+
+        result.push_back({value, phi.operands[entryIndex], step, next, update.op == IrOp::SUB});
+    }
+    return result;
+}
+
+bool IrOptimizer::reduceStrength() {
+    IrFunction& f = *function;
+    inferTypes();
+    DominatorTree dominators(f);
+
+    for (const IrLoop& loop : findLoops(f, dominators)) {
+        std::vector<InductionVariable> ivs = inductionVariables(loop);
+        if (ivs.empty()) continue;
+
+        for (BlockId block : dominators.reversePostorder()) {
+            if (!loop.contains[block]) continue;
+            for (IrValue value : f.blocks[block].code) {
+                const IrInstruction& instruction = f.instructions[value];
+                if (instruction.op != IrOp::MUL && instruction.op != IrOp::MOD) continue;
+
+                for (const InductionVariable& iv : ivs) {
+                    if (instruction.op == IrOp::MUL) {
+                        size_t ivIndex = instruction.operands[0] == iv.phi ? 0 : 1;
+                        IrValue factor = instruction.operands[1 - ivIndex];
+                        if (instruction.operands[ivIndex] != iv.phi || !isInt(factor) ||
+                            loop.contains[f.instructions[factor].block]) {
+                            continue;
+                        }
+                        if (reduceMultiply(loop, iv, value, factor)) return true;
+                    } else if (reduceModuloEnabled && instruction.operands[0] == iv.phi) {
+                        if (reduceModulo(loop, iv, value, instruction.operands[1])) return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool IrOptimizer::reduceMultiply(const IrLoop& loop, const InductionVariable& iv, IrValue multiply, IrValue factor) {
+    IrFunction& f = *function;
+    BlockId header = loop.header;
+
+    // (iv +/- step) * k == iv * k +/- step * k, wrapping included
+    IrValue start = f.insertBeforeTerminator(loop.preheader, IrOp::MUL, {iv.init, factor});
+    IrValue stride = f.insertBeforeTerminator(loop.preheader, IrOp::MUL, {iv.step, factor});
+    IrValue product = f.addPhi(header);
+    IrValue next = f.insertAfter(iv.next, iv.subtract ? IrOp::SUB : IrOp::ADD, {product, stride});
+
+    for (BlockId pred : f.blocks[header].preds) {
+        f.instructions[product].operands.push_back(pred == loop.preheader ? start : next);
+    }
+    replaceValue(multiply, product);
+    f.remove(multiply);
+    return true;
+}
+
+bool IrOptimizer::reduceModulo(const IrLoop& loop, const InductionVariable& iv, IrValue modulo, IrValue divisor) {
+    IrFunction& f = *function;
+    int k = 0;
+    int start = 0;
+    int step = 0;
+    // iv stays non-negative and moves by less than k per iteration, so the
+    // remainder needs at most one subtraction per step
+    if (!isIntConstant(divisor, k) || k <= 0 || !isIntConstant(iv.init, start) || start < 0 ||
+        iv.subtract || !isIntConstant(iv.step, step) || step <= 0 || step >= k) {
+        return false;
+    }
+
+    BlockId header = loop.header;
+    std::vector<BlockId>& preds = f.blocks[header].preds;
+    size_t latchIndex = preds[0] == loop.preheader ? 1 : 0;
+    BlockId latch = preds[latchIndex];
+
+    // latch: sum = r + step; sum >= k ? wrap : join
+    // wrap:  sum - k
+    // join:  phi(sum, sum - k) -> header
+    f.remove(f.blocks[latch].code.back());
+    BlockId wrap = f.addBlock();
+    BlockId join = f.addBlock();
+    IrValue remainder = f.addPhi(header);
+    IrValue sum = f.append(latch, IrOp::ADD, {remainder, iv.step});
+    IrValue over = f.append(latch, IrOp::GE, {sum, divisor});
+    f.branch(latch, over, wrap, join);
+    IrValue wrapped = f.append(wrap, IrOp::SUB, {sum, divisor});
+    f.jump(wrap, join);
+
+    IrValue merged = f.addPhi(join);
+    f.instructions[merged].operands = {sum, wrapped};
+    f.instructions[f.append(join, IrOp::JUMP)].targets[0] = header;
+    f.blocks[header].preds[latchIndex] = join;
+
+    IrValue initial = f.constant(Value(start % k));
+    for (BlockId pred : f.blocks[header].preds) {
+        f.instructions[remainder].operands.push_back(pred == join ? merged : initial);
+    }
+    replaceValue(modulo, remainder);
+    f.remove(modulo);
+    return true;
+}
+
+bool IrOptimizer::eliminateDeadCode() {
+    IrFunction& f = *function;
+    std::vector<bool> live(f.instructions.size(), false);
+    std::vector<IrValue> work;
+
+    for (IrValue value = 0; value < f.instructions.size(); ++value) {
+        const IrInstruction& instruction = f.instructions[value];
+        if (instruction.removed) continue;
+        if (instruction.op == IrOp::PRINT || isTerminator(instruction.op) || mayTrap(value)) {
+            live[value] = true;
+            work.push_back(value);
+        }
+    }
+    while (!work.empty()) {
+        IrValue value = work.back();
+        work.pop_back();
+        for (IrValue operand : f.instructions[value].operands) {
+            if (!live[operand]) {
+                live[operand] = true;
+                work.push_back(operand);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (IrValue value = 0; value < f.instructions.size(); ++value) {
+        if (!f.instructions[value].removed && !live[value]) {
+            f.remove(value);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void IrOptimizer::inferTypes() {
+    const IrFunction& f = *function;
+    types.assign(f.instructions.size(), 0);
+    std::vector<BlockId> order = f.reversePostorder();
+
+    // Optimistic: start from "no type" and widen until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BlockId block : order) {
+            for (IrValue value : f.blocks[block].code) {
+                const IrInstruction& instruction = f.instructions[value];
+                TypeSet left = instruction.operands.empty() ? 0 : types[instruction.operands[0]];
+                TypeSet right = instruction.operands.size() > 1 ? types[instruction.operands[1]] : 0;
+                TypeSet result = 0;
+
+                switch (instruction.op) {
+                    case IrOp::CONST:
+                        result = typeBit(f.constantValue(value).type());
+                        break;
+                    case IrOp::PHI:
+                        for (IrValue operand : instruction.operands) result |= types[operand];
+                        break;
+                    case IrOp::ADD:
+                    case IrOp::SUB:
+                    case IrOp::MUL:
+                        if (left == 0 || right == 0) break;
+                        if ((left & INT_TYPE) && (right & INT_TYPE)) result |= INT_TYPE;
+                        if ((left | right) & ~INT_TYPE) result |= DOUBLE_TYPE;
+                        break;
+                    case IrOp::DIV:
+                        result = DOUBLE_TYPE;
+                        break;
+                    case IrOp::MOD:
+                    case IrOp::BAND:
+                    case IrOp::BOR:
+                    case IrOp::BXOR:
+                    case IrOp::BNOT:
+                        result = INT_TYPE;
+                        break;
+                    case IrOp::EQ:
+                    case IrOp::NE:
+                    case IrOp::LT:
+                    case IrOp::LE:
+                    case IrOp::GT:
+                    case IrOp::GE:
+                    case IrOp::AND:
+                    case IrOp::OR:
+                    case IrOp::NOT:
+                        result = BOOL_TYPE;
+                        break;
+                    default:
+                        break;
+                }
+
+                if ((types[value] | result) != types[value]) {
+                    types[value] |= result;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+bool IrOptimizer::isInt(IrValue value) const {
+    return value < types.size() && types[value] == INT_TYPE;
+}
+
+bool IrOptimizer::isIntConstant(IrValue value, int& result) const {
+    if (function->instructions[value].op != IrOp::CONST) return false;
+    const Value& constant = function->constantValue(value);
+    if (!constant.isInt()) return false;
+    result = constant.asInt();
+    return true;
+}
+
+bool IrOptimizer::mayTrap(IrValue value) const {
+    const IrInstruction& instruction = function->instructions[value];
+    if (instruction.op != IrOp::MOD) return false;
+    IrValue divisor = instruction.operands[1];
+    if (function->instructions[divisor].op != IrOp::CONST) return true;
+    int constant = function->constantValue(divisor).toInt();
+    return constant == 0 || constant == -1;
+}
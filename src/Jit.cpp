@@ -0,0 +1,983 @@
+#include "Jit.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(EMOJILANG_NO_JIT)
+#include <sys/mman.h>
+#include <unistd.h>
+#define EMOJILANG_HAVE_JIT 1
+#endif
+
+JitCode::JitCode(void* code, size_t mappedSize, size_t length, std::vector<ResumePath> bailouts)
+    : code(code), mappedSize(mappedSize), length(length), bailouts(std::move(bailouts)) {}
+
+JitCode::~JitCode() {
+#ifdef EMOJILANG_HAVE_JIT
+    munmap(code, mappedSize);
+#endif
+}
+
+JitCode::Exit JitCode::run(Value* frame, bool fromTest, std::ostream& output, const ResumePath*& resume) const {
+    // 0 = finished, 1 = guard failed, 2 + i = bailout i
+    using Entry = uint32_t (*)(Value*, uint32_t, std::ostream*);
+    uint32_t result = reinterpret_cast<Entry>(code)(frame, fromTest ? 1 : 0, &output);
+    if (result == 0) return Exit::FINISHED;
+    if (result == 1) return Exit::GUARD_FAILED;
+    resume = &bailouts[result - 2];
+    return Exit::BAILOUT;
+}
+
+#ifdef EMOJILANG_HAVE_JIT
+
+namespace {
+
+enum Register : uint8_t {
+    EAX = 0,
+    ECX = 1,
+    EDX = 2
+};
+
+// Condition codes; each pair differs in the low bit, so negating is an xor
+enum class Condition : uint8_t {
+    O = 0x0,
+    E = 0x4,
+    NE = 0x5,
+    L = 0xC,
+    GE = 0xD,
+    LE = 0xE,
+    G = 0xF
+};
+
+Condition negate(Condition condition) {
+    return static_cast<Condition>(static_cast<uint8_t>(condition) ^ 1);
+}
+
+Condition conditionFor(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return Condition::E;
+        case CompareOp::NE: return Condition::NE;
+        case CompareOp::LT: return Condition::L;
+        case CompareOp::LE: return Condition::LE;
+        case CompareOp::GT: return Condition::G;
+        case CompareOp::GE: return Condition::GE;
+    }
+    return Condition::E;
+}
+
+// Just the instructions the templates need. Memory operands are always
+// [rbx + disp32], rbx holding the frame; jumps are always rel32.
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    uint32_t newLabel() {
+        labels.push_back(UNBOUND);
+        return static_cast<uint32_t>(labels.size() - 1);
+    }
+    void bind(uint32_t label) { labels[label] = code.size(); }
+
+    void emit(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); }
+    void emit32(uint32_t value) {
+        for (int i = 0; i < 4; i++) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void emit64(uint64_t value) {
+        for (int i = 0; i < 8; i++) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void jump(uint32_t label) {
+        emit({0xE9});
+        fixup(label);
+    }
+    void jumpIf(Condition condition, uint32_t label) {
+        emit({0x0F, static_cast<uint8_t>(0x80 | static_cast<uint8_t>(condition))});
+        fixup(label);
+    }
+
+    // ModRM for [rbx + disp32] with `reg` in the reg field
+    void frameOperand(uint8_t reg, int32_t disp) {
+        code.push_back(static_cast<uint8_t>(0x80 | (reg << 3) | 3));
+        emit32(static_cast<uint32_t>(disp));
+    }
+
+    void loadInt(Register reg, int32_t disp) {          // mov r32, [rbx + disp]
+        emit({0x8B});
+        frameOperand(reg, disp);
+    }
+    void loadBool(Register reg, int32_t disp) {         // movzx r32, byte [rbx + disp]
+        emit({0x0F, 0xB6});
+        frameOperand(reg, disp);
+    }
+    void loadImmediate(Register reg, int32_t value) {   // mov r32, imm32
+        code.push_back(static_cast<uint8_t>(0xB8 + reg));
+        emit32(static_cast<uint32_t>(value));
+    }
+    void storeInt(int32_t disp) {                       // mov [rbx + disp], eax
+        emit({0x89});
+        frameOperand(EAX, disp);
+    }
+    void storeBool(int32_t disp) {                      // mov [rbx + disp], al
+        emit({0x88});
+        frameOperand(EAX, disp);
+    }
+    void storeWord(int32_t disp) {                      // mov [rbx + disp], rax
+        emit({0x48, 0x89});
+        frameOperand(EAX, disp);
+    }
+    void storeTag(int32_t disp, uint8_t tag) {          // mov byte [rbx + disp], imm8
+        emit({0xC6});
+        frameOperand(0, disp);
+        code.push_back(tag);
+    }
+    void compareTag(int32_t disp, uint8_t tag) {        // cmp byte [rbx + disp], imm8
+        emit({0x80});
+        frameOperand(7, disp);
+        code.push_back(tag);
+    }
+
+    void finish() {
+        for (const Fixup& fixup : fixups) {
+            int32_t relative = static_cast<int32_t>(labels[fixup.label] - (fixup.position + 4));
+            std::memcpy(code.data() + fixup.position, &relative, sizeof(relative));
+        }
+    }
+
+private:
+    static constexpr size_t UNBOUND = SIZE_MAX;
+
+    struct Fixup {
+        size_t position;
+        uint32_t label;
+    };
+
+    std::vector<size_t> labels;
+    std::vector<Fixup> fixups;
+
+    void fixup(uint32_t label) {
+        fixups.push_back(Fixup{code.size(), label});
+        emit32(0);
+    }
+};
+
+enum class JitType : uint8_t {
+    UNKNOWN,
+    INT,
+    BOOL,
+    OTHER   // anything the templates do not handle
+};
+
+enum class Op {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    BAND,
+    BOR,
+    BXOR,
+    AND,
+    OR,
+    COMPARE
+};
+
+bool isBinaryExpression(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Op binaryOp(NodeKind kind, std::string_view op) {
+    switch (kind) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") return Op::ADD;
+            if (op == "-" || op == "➖") return Op::SUB;
+            break;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") return Op::MUL;
+            if (op == "/" || op == "➗") return Op::DIV;
+            if (op == "%" || op == "mod" || op == "📎") return Op::MOD;
+            break;
+        case NodeKind::EQUALITYEXPRESSION:
+            compareOpFromText(op);
+            return Op::COMPARE;
+        case NodeKind::ANDEXPRESSION:
+            if (op == "&" || op == "⚛") return Op::BAND;
+            break;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op == "|" || op == "☯") return Op::BOR;
+            break;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op == "^" || op == "xor" || op == "⚓") return Op::BXOR;
+            break;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op == "&&" || op == "and" || op == "😠") return Op::AND;
+            break;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op == "||" || op == "or" || op == "😇") return Op::OR;
+            break;
+        default:
+            break;
+    }
+    throw std::runtime_error("Unknown operator '" + std::string(op) + "' in " + nodeKindName(kind));
+}
+
+bool isNot(std::string_view op) {
+    return op == "!" || op == "not" || op == "❗";
+}
+
+// Called from compiled code; prints exactly what the walker's print does
+void printInt(std::ostream* output, int value) {
+    *output << Value(value).toString() << std::endl;
+}
+
+void printBool(std::ostream* output, int value) {
+    *output << Value(value != 0).toString() << std::endl;
+}
+
+class LoopTranslator {
+public:
+    std::vector<ResumePath> bailouts;
+
+    LoopTranslator(const Tree& tree, const std::vector<Value>& frame)
+        : tree(tree), frame(frame), slotTypes(frame.size(), JitType::UNKNOWN) {}
+
+    // False if the loop's test cannot be compiled for the frame's current types
+    bool translate(NodeId loop, std::vector<uint8_t>& code);
+
+private:
+    struct Stub {
+        uint32_t label;
+        uint32_t bailout;
+    };
+    struct LoopLabels {
+        uint32_t breakLabel;
+        uint32_t continueLabel;
+    };
+
+    const Tree& tree;
+    const std::vector<Value>& frame;
+    Assembler as;
+    // Types of the slots seen so far: declared in the loop or guarded on entry
+    std::vector<JitType> slotTypes;
+    std::vector<std::pair<uint32_t, Value::Type>> guards;
+    std::vector<uint32_t> declaredSlots;
+    // Second entry point, at the outermost loop's test, and the types the
+    // for_decl gives its variables, which are live there
+    uint32_t osrTarget = 0;
+    std::vector<std::pair<uint32_t, Value::Type>> osrSlots;
+    bool osrSupported = true;
+    std::vector<Stub> stubs;
+    std::vector<LoopLabels> loops;
+    // Where the walker resumes if the statement being compiled bails out
+    ResumePath path;
+    ResumePath trapPath;
+    int64_t trapLabel = -1;
+    bool rejected = false;
+
+    static int32_t tagAt(uint32_t slot) {
+        return static_cast<int32_t>(slot * sizeof(Value) + Value::tagOffset());
+    }
+    static int32_t payloadAt(uint32_t slot) {
+        return static_cast<int32_t>(slot * sizeof(Value) + Value::payloadOffset());
+    }
+
+    uint32_t bailout(const ResumePath& at);
+    void bailNow() { as.jump(bailout(path)); }
+    void beginStatement(const ResumePath& at);
+    uint32_t trap();
+
+    JitType slotType(uint32_t slot);
+    void declareSlot(uint32_t slot, JitType type);
+    NodeId unwrap(NodeId node) const;
+    bool intConstant(NodeId node, int32_t& value) const;
+    JitType typeOf(NodeId node);
+
+    void statementList(NodeId container);
+    void statement(NodeId node);
+    void declare(NodeId node);
+    void assign(NodeId node);
+    void print(NodeId node);
+    void ifStatement(NodeId node);
+    void whileLoop(NodeId node, bool outermost);
+    void forLoop(NodeId node, bool outermost);
+    void flow(NodeId node);
+
+    void load(NodeId node);
+    void loadEcx(NodeId node);
+    void toBoolean(Register reg);
+    void branchIfFalse(NodeId node, uint32_t label);
+};
+
+bool LoopTranslator::translate(NodeId loop, std::vector<uint8_t>& code) {
+    // rbp keeps the stack pointer, so a trap taken while an expression has
+    // temporaries pushed still returns cleanly; rsp stays 16-byte aligned
+    // between statements, as the print calls need
+    as.emit({0x53, 0x55});              // push rbx; push rbp
+    as.emit({0x48, 0x89, 0xE5});        // mov rbp, rsp
+    as.emit({0x48, 0x83, 0xEC, 0x08});  // sub rsp, 8
+    as.emit({0x48, 0x89, 0xFB});        // mov rbx, rdi
+    as.emit({0x48, 0x89, 0x55, 0xF8});  // mov [rbp-8], rdx (the output stream)
+    uint32_t guardBlock = as.newLabel();
+    uint32_t osrGuardBlock = as.newLabel();
+    uint32_t start = as.newLabel();
+    uint32_t epilogue = as.newLabel();
+    uint32_t guardFailed = as.newLabel();
+    as.emit({0x85, 0xF6});              // test esi, esi
+    as.jumpIf(Condition::NE, osrGuardBlock);
+    as.jump(guardBlock);
+
+    as.bind(start);
+    if (tree.kind(loop) == NodeKind::WHILE_STMT) {
+        whileLoop(loop, true);
+    } else {
+        forLoop(loop, true);
+    }
+    if (rejected) return false;
+    as.emit({0x31, 0xC0});              // xor eax, eax
+    as.bind(epilogue);
+    as.emit({0x48, 0x89, 0xEC});        // mov rsp, rbp
+    as.emit({0x5D, 0x5B, 0xC3});        // pop rbp; pop rbx; ret
+
+    for (const Stub& stub : stubs) {
+        as.bind(stub.label);
+        as.loadImmediate(EAX, static_cast<int32_t>(stub.bailout + 2));
+        as.jump(epilogue);
+    }
+
+    // Guards are only known once the body has been compiled, so they go last
+    auto emitGuards = [&](bool atTest) {
+        for (const auto& guard : guards) {
+            as.compareTag(tagAt(guard.first), static_cast<uint8_t>(guard.second));
+            as.jumpIf(Condition::NE, guardFailed);
+        }
+        for (uint32_t slot : declaredSlots) {
+            auto osrSlot = std::find_if(osrSlots.begin(), osrSlots.end(),
+                [slot](const auto& entry) { return entry.first == slot; });
+            if (atTest && osrSlot != osrSlots.end()) {
+                as.compareTag(tagAt(slot), static_cast<uint8_t>(osrSlot->second));
+                as.jumpIf(Condition::NE, guardFailed);
+            } else {
+                // Declarations overwrite slots in place, which must not drop a string reference
+                as.compareTag(tagAt(slot), static_cast<uint8_t>(Value::Type::STRING));
+                as.jumpIf(Condition::E, guardFailed);
+            }
+        }
+    };
+    as.bind(guardBlock);
+    emitGuards(false);
+    as.jump(start);
+    as.bind(osrGuardBlock);
+    if (osrSupported) {
+        emitGuards(true);
+        as.jump(osrTarget);
+    } else {
+        as.jump(guardFailed);
+    }
+    as.bind(guardFailed);
+    as.loadImmediate(EAX, 1);
+    as.jump(epilogue);
+
+    as.finish();
+    code = std::move(as.code);
+    return true;
+}
+
+uint32_t LoopTranslator::bailout(const ResumePath& at) {
+    uint32_t label = as.newLabel();
+    stubs.push_back(Stub{label, static_cast<uint32_t>(bailouts.size())});
+    bailouts.push_back(at);
+    return label;
+}
+
+void LoopTranslator::beginStatement(const ResumePath& at) {
+    trapPath = at;
+    trapLabel = -1;
+}
+
+uint32_t LoopTranslator::trap() {
+    // One stub per statement, shared by all of its overflow and division checks
+    if (trapLabel < 0) {
+        trapLabel = bailout(trapPath);
+    }
+    return static_cast<uint32_t>(trapLabel);
+}
+
+JitType LoopTranslator::slotType(uint32_t slot) {
+    if (slotTypes[slot] != JitType::UNKNOWN) {
+        return slotTypes[slot];
+    }
+    // Live on entry: specialize on the type it has now and check it on every entry
+    Value::Type type = frame[slot].type();
+    guards.emplace_back(slot, type);
+    slotTypes[slot] = type == Value::Type::INT ? JitType::INT
+        : type == Value::Type::BOOL ? JitType::BOOL
+        : JitType::OTHER;
+    return slotTypes[slot];
+}
+
+void LoopTranslator::declareSlot(uint32_t slot, JitType type) {
+    if (slotTypes[slot] == JitType::UNKNOWN) {
+        declaredSlots.push_back(slot);
+    }
+    slotTypes[slot] = type;
+}
+
+NodeId LoopTranslator::unwrap(NodeId node) const {
+    while ((tree.kind(node) == NodeKind::EXP || tree.kind(node) == NodeKind::CASTEXPRESSION) &&
+           tree.size(node) == 1) {
+        node = tree.children(node)[0].index;
+    }
+    return node;
+}
+
+bool LoopTranslator::intConstant(NodeId node, int32_t& value) const {
+    switch (tree.kind(node)) {
+        case NodeKind::NUMBER:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT: {
+            const Value& constant = tree.constants[tree.payload(node)];
+            if (constant.isInt()) {
+                value = constant.asInt();
+                return true;
+            }
+            if (constant.isBool()) {
+                value = constant.asBool() ? 1 : 0;
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+JitType LoopTranslator::typeOf(NodeId node) {
+    node = unwrap(node);
+    NodeKind kind = tree.kind(node);
+    auto children = tree.children(node);
+
+    switch (kind) {
+        case NodeKind::NAME:
+            return slotType(tree.payload(node));
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+        case NodeKind::CONSTANT: {
+            const Value& constant = tree.constants[tree.payload(node)];
+            if (constant.isInt()) return JitType::INT;
+            if (constant.isBool()) return JitType::BOOL;
+            return JitType::OTHER;
+        }
+        case NodeKind::CASTEXPRESSION:
+            if (children.size() != 2 || typeOf(children[1].index) == JitType::OTHER) return JitType::OTHER;
+            return isNot(tree.leaf(children[0]).value) ? JitType::BOOL : JitType::INT;
+        case NodeKind::FOR_TEST:
+            return children.empty() ? JitType::BOOL : typeOf(children[0].index);
+        default:
+            break;
+    }
+    if (!isBinaryExpression(kind) || children.size() != 3) {
+        return JitType::OTHER;
+    }
+
+    Op op = binaryOp(kind, tree.leaf(children[1]).value);
+    JitType left = typeOf(children[0].index);
+    JitType right = typeOf(children[2].index);
+    if (left == JitType::OTHER || right == JitType::OTHER) {
+        return JitType::OTHER;
+    }
+    switch (op) {
+        case Op::ADD:
+        case Op::SUB:
+        case Op::MUL:
+            // A boolean operand makes the walker compute in doubles
+            return left == JitType::INT && right == JitType::INT ? JitType::INT : JitType::OTHER;
+        case Op::DIV:
+            return JitType::OTHER;
+        case Op::MOD:
+        case Op::BAND:
+        case Op::BOR:
+        case Op::BXOR:
+            return JitType::INT;
+        default:
+            return JitType::BOOL;
+    }
+}
+
+void LoopTranslator::statementList(NodeId container) {
+    auto children = tree.children(container);
+    for (uint32_t i = 0; i < children.size(); i++) {
+        if (children[i].isLeaf) continue;
+        path.push_back(ResumeStep{container, i});
+        statement(children[i].index);
+        path.pop_back();
+    }
+}
+
+void LoopTranslator::statement(NodeId node) {
+    beginStatement(path);
+    switch (tree.kind(node)) {
+        case NodeKind::DECLARE_STMT:
+            declare(node);
+            break;
+        case NodeKind::ASSIGNMENT_STMT:
+            assign(node);
+            break;
+        case NodeKind::PRINT_STMT:
+            print(node);
+            break;
+        case NodeKind::IF_STMT:
+            ifStatement(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            whileLoop(node, false);
+            break;
+        case NodeKind::FOR_STMT:
+            forLoop(node, false);
+            break;
+        case NodeKind::FLOW_STMT:
+            flow(node);
+            break;
+        case NodeKind::SUITE:
+            statementList(node);
+            break;
+        default:
+            // A bare expression runs for its traps only
+            if (typeOf(node) == JitType::OTHER) {
+                bailNow();
+            } else {
+                load(node);
+            }
+            break;
+    }
+}
+
+void LoopTranslator::declare(NodeId node) {
+    bool reachable = true;
+    for (const Child& child : tree.children(node)) {
+        if (tree.kind(child.index) == NodeKind::NAME) {
+            uint32_t slot = tree.payload(child.index);
+            declareSlot(slot, JitType::INT);
+            if (reachable) {
+                as.emit({0x31, 0xC0});  // xor eax, eax
+                as.storeTag(tagAt(slot), static_cast<uint8_t>(Value::Type::INT));
+                as.storeWord(payloadAt(slot));
+            }
+            continue;
+        }
+
+        auto children = tree.children(child.index);
+        uint32_t slot = tree.payload(children[0].index);
+        JitType type = typeOf(children[1].index);
+        if (type == JitType::OTHER) {
+            // The walker reruns the whole declaration; the earlier names get the same values
+            declareSlot(slot, JitType::OTHER);
+            if (reachable) bailNow();
+            reachable = false;
+            continue;
+        }
+        declareSlot(slot, type);
+        if (reachable) {
+            load(children[1].index);
+            as.emit({0x89, 0xC0});      // mov eax, eax (clears the upper half)
+            as.storeTag(tagAt(slot), static_cast<uint8_t>(type == JitType::INT ? Value::Type::INT : Value::Type::BOOL));
+            as.storeWord(payloadAt(slot));
+        }
+    }
+}
+
+void LoopTranslator::assign(NodeId node) {
+    auto children = tree.children(node);
+    uint32_t slot = tree.payload(children[0].index);
+    JitType target = slotType(slot);
+    JitType type = typeOf(children[1].index);
+    if (type == JitType::OTHER || type != target) {
+        bailNow();
+        return;
+    }
+    load(children[1].index);
+    if (type == JitType::INT) {
+        as.storeInt(payloadAt(slot));
+    } else {
+        as.storeBool(payloadAt(slot));
+    }
+}
+
+void LoopTranslator::print(NodeId node) {
+    NodeId value = tree.children(node)[0].index;
+    JitType type = typeOf(value);
+    if (type == JitType::OTHER) {
+        bailNow();
+        return;
+    }
+    load(value);
+    as.emit({0x89, 0xC6});              // mov esi, eax
+    as.emit({0x48, 0x8B, 0x7D, 0xF8});  // mov rdi, [rbp-8]
+    as.emit({0x48, 0xB8});              // mov rax, imm64
+    as.emit64(reinterpret_cast<uint64_t>(type == JitType::INT ? &printInt : &printBool));
+    as.emit({0xFF, 0xD0});              // call rax
+}
+
+void LoopTranslator::ifStatement(NodeId node) {
+    auto children = tree.children(node);
+    ResumePath here = path;
+
+    for (size_t i = 0; i + 2 < children.size(); i += 3) {
+        std::string_view keyword = tree.leaf(children[i]).value;
+        if (keyword == "else" || keyword == "🏁") break;
+        if (typeOf(children[i + 1].index) == JitType::OTHER) {
+            bailNow();
+            return;
+        }
+    }
+
+    uint32_t end = as.newLabel();
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree.leaf(children[i]).value;
+        if (keyword == "else" || keyword == "🏁") {
+            path.push_back(ResumeStep{node, static_cast<uint32_t>(i + 1)});
+            statementList(children[i + 1].index);
+            path.pop_back();
+            break;
+        }
+
+        // Conditions have no side effects, so a trap in any of them reruns the whole if
+        beginStatement(here);
+        uint32_t next = as.newLabel();
+        branchIfFalse(children[i + 1].index, next);
+        path.push_back(ResumeStep{node, static_cast<uint32_t>(i + 2)});
+        statementList(children[i + 2].index);
+        path.pop_back();
+        i += 3;
+        if (i < children.size()) {
+            as.jump(end);
+        }
+        as.bind(next);
+    }
+    as.bind(end);
+}
+
+void LoopTranslator::whileLoop(NodeId node, bool outermost) {
+    auto children = tree.children(node);
+    if (typeOf(children[0].index) == JitType::OTHER) {
+        if (outermost) {
+            rejected = true;
+        } else {
+            bailNow();
+        }
+        return;
+    }
+
+    uint32_t head = as.newLabel();
+    uint32_t exit = as.newLabel();
+    as.bind(head);
+    if (outermost) {
+        osrTarget = head;
+    }
+    path.push_back(ResumeStep{node, 0});
+    beginStatement(path);
+    path.pop_back();
+    branchIfFalse(children[0].index, exit);
+
+    loops.push_back(LoopLabels{exit, head});
+    path.push_back(ResumeStep{node, 1});
+    statementList(children[1].index);
+    path.pop_back();
+    loops.pop_back();
+
+    as.jump(head);
+    as.bind(exit);
+}
+
+void LoopTranslator::forLoop(NodeId node, bool outermost) {
+    auto children = tree.children(node);
+    NodeId test = children[1].index;
+
+    size_t firstDeclared = declaredSlots.size();
+    path.push_back(ResumeStep{node, 0});
+    statementList(children[0].index);
+    path.pop_back();
+    if (outermost) {
+        for (size_t i = firstDeclared; i < declaredSlots.size(); i++) {
+            uint32_t slot = declaredSlots[i];
+            if (slotTypes[slot] == JitType::OTHER) {
+                osrSupported = false;
+            } else {
+                Value::Type type = slotTypes[slot] == JitType::INT ? Value::Type::INT : Value::Type::BOOL;
+                osrSlots.emplace_back(slot, type);
+            }
+        }
+    }
+
+    path.push_back(ResumeStep{node, 1});
+    beginStatement(path);
+    if (tree.size(test) > 0 && typeOf(tree.children(test)[0].index) == JitType::OTHER) {
+        if (outermost) {
+            rejected = true;
+        } else {
+            bailNow();
+        }
+        path.pop_back();
+        return;
+    }
+    path.pop_back();
+
+    uint32_t head = as.newLabel();
+    uint32_t next = as.newLabel();
+    uint32_t exit = as.newLabel();
+    as.bind(head);
+    if (outermost) {
+        osrTarget = head;
+    }
+    if (tree.size(test) > 0) {
+        branchIfFalse(tree.children(test)[0].index, exit);
+    }
+
+    loops.push_back(LoopLabels{exit, next});
+    path.push_back(ResumeStep{node, 3});
+    statementList(children[3].index);
+    path.pop_back();
+    loops.pop_back();
+
+    // continue lands here, so the updates still run
+    as.bind(next);
+    path.push_back(ResumeStep{node, 2});
+    statementList(children[2].index);
+    path.pop_back();
+    as.jump(head);
+    as.bind(exit);
+}
+
+void LoopTranslator::flow(NodeId node) {
+    for (const Child& child : tree.children(node)) {
+        if (child.isLeaf) continue;
+        if (tree.kind(child.index) == NodeKind::BREAK_STMT) {
+            as.jump(loops.back().breakLabel);
+        } else if (tree.kind(child.index) == NodeKind::CONTINUE_STMT) {
+            as.jump(loops.back().continueLabel);
+        }
+    }
+}
+
+// Evaluates an int or boolean expression into eax; booleans are 0 or 1.
+void LoopTranslator::load(NodeId node) {
+    node = unwrap(node);
+    NodeKind kind = tree.kind(node);
+    auto children = tree.children(node);
+
+    int32_t constant;
+    if (intConstant(node, constant)) {
+        as.loadImmediate(EAX, constant);
+        return;
+    }
+    if (kind == NodeKind::NAME) {
+        uint32_t slot = tree.payload(node);
+        if (slotType(slot) == JitType::INT) {
+            as.loadInt(EAX, payloadAt(slot));
+        } else {
+            as.loadBool(EAX, payloadAt(slot));
+        }
+        return;
+    }
+    if (kind == NodeKind::FOR_TEST) {
+        if (children.empty()) {
+            as.loadImmediate(EAX, 1);
+        } else {
+            load(children[0].index);
+        }
+        return;
+    }
+    if (kind == NodeKind::CASTEXPRESSION) {
+        load(children[1].index);
+        if (isNot(tree.leaf(children[0]).value)) {
+            toBoolean(EAX);
+            as.emit({0x83, 0xF0, 0x01});    // xor eax, 1
+        } else {
+            as.emit({0xF7, 0xD0});          // not eax
+        }
+        return;
+    }
+
+    Op op = binaryOp(kind, tree.leaf(children[1]).value);
+    NodeId left = children[0].index;
+    NodeId right = children[2].index;
+    load(left);
+
+    if (op == Op::MOD) {
+        int32_t divisor;
+        if (intConstant(unwrap(right), divisor) && divisor != 0 && divisor != -1) {
+            as.loadImmediate(ECX, divisor);
+        } else {
+            // x 📎 0 faults and INT_MIN 📎 -1 overflows; leave both to the walker
+            loadEcx(right);
+            as.emit({0x85, 0xC9});          // test ecx, ecx
+            as.jumpIf(Condition::E, trap());
+            as.emit({0x83, 0xF9, 0xFF});    // cmp ecx, -1
+            as.jumpIf(Condition::E, trap());
+        }
+        as.emit({0x99, 0xF7, 0xF9});        // cdq; idiv ecx
+        as.emit({0x89, 0xD0});              // mov eax, edx
+        return;
+    }
+
+    loadEcx(right);
+    switch (op) {
+        case Op::ADD:
+            as.emit({0x01, 0xC8});          // add eax, ecx
+            as.jumpIf(Condition::O, trap());
+            break;
+        case Op::SUB:
+            as.emit({0x29, 0xC8});          // sub eax, ecx
+            as.jumpIf(Condition::O, trap());
+            break;
+        case Op::MUL:
+            as.emit({0x0F, 0xAF, 0xC1});    // imul eax, ecx
+            as.jumpIf(Condition::O, trap());
+            break;
+        case Op::BAND:
+            as.emit({0x21, 0xC8});          // and eax, ecx
+            break;
+        case Op::BOR:
+            as.emit({0x09, 0xC8});          // or eax, ecx
+            break;
+        case Op::BXOR:
+            as.emit({0x31, 0xC8});          // xor eax, ecx
+            break;
+        case Op::AND:
+        case Op::OR:
+            // Both sides are evaluated, as in the walker
+            if (typeOf(left) == JitType::INT) toBoolean(EAX);
+            if (typeOf(right) == JitType::INT) toBoolean(ECX);
+            as.emit({static_cast<uint8_t>(op == Op::AND ? 0x21 : 0x09), 0xC8});
+            break;
+        case Op::COMPARE: {
+            CompareOp compare = compareOpFromText(tree.leaf(children[1]).value);
+            if (typeOf(left) != typeOf(right) && (compare == CompareOp::EQ || compare == CompareOp::NE)) {
+                // An int and a boolean never print the same
+                as.loadImmediate(EAX, compare == CompareOp::NE ? 1 : 0);
+                break;
+            }
+            // Orderings of an int and a boolean compare them as numbers
+            as.emit({0x39, 0xC8});          // cmp eax, ecx
+            as.emit({0x0F, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(conditionFor(compare))), 0xC0});
+            as.emit({0x0F, 0xB6, 0xC0});    // movzx eax, al
+            break;
+        }
+        default:
+            throw std::runtime_error("JIT: unexpected operator");
+    }
+}
+
+// Evaluates into ecx, keeping eax
+void LoopTranslator::loadEcx(NodeId node) {
+    node = unwrap(node);
+    int32_t constant;
+    if (intConstant(node, constant)) {
+        as.loadImmediate(ECX, constant);
+        return;
+    }
+    if (tree.kind(node) == NodeKind::NAME) {
+        uint32_t slot = tree.payload(node);
+        if (slotType(slot) == JitType::INT) {
+            as.loadInt(ECX, payloadAt(slot));
+        } else {
+            as.loadBool(ECX, payloadAt(slot));
+        }
+        return;
+    }
+    as.emit({0x50});                        // push rax
+    load(node);
+    as.emit({0x89, 0xC1});                  // mov ecx, eax
+    as.emit({0x58});                        // pop rax
+}
+
+void LoopTranslator::toBoolean(Register reg) {
+    uint8_t self = static_cast<uint8_t>(0xC0 | (reg << 3) | reg);
+    as.emit({0x85, self});                  // test reg, reg
+    as.emit({0x0F, 0x95, static_cast<uint8_t>(0xC0 | reg)});   // setne reg8
+    as.emit({0x0F, 0xB6, self});            // movzx reg, reg8
+}
+
+void LoopTranslator::branchIfFalse(NodeId node, uint32_t label) {
+    node = unwrap(node);
+    auto children = tree.children(node);
+
+    if (tree.kind(node) == NodeKind::FOR_TEST) {
+        if (!children.empty()) branchIfFalse(children[0].index, label);
+        return;
+    }
+    int32_t constant;
+    if (intConstant(node, constant)) {
+        if (constant == 0) as.jump(label);
+        return;
+    }
+    if (tree.kind(node) == NodeKind::EQUALITYEXPRESSION && children.size() == 3) {
+        CompareOp compare = compareOpFromText(tree.leaf(children[1]).value);
+        bool mixed = typeOf(children[0].index) != typeOf(children[2].index);
+        if (!mixed || (compare != CompareOp::EQ && compare != CompareOp::NE)) {
+            load(children[0].index);
+            loadEcx(children[2].index);
+            as.emit({0x39, 0xC8});          // cmp eax, ecx
+            as.jumpIf(negate(conditionFor(compare)), label);
+            return;
+        }
+    }
+    load(node);
+    as.emit({0x85, 0xC0});                  // test eax, eax
+    as.jumpIf(Condition::E, label);
+}
+
+} // namespace
+
+#endif
+
+bool JitCompiler::available() {
+#ifdef EMOJILANG_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<JitCode> JitCompiler::compile(const Tree& tree, NodeId loop, const std::vector<Value>& frame) {
+#ifdef EMOJILANG_HAVE_JIT
+    std::vector<uint8_t> code;
+    LoopTranslator translator(tree, frame);
+    if (!translator.translate(loop, code)) {
+        return nullptr;
+    }
+
+    // Written while writable, then flipped to executable
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (code.size() + pageSize - 1) / pageSize * pageSize;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+    return std::unique_ptr<JitCode>(new JitCode(memory, size, code.size(), std::move(translator.bailouts)));
+#else
+    (void)tree;
+    (void)loop;
+    (void)frame;
+    return nullptr;
+#endif
+}
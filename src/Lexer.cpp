@@ -0,0 +1,150 @@
+#include "Lexer.hpp"
+#include "EmojiTable.hpp"
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+Lexer::Lexer(std::string_view source, const ScanKernels& kernels)
+    : Lexer(source, LexerState{0, 1, 0}, kernels) {}
+
+Lexer::Lexer(std::string_view source, const LexerState& resume, const ScanKernels& kernels)
+    : source(source), pos(resume.pos), line(resume.line), lineStart(resume.lineStart),
+      stringTruncated(false), kernels(&kernels) {
+    if (source.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Source too large to tokenize");
+    }
+}
+
+LexerState Lexer::state() const {
+    return LexerState{pos, line, lineStart};
+}
+
+bool Lexer::truncated() const {
+    return stringTruncated;
+}
+
+LexToken Lexer::makeToken(TokenType type, size_t start, size_t end) const {
+    return LexToken{
+        static_cast<uint32_t>(start),
+        static_cast<uint32_t>(end - start),
+        line,
+        static_cast<uint32_t>(start - lineStart + 1),
+        type
+    };
+}
+
+void Lexer::invalidUtf8(const char* at, const LinePosition& from) const {
+    // Walk forward from a known line start; this only runs on the error path
+    LinePosition position = from;
+    for (const char* p = from.lineStart; p < at; ++p) {
+        if (*p == '\n') {
+            position.line++;
+            position.lineStart = p + 1;
+        }
+    }
+    throw std::runtime_error("Invalid UTF-8 at line " + std::to_string(position.line) +
+                             ", column " + std::to_string(at - position.lineStart + 1));
+}
+
+void Lexer::skipWhitespaceAndComments() {
+    const char* begin = source.data();
+    const char* end = begin + source.length();
+    LinePosition position{line, begin + lineStart};
+    const char* p = begin + pos;
+    
+    while (p < end) {
+        p = kernels->skipWhitespace(p, end, position);
+        
+        // Skip comments (💩 is 4 bytes in UTF-8: F0 9F 92 A9) up to the end of line
+        if (end - p >= 4 &&
+            (unsigned char)p[0] == 0xF0 &&
+            (unsigned char)p[1] == 0x9F &&
+            (unsigned char)p[2] == 0x92 &&
+            (unsigned char)p[3] == 0xA9) {
+            const char* invalid = nullptr;
+            p = kernels->skipToNewline(p + 4, end, invalid);
+            if (invalid) invalidUtf8(invalid, position);
+            continue;
+        }
+        
+        break;
+    }
+    
+    pos = static_cast<size_t>(p - begin);
+    line = position.line;
+    lineStart = static_cast<size_t>(position.lineStart - begin);
+}
+
+LexToken Lexer::next() {
+    stringTruncated = false;
+    skipWhitespaceAndComments();
+    
+    if (pos >= source.length()) {
+        return makeToken(TokenType::END_OF_FILE, source.length(), source.length());
+    }
+    
+    const char* begin = source.data();
+    const char* end = begin + source.length();
+    size_t start = pos;
+    unsigned char c = static_cast<unsigned char>(source[pos]);
+    
+    // Handle string literals; the token covers the text between the quotes
+    if (c == '"') {
+        LexToken token = makeToken(TokenType::STRING, pos + 1, pos + 1);
+        LinePosition opening{line, begin + lineStart};
+        LinePosition position = opening;
+        const char* invalid = nullptr;
+        const char* close = kernels->findQuote(begin + pos + 1, end, position, invalid);
+        if (invalid) invalidUtf8(invalid, opening);
+        pos = static_cast<size_t>(close - begin);
+        line = position.line;
+        lineStart = static_cast<size_t>(position.lineStart - begin);
+        token.length = static_cast<uint32_t>(pos - start - 1);
+        stringTruncated = pos >= source.length();
+        if (!stringTruncated) pos++; // Skip closing quote
+        return token;
+    }
+    
+    // Handle numbers
+    if (std::isdigit(c) ||
+        (c == '-' && pos + 1 < source.length() && std::isdigit(static_cast<unsigned char>(source[pos + 1])))) {
+        if (c == '-') {
+            pos++;
+        }
+        pos = static_cast<size_t>(kernels->scanNumber(begin + pos, end) - begin);
+        return makeToken(TokenType::NUMBER, start, pos);
+    }
+    
+    // Handle identifiers
+    if (std::isalpha(c) || c == '_') {
+        pos = static_cast<size_t>(kernels->scanIdentifier(begin + pos, end) - begin);
+        return makeToken(TokenType::NAME, start, pos);
+    }
+    
+    // Handle emojis, always taking the longest match (e.g. 😭😌 over 😭)
+    EmojiMatch emoji = EMOJI_TRIE.match(begin + pos, end);
+    if (emoji.index != -1) {
+        pos += emoji.length;
+        return makeToken(TokenType::OPERATOR, start, pos);
+    }
+    
+    // Anything else becomes a single-character token, one code point wide
+    int length = utf8SequenceLength(begin + pos, end);
+    if (length == 0) invalidUtf8(begin + pos, LinePosition{line, begin + lineStart});
+    pos += static_cast<size_t>(length);
+    return makeToken(TokenType::OPERATOR, start, pos);
+}
+
+std::vector<LexToken> Lexer::tokenize() {
+    std::vector<LexToken> result;
+    result.reserve(source.length() / 8 + 1);
+    
+    while (true) {
+        LexToken token = next();
+        result.push_back(token);
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+    
+    return result;
+}
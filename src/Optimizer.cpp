@@ -0,0 +1,486 @@
+#include "Optimizer.hpp"
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+bool isBinaryExpression(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+        case NodeKind::ADDITIVEEXPRESSION:
+        case NodeKind::EQUALITYEXPRESSION:
+        case NodeKind::ANDEXPRESSION:
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+        case NodeKind::INCLUSIVEOREXPRESSION:
+        case NodeKind::LOGICALANDEXPRESSION:
+        case NodeKind::LOGICALOREXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Integer operands stay integers and wrap like the engines (see addInt),
+// anything else is promoted to double.
+template <typename IntOp, typename DoubleOp>
+Value arithmetic(const Value& left, const Value& right, IntOp intOp, DoubleOp doubleOp) {
+    if (left.isInt() && right.isInt()) {
+        return intOp(left.asInt(), right.asInt());
+    }
+    return doubleOp(left.toDouble(), right.toDouble());
+}
+
+// Mirrors the tree-walking interpreter; returns false for anything that
+// should be left to run time.
+bool applyBinary(NodeKind kind, std::string_view op, Value& value, const Value& right) {
+    switch (kind) {
+        case NodeKind::ADDITIVEEXPRESSION:
+            if (op == "+" || op == "➕") {
+                value = arithmetic(value, right, addInt, [](double l, double r) { return l + r; });
+                return true;
+            }
+            if (op == "-" || op == "➖") {
+                value = arithmetic(value, right, subtractInt, [](double l, double r) { return l - r; });
+                return true;
+            }
+            return false;
+        case NodeKind::MULTIPLICATIVEEXPRESSION:
+            if (op == "*" || op == "✖") {
+                value = arithmetic(value, right, multiplyInt, [](double l, double r) { return l * r; });
+                return true;
+            }
+            if (op == "/" || op == "➗") {
+                value = value.toDouble() / right.toDouble();
+                return true;
+            }
+            if (op == "%" || op == "mod" || op == "📎") {
+                int divisor = right.toInt();
+                int dividend = value.toInt();
+                if (divisor == 0 || (divisor == -1 && dividend == std::numeric_limits<int>::min())) {
+                    return false;
+                }
+                value = dividend % divisor;
+                return true;
+            }
+            return false;
+        case NodeKind::EQUALITYEXPRESSION:
+            value = compareValues(compareOpFromText(op), value, right);
+            return true;
+        case NodeKind::ANDEXPRESSION:
+            if (op != "&" && op != "⚛") return false;
+            value = value.toInt() & right.toInt();
+            return true;
+        case NodeKind::EXCLUSIVEOREXPRESSION:
+            if (op != "^" && op != "xor" && op != "⚓") return false;
+            value = value.toInt() ^ right.toInt();
+            return true;
+        case NodeKind::INCLUSIVEOREXPRESSION:
+            if (op != "|" && op != "☯") return false;
+            value = value.toInt() | right.toInt();
+            return true;
+        case NodeKind::LOGICALANDEXPRESSION:
+            if (op != "&&" && op != "and" && op != "😠") return false;
+            value = value.toBool() && right.toBool();
+            return true;
+        case NodeKind::LOGICALOREXPRESSION:
+            if (op != "||" && op != "or" && op != "😇") return false;
+            value = value.toBool() || right.toBool();
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+Optimizer::Optimizer() : tree(nullptr), changed(false) {}
+
+void Optimizer::optimize(Tree& program) {
+    if (program.nodeCount() == 0) return;
+    tree = &program;
+
+    simplifyStatement(program.root);
+    while (true) {
+        slots.assign(program.frameSize, SlotUse{});
+        countUses(program.root);
+
+        changed = false;
+        propagateConstants(program.root);
+        removeDeadStores(program.root);
+        if (!changed) break;
+
+        // Propagated constants may fold further
+        simplifyStatement(program.root);
+    }
+
+    tree = nullptr;
+}
+
+void Optimizer::optimize(Tree& program, NodeId statement) {
+    tree = &program;
+    simplifyStatement(statement);
+    tree = nullptr;
+}
+
+void Optimizer::simplifyStatement(NodeId node) {
+    auto children = tree->children(node);
+
+    switch (tree->kind(node)) {
+        case NodeKind::STMT:
+        case NodeKind::SUITE:
+        case NodeKind::FOR_DECL:
+        case NodeKind::FOR_UPDATES:
+            for (const Child& statement : children) {
+                simplifyStatement(statement.index);
+            }
+            break;
+        case NodeKind::DECLARE_STMT:
+            for (const Child& child : children) {
+                if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+                    simplifyStatement(child.index);
+                }
+            }
+            break;
+        case NodeKind::ASSIGNMENT_STMT:
+            simplifyExpression(children[1].index);
+            break;
+        case NodeKind::PRINT_STMT:
+            simplifyExpression(children[0].index);
+            break;
+        case NodeKind::IF_STMT:
+            simplifyIf(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            simplifyWhile(node);
+            break;
+        case NodeKind::FOR_STMT:
+            simplifyFor(node);
+            break;
+        case NodeKind::SPAWN_STMT:
+            simplifyStatement(children[0].index);
+            break;
+        case NodeKind::FLOW_STMT:
+        case NodeKind::JOIN_STMT:
+            break;
+        default:
+            simplifyExpression(node);
+            break;
+    }
+}
+
+void Optimizer::simplifyIf(NodeId node) {
+    // Copied: replace() below appends to the array the range points into
+    auto range = tree->children(node);
+    std::vector<Child> children(range.begin(), range.end());
+    std::vector<Child> kept;
+    bool dropped = false;
+
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree->leaf(children[i]).value;
+        if (keyword == "else" || keyword == "🏁") {
+            simplifyStatement(children[i + 1].index);
+            kept.push_back(children[i]);
+            kept.push_back(children[i + 1]);
+            break;
+        }
+
+        NodeId condition = children[i + 1].index;
+        NodeId body = children[i + 2].index;
+        bool isConstant = simplifyExpression(condition);
+        simplifyStatement(body);
+
+        if (!isConstant) {
+            // The first arm kept keeps the original "if" keyword
+            kept.push_back(kept.empty() ? children[0] : children[i]);
+            kept.push_back(children[i + 1]);
+            kept.push_back(children[i + 2]);
+        } else if (constantOf(condition).toBool()) {
+            // Always taken: it becomes the else and later arms are unreachable
+            const Leaf& token = tree->leaf(children[i]);
+            kept.push_back(tree->addLeaf(token.type, "else", token.line, token.column));
+            kept.push_back(children[i + 2]);
+            dropped = true;
+            break;
+        } else {
+            dropped = true;
+        }
+        i += 3;
+    }
+
+    if (!dropped) return;
+
+    if (kept.empty()) {
+        tree->replace(node, NodeKind::SUITE);
+    } else if (kept.size() == 2) {
+        // Only an else is left
+        tree->replace(node, NodeKind::SUITE, {kept[1]});
+    } else {
+        tree->replace(node, NodeKind::IF_STMT, kept.data(), kept.size());
+    }
+}
+
+void Optimizer::simplifyWhile(NodeId node) {
+    auto children = tree->children(node);
+    NodeId condition = children[0].index;
+    NodeId body = children[1].index;
+
+    if (simplifyExpression(condition) && !constantOf(condition).toBool()) {
+        tree->replace(node, NodeKind::SUITE);
+        return;
+    }
+    simplifyStatement(body);
+}
+
+void Optimizer::simplifyFor(NodeId node) {
+    auto children = tree->children(node);
+    NodeId decl = children[0].index;
+    NodeId test = children[1].index;
+    NodeId updates = children[2].index;
+    NodeId body = children[3].index;
+
+    simplifyStatement(decl);
+    if (tree->size(test) > 0) {
+        NodeId condition = tree->children(test)[0].index;
+        if (simplifyExpression(condition)) {
+            if (!constantOf(condition).toBool()) {
+                // Only the initializers ever run
+                auto range = tree->children(decl);
+                std::vector<Child> initializers(range.begin(), range.end());
+                tree->replace(node, NodeKind::SUITE, initializers.data(), initializers.size());
+                return;
+            }
+            tree->replace(test, NodeKind::FOR_TEST);
+        }
+    }
+    simplifyStatement(updates);
+    simplifyStatement(body);
+}
+
+bool Optimizer::simplifyExpression(NodeId node) {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+
+    switch (kind) {
+        case NodeKind::CONSTANT:
+            return true;
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+            // The Parser already decoded the value into the pool
+            tree->replace(node, NodeKind::CONSTANT);
+            return true;
+        case NodeKind::NAME:
+            return false;
+        default:
+            break;
+    }
+
+    bool allConstant = true;
+    for (const Child& child : children) {
+        if (!child.isLeaf && !simplifyExpression(child.index)) {
+            allConstant = false;
+        }
+    }
+    if (!allConstant) return false;
+
+    Value result;
+    if (kind == NodeKind::CASTEXPRESSION && children.size() == 2) {
+        if (!foldUnary(node, result)) return false;
+    } else if ((kind == NodeKind::CASTEXPRESSION || kind == NodeKind::EXP) && children.size() == 1) {
+        result = constantOf(children[0].index);
+    } else if (isBinaryExpression(kind) && children.size() >= 3) {
+        if (!foldBinary(node, result)) return false;
+    } else {
+        return false;
+    }
+
+    makeConstant(node, result);
+    return true;
+}
+
+bool Optimizer::foldUnary(NodeId node, Value& result) {
+    auto children = tree->children(node);
+    std::string_view op = tree->leaf(children[0]).value;
+    const Value& operand = constantOf(children[1].index);
+
+    if (op == "!" || op == "not" || op == "❗") {
+        result = !operand.toBool();
+        return true;
+    }
+    if (op == "~" || op == "〰") {
+        result = ~operand.toInt();
+        return true;
+    }
+    return false;
+}
+
+bool Optimizer::foldBinary(NodeId node, Value& result) {
+    NodeKind kind = tree->kind(node);
+    auto children = tree->children(node);
+
+    result = constantOf(children[0].index);
+    for (size_t i = 1; i + 1 < children.size(); i += 2) {
+        std::string_view op = tree->leaf(children[i]).value;
+        if (!applyBinary(kind, op, result, constantOf(children[i + 1].index))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Optimizer::makeConstant(NodeId node, const Value& value) {
+    uint32_t index = tree->constants.add(value);
+    tree->replace(node, NodeKind::CONSTANT);
+    tree->setPayload(node, index);
+}
+
+const Value& Optimizer::constantOf(NodeId node) const {
+    return tree->constants[tree->payload(node)];
+}
+
+void Optimizer::countUses(NodeId node) {
+    auto children = tree->children(node);
+
+    switch (tree->kind(node)) {
+        case NodeKind::ASSIGNMENT_STMT:
+            countStore(children[0].index, children[1].index, false);
+            countUses(children[1].index);
+            return;
+        case NodeKind::DECLARE_STMT:
+            for (const Child& child : children) {
+                if (tree->kind(child.index) == NodeKind::NAME) {
+                    countStore(child.index, 0, true);
+                } else {
+                    countUses(child.index);
+                }
+            }
+            return;
+        case NodeKind::NAME:
+            slots[tree->payload(node)].reads++;
+            return;
+        default:
+            break;
+    }
+
+    for (const Child& child : children) {
+        if (!child.isLeaf) {
+            countUses(child.index);
+        }
+    }
+}
+
+void Optimizer::countStore(NodeId nameNode, NodeId value, bool bare) {
+    SlotUse& use = slots[tree->payload(nameNode)];
+    use.stores++;
+    use.value = value;
+    use.bare = bare;
+}
+
+void Optimizer::propagateConstants(NodeId node) {
+    auto children = tree->children(node);
+
+    switch (tree->kind(node)) {
+        case NodeKind::ASSIGNMENT_STMT:
+            propagateConstants(children[1].index);
+            return;
+        case NodeKind::DECLARE_STMT:
+            for (const Child& child : children) {
+                if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+                    propagateConstants(child.index);
+                }
+            }
+            return;
+        case NodeKind::NAME: {
+            // Every variable is declared, so a slot with a single store belongs
+            // to one variable whose value never changes after its declaration
+            const SlotUse& use = slots[tree->payload(node)];
+            if (use.stores != 1) return;
+            if (use.bare) {
+                makeConstant(node, Value(0));
+            } else if (tree->kind(use.value) == NodeKind::CONSTANT) {
+                uint32_t index = tree->payload(use.value);
+                tree->replace(node, NodeKind::CONSTANT);
+                tree->setPayload(node, index);
+            } else {
+                return;
+            }
+            changed = true;
+            return;
+        }
+        default:
+            break;
+    }
+
+    for (const Child& child : children) {
+        if (!child.isLeaf) {
+            propagateConstants(child.index);
+        }
+    }
+}
+
+void Optimizer::removeDeadStores(NodeId node) {
+    auto range = tree->children(node);
+    std::vector<Child> children(range.begin(), range.end());
+    NodeKind kind = tree->kind(node);
+
+    for (const Child& child : children) {
+        if (!child.isLeaf && kind != NodeKind::DECLARE_STMT) {
+            removeDeadStores(child.index);
+        }
+    }
+
+    bool isContainer = kind == NodeKind::STMT || kind == NodeKind::SUITE || kind == NodeKind::DECLARE_STMT ||
+                       kind == NodeKind::FOR_DECL || kind == NodeKind::FOR_UPDATES;
+    if (!isContainer) return;
+
+    std::vector<Child> kept;
+    for (const Child& child : children) {
+        if (child.isLeaf || !isDead(child.index)) {
+            kept.push_back(child);
+        }
+    }
+    if (kept.size() != children.size()) {
+        tree->replace(node, kind, kept.data(), kept.size());
+        changed = true;
+    }
+}
+
+bool Optimizer::isDead(NodeId statement) const {
+    switch (tree->kind(statement)) {
+        case NodeKind::ASSIGNMENT_STMT: {
+            auto children = tree->children(statement);
+            return slots[tree->payload(children[0].index)].reads == 0 && !mayTrap(children[1].index);
+        }
+        case NodeKind::NAME:
+            // Bare declaration
+            return slots[tree->payload(statement)].reads == 0;
+        case NodeKind::DECLARE_STMT:
+        case NodeKind::SUITE:
+            return tree->size(statement) == 0;
+        default:
+            return false;
+    }
+}
+
+// Like IrOptimizer::mayTrap: only a `📎` by a constant other than 0 and -1
+// is known not to raise "Modulo by zero"
+bool Optimizer::mayTrap(NodeId node) const {
+    auto children = tree->children(node);
+    if (tree->kind(node) == NodeKind::MULTIPLICATIVEEXPRESSION) {
+        for (size_t i = 1; i + 1 < children.size(); i += 2) {
+            std::string_view op = tree->leaf(children[i]).value;
+            if (op != "%" && op != "mod" && op != "📎") continue;
+            Child divisor = children[i + 1];
+            if (divisor.isLeaf || tree->kind(divisor.index) != NodeKind::CONSTANT) return true;
+            int constant = constantOf(divisor.index).toInt();
+            if (constant == 0 || constant == -1) return true;
+        }
+    }
+    for (const Child& child : children) {
+        if (!child.isLeaf && mayTrap(child.index)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,170 +1,132 @@
 #include "Parser.hpp"
+#include "EmojiTable.hpp"
+#include "Lexer.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <regex>
 #include <stdexcept>
+#include <charconv>
 
-Parser::Parser() : current(0) {
+Parser::Parser() : tree(nullptr) {
     initializeEmojiMappings();
 }
 
 void Parser::initializeEmojiMappings() {
-    emojiMappings = {
-        {"📢", "decl"},
-        {"😌", "="},
-        {"🗿", ","},
-        {"👄", ";"},
-        {"🖨", "print"},
-        {"👉", "("},
-        {"👈", ")"},
-        {"🍽", "{"},
-        {"🥂", "}"},
-        {"💿", "while"},
-        {"📀", "for"},
-        {"🚩", "if"},
-        {"🏳", "elif"},
-        {"🏁", "else"},
-        {"⏸", "break"},
-        {"⏩", "continue"},
-        {"✔", "true"},
-        {"❌", "false"},
-        {"➕", "+"},
-        {"➖", "-"},
-        {"✖", "*"},
-        {"➗", "/"},
-        {"📎", "%"},
-        {"😭", "<"},
-        {"😁", ">"},
-        {"😁😌", ">="},
-        {"😭😌", "<="},
-        {"😌😌", "=="},
-        {"❗😌", "!="},
-        {"⚛", "&"},
-        {"☯", "|"},
-        {"⚓", "xor"},
-        {"😠", "and"},
-        {"😇", "or"},
-        {"❗", "!"},
-        {"〰", "~"}
-    };
-}
-
-std::vector<TokenPtr> Parser::tokenize(const std::string& text) {
-    std::vector<TokenPtr> result;
-    std::string::size_type pos = 0;
-    
-    while (pos < text.length()) {
-        // Skip whitespace
-        if (std::isspace(text[pos])) {
-            pos++;
-            continue;
-        }
-        
-        // Skip comments (💩)
-        if (pos < text.length()) {
-            // Check for UTF-8 comment emoji (💩 is 4 bytes in UTF-8: F0 9F 92 A9)
-            if (pos + 4 <= text.length() && 
-                (unsigned char)text[pos] == 0xF0 && 
-                (unsigned char)text[pos+1] == 0x9F && 
-                (unsigned char)text[pos+2] == 0x92 && 
-                (unsigned char)text[pos+3] == 0xA9) {
-                // Skip to end of line
-                while (pos < text.length() && text[pos] != '\n') {
-                    pos++;
-                }
-                continue;
-            }
-        }
-        
-        // Handle string literals
-        if (text[pos] == '"') {
-            pos++;
-            std::string str;
-            while (pos < text.length() && text[pos] != '"') {
-                str += text[pos++];
-            }
-            if (pos < text.length()) pos++; // Skip closing quote
-            result.push_back(std::make_shared<Token>(TokenType::STRING, str));
-            continue;
-        }
-        
-        // Handle numbers
-        if (std::isdigit(text[pos]) || (text[pos] == '-' && pos + 1 < text.length() && std::isdigit(text[pos + 1]))) {
-            std::string num;
-            if (text[pos] == '-') {
-                num += text[pos++];
-            }
-            while (pos < text.length() && (std::isdigit(text[pos]) || text[pos] == '.')) {
-                num += text[pos++];
-            }
-            result.push_back(std::make_shared<Token>(TokenType::NUMBER, num));
-            continue;
-        }
-        
-        // Handle identifiers
-        if (std::isalpha(text[pos]) || text[pos] == '_') {
-            std::string id;
-            while (pos < text.length() && (std::isalnum(text[pos]) || text[pos] == '_')) {
-                id += text[pos++];
-            }
-            result.push_back(std::make_shared<Token>(TokenType::NAME, id));
-            continue;
-        }
-        
-        // Handle multi-character emojis first
-        bool foundEmoji = false;
-        for (const auto& mapping : emojiMappings) {
-            if (pos + mapping.first.length() <= text.length() && 
-                text.substr(pos, mapping.first.length()) == mapping.first) {
-                result.push_back(std::make_shared<Token>(TokenType::OPERATOR, mapping.first));
-                pos += mapping.first.length();
-                foundEmoji = true;
-                break;
-            }
-        }
-        
-        if (!foundEmoji) {
-            // Handle single characters
-            std::string ch(1, text[pos]);
-            result.push_back(std::make_shared<Token>(TokenType::OPERATOR, ch));
-            pos++;
-        }
+    emojiMappings.clear();
+    for (const auto& mapping : EMOJI_MAPPINGS) {
+        emojiMappings.emplace(mapping.emoji, mapping.text);
     }
-    
-    result.push_back(std::make_shared<Token>(TokenType::END_OF_FILE, ""));
+}
+
+std::vector<LexToken> Parser::tokenize(std::string_view text) {
+    return Lexer(text).tokenize();
+}
+
+Tree Parser::parse(std::string_view text) {
+    Tree result;
+    tree = &result;
+    pending.clear();
+    tokens = std::make_unique<TokenStream>(text);
+    parseProgram();
     return result;
 }
 
-TreePtr Parser::parse(const std::string& text) {
-    tokens = tokenize(text);
-    current = 0;
-    
-    auto root = std::make_shared<Tree>("stmt");
+Tree Parser::parse(std::istream& input) {
+    Tree result;
+    tree = &result;
+    pending.clear();
+    tokens = std::make_unique<TokenStream>(input);
+    parseProgram();
+    return result;
+}
+
+void Parser::parse(std::istream& input, const std::function<void(Tree&, NodeId)>& onStatement) {
+    Tree statementTree;
+    tree = &statementTree;
+    pending.clear();
+    tokens = std::make_unique<TokenStream>(input);
     
     while (!isAtEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            root->addChild(stmt);
-        }
+        statementTree.clear();
+        statementTree.root = parseStatement();
+        onStatement(statementTree, statementTree.root);
     }
     
-    return root;
+    tokens.reset();
+    tree = nullptr;
 }
 
-TokenPtr Parser::peek() {
-    if (current >= tokens.size()) {
-        return std::make_shared<Token>(TokenType::END_OF_FILE, "");
+void Parser::parseProgram() {
+    size_t mark = pending.size();
+    
+    while (!isAtEnd()) {
+        NodeId stmt = parseStatement();
+        pending.push_back(nodeChild(stmt));
     }
-    return tokens[current];
+    
+    tree->root = addPending(NodeKind::STMT, mark);
+    tokens.reset();
+    tree = nullptr;
+}
+
+const LexToken& Parser::peek() {
+    return tokens->peek();
+}
+
+LexToken Parser::advance() {
+    return tokens->advance();
+}
+
+std::string_view Parser::text(const LexToken& token) const {
+    return tokens->text(token);
+}
+
+Child Parser::leaf(const LexToken& token) {
+    return tree->addLeaf(token.type, text(token), token.line, token.column);
 }
 
-TokenPtr Parser::advance() {
-    if (!isAtEnd()) current++;
-    return tokens[current - 1];
+NodeId Parser::wrap(NodeKind kind, Child child) {
+    return tree->addNode(kind, {child});
 }
 
-bool Parser::match(const std::string& value) {
+NodeId Parser::addPending(NodeKind kind, size_t mark) {
+    NodeId node = tree->addNode(kind, pending.data() + mark, pending.size() - mark);
+    pending.resize(mark);
+    return node;
+}
+
+// Literal node for the current token; its value goes into the tree's constant pool
+NodeId Parser::literal(NodeKind kind, const Value& value) {
+    NodeId node = wrap(kind, leaf(advance()));
+    tree->setPayload(node, tree->constants.add(value));
+    return node;
+}
+
+Value Parser::decodeNumber(const LexToken& token) {
+    std::string_view digits = text(token);
+    const char* first = digits.data();
+    const char* last = first + digits.size();
+    
+    std::from_chars_result result;
+    Value value;
+    if (digits.find('.') != std::string_view::npos) {
+        double number = 0.0;
+        result = std::from_chars(first, last, number);
+        value = number;
+    } else {
+        int number = 0;
+        result = std::from_chars(first, last, number);
+        value = number;
+    }
+    
+    if (result.ec != std::errc() || result.ptr != last) {
+        throw std::runtime_error("Invalid number literal '" + std::string(digits) + "' at line " +
+                                 std::to_string(token.line) + ", column " + std::to_string(token.column));
+    }
+    return value;
+}
+
+bool Parser::match(std::string_view value) {
     if (check(value)) {
         advance();
         return true;
@@ -172,334 +134,300 @@ bool Parser::match(const std::string& value) {
     return false;
 }
 
-bool Parser::check(const std::string& value) {
+bool Parser::check(std::string_view value) {
     if (isAtEnd()) return false;
-    return peek()->value == value;
+    return text(peek()) == value;
+}
+
+bool Parser::checkNext(std::string_view value) {
+    return text(tokens->peek(1)) == value;
 }
 
 bool Parser::isAtEnd() {
-    return current >= tokens.size() || peek()->type == TokenType::END_OF_FILE;
+    return peek().type == TokenType::END_OF_FILE;
 }
 
 // Simplified parsing implementation
-TreePtr Parser::parseStatement() {
+NodeId Parser::parseStatement() {
     if (check("📢")) return parseDeclareStatement();
     if (check("🖨")) return parsePrintStatement();
     if (check("🚩")) return parseIfStatement();
     if (check("💿")) return parseWhileStatement();
     if (check("📀")) return parseForStatement();
     if (check("⏸") || check("⏩")) return parseFlowStatement();
+    if (check("🚀")) return parseSpawnStatement();
+    if (match("🤝")) return tree->addNode(NodeKind::JOIN_STMT);
     
     // Try assignment
-    if (peek()->type == TokenType::NAME && tokens.size() > current + 1 && tokens[current + 1]->value == "😌") {
+    if (peek().type == TokenType::NAME && checkNext("😌")) {
         return parseAssignmentStatement();
     }
     
     return parseExpression();
 }
 
-TreePtr Parser::parseSimpleStatement() {
-    return parseStatement();
-}
-
-TreePtr Parser::parseCompoundStatement() {
-    if (check("🚩")) return parseIfStatement();
-    if (check("💿")) return parseWhileStatement();
-    if (check("📀")) return parseForStatement();
-    return nullptr;
-}
-
-TreePtr Parser::parseAssignmentStatement() {
-    auto stmt = std::make_shared<Tree>("assignment_stmt");
-    
-    auto nameTree = std::make_shared<Tree>("name");
-    nameTree->addChild(advance());
-    stmt->addChild(nameTree);
+NodeId Parser::parseAssignmentStatement() {
+    NodeId name = wrap(NodeKind::NAME, leaf(advance()));
     
     advance(); // consume "😌"
-    stmt->addChild(parseExpression());
+    NodeId value = parseExpression();
     
-    return stmt;
+    return tree->addNode(NodeKind::ASSIGNMENT_STMT, {nodeChild(name), nodeChild(value)});
 }
 
-TreePtr Parser::parseDeclareStatement() {
-    auto stmt = std::make_shared<Tree>("declare_stmt");
+NodeId Parser::parseDeclareStatement() {
+    size_t mark = pending.size();
     advance(); // consume "📢"
     
-    auto nameTree = std::make_shared<Tree>("name");
-    nameTree->addChild(advance());
-    stmt->addChild(nameTree);
-    
-    if (match("😌")) {
-        stmt->addChild(parseExpression());
-    }
-    
-    while (match("🗿")) {
-        nameTree = std::make_shared<Tree>("name");
-        nameTree->addChild(advance());
-        stmt->addChild(nameTree);
-        
-        if (match("😌")) {
-            stmt->addChild(parseExpression());
+    do {
+        // "name 😌 value" declares with an initial value, a bare name defaults to 0
+        if (peek().type == TokenType::NAME && checkNext("😌")) {
+            pending.push_back(nodeChild(parseAssignmentStatement()));
+        } else {
+            pending.push_back(nodeChild(wrap(NodeKind::NAME, leaf(advance()))));
         }
-    }
+    } while (match("🗿"));
     
-    return stmt;
+    return addPending(NodeKind::DECLARE_STMT, mark);
 }
 
-TreePtr Parser::parseFlowStatement() {
-    auto stmt = std::make_shared<Tree>("flow_stmt");
-    auto token = advance();
+NodeId Parser::parseFlowStatement() {
+    std::string_view token = text(advance());
+    NodeKind kind = token == "⏸" ? NodeKind::BREAK_STMT : NodeKind::CONTINUE_STMT;
     
-    if (token->value == "⏸") {
-        auto breakStmt = std::make_shared<Tree>("break_stmt");
-        stmt->addChild(breakStmt);
-    } else if (token->value == "⏩") {
-        auto continueStmt = std::make_shared<Tree>("continue_stmt");
-        stmt->addChild(continueStmt);
-    }
-    
-    return stmt;
+    return wrap(NodeKind::FLOW_STMT, nodeChild(tree->addNode(kind)));
 }
 
-TreePtr Parser::parsePrintStatement() {
-    auto stmt = std::make_shared<Tree>("print_stmt");
+NodeId Parser::parsePrintStatement() {
     advance(); // consume "🖨"
     advance(); // consume "👉"
     
-    stmt->addChild(parseExpression());
+    NodeId value = parseExpression();
     
     advance(); // consume "👈"
-    return stmt;
+    return wrap(NodeKind::PRINT_STMT, nodeChild(value));
 }
 
-TreePtr Parser::parseIfStatement() {
-    auto stmt = std::make_shared<Tree>("if_stmt");
-    advance(); // consume "🚩"
-    advance(); // consume "👉"
-    
-    stmt->addChild(parseExpression()); // condition
-    
-    advance(); // consume "👈"
-    advance(); // consume "🍽"
+NodeId Parser::parseIfStatement() {
+    size_t mark = pending.size();
     
-    stmt->addChild(parseSuite()); // body
+    // Each branch contributes its keyword leaf, then condition and body (no condition for else)
+    do {
+        Child keyword = leaf(advance()); // "🚩" or "🏳"
+        advance(); // consume "👉"
+        NodeId condition = parseExpression();
+        advance(); // consume "👈"
+        advance(); // consume "🍽"
+        NodeId body = parseSuite();
+        advance(); // consume "🥂"
+        
+        pending.push_back(keyword);
+        pending.push_back(nodeChild(condition));
+        pending.push_back(nodeChild(body));
+    } while (check("🏳"));
+    
+    if (check("🏁")) {
+        Child keyword = leaf(advance());
+        advance(); // consume "🍽"
+        NodeId body = parseSuite();
+        advance(); // consume "🥂"
+        
+        pending.push_back(keyword);
+        pending.push_back(nodeChild(body));
+    }
     
-    advance(); // consume "🥂"
-    return stmt;
+    return addPending(NodeKind::IF_STMT, mark);
 }
 
-TreePtr Parser::parseWhileStatement() {
-    auto stmt = std::make_shared<Tree>("while_stmt");
+NodeId Parser::parseWhileStatement() {
     advance(); // consume "💿"
     advance(); // consume "👉"
     
-    stmt->addChild(parseExpression()); // condition
+    NodeId condition = parseExpression();
     
     advance(); // consume "👈"
     advance(); // consume "🍽"
     
-    stmt->addChild(parseSuite()); // body
+    NodeId body = parseSuite();
     
     advance(); // consume "🥂"
-    return stmt;
+    return tree->addNode(NodeKind::WHILE_STMT, {nodeChild(condition), nodeChild(body)});
 }
 
-TreePtr Parser::parseForStatement() {
-    auto stmt = std::make_shared<Tree>("for_stmt");
+NodeId Parser::parseForStatement() {
     advance(); // consume "📀"
     advance(); // consume "👉"
     
-    stmt->addChild(parseForDecl());   // init
+    NodeId init = parseForDecl();
     advance(); // consume "👄"
-    stmt->addChild(parseForTest());   // condition
+    NodeId condition = parseForTest();
     advance(); // consume "👄"
-    stmt->addChild(parseForUpdates()); // update
+    NodeId update = parseForUpdates();
     
     advance(); // consume "👈"
     advance(); // consume "🍽"
     
-    stmt->addChild(parseSuite()); // body
+    NodeId body = parseSuite();
     
     advance(); // consume "🥂"
-    return stmt;
-}
-
-TreePtr Parser::parseExpression() {
-    return parseLogicalOrExpression();
+    return tree->addNode(NodeKind::FOR_STMT,
+                         {nodeChild(init), nodeChild(condition), nodeChild(update), nodeChild(body)});
 }
 
-// Simplified expression parsing
-TreePtr Parser::parseLogicalOrExpression() {
-    auto expr = parseLogicalAndExpression();
-    
-    while (check("😇") || check("||")) {
-        auto newExpr = std::make_shared<Tree>("logicalorexpression");
-        newExpr->addChild(expr);
-        newExpr->addChild(advance());
-        newExpr->addChild(parseLogicalAndExpression());
-        expr = newExpr;
-    }
+NodeId Parser::parseSpawnStatement() {
+    advance(); // consume "🚀"
+    advance(); // consume "🍽"
     
-    return expr;
-}
-
-TreePtr Parser::parseLogicalAndExpression() {
-    auto expr = parseInclusiveOrExpression();
+    NodeId body = parseSuite();
     
-    while (check("😠") || check("&&")) {
-        auto newExpr = std::make_shared<Tree>("logicalandexpression");
-        newExpr->addChild(expr);
-        newExpr->addChild(advance());
-        newExpr->addChild(parseInclusiveOrExpression());
-        expr = newExpr;
+    advance(); // consume "🥂"
+    return wrap(NodeKind::SPAWN_STMT, nodeChild(body));
+}
+
+NodeId Parser::parseExpression() {
+    return parseBinaryExpression(1);
+}
+
+namespace {
+
+struct BinaryOperator {
+    std::string_view token;
+    int precedence;
+    NodeKind kind;
+};
+
+// Binary operators from loosest to tightest binding; all are left-associative.
+constexpr BinaryOperator BINARY_OPERATORS[] = {
+    {"😇", 1, NodeKind::LOGICALOREXPRESSION},
+    {"||", 1, NodeKind::LOGICALOREXPRESSION},
+    {"😠", 2, NodeKind::LOGICALANDEXPRESSION},
+    {"&&", 2, NodeKind::LOGICALANDEXPRESSION},
+    {"☯", 3, NodeKind::INCLUSIVEOREXPRESSION},
+    {"⚓", 4, NodeKind::EXCLUSIVEOREXPRESSION},
+    {"⚛", 5, NodeKind::ANDEXPRESSION},
+    {"😌😌", 6, NodeKind::EQUALITYEXPRESSION},
+    {"❗😌", 6, NodeKind::EQUALITYEXPRESSION},
+    {"😭", 6, NodeKind::EQUALITYEXPRESSION},
+    {"😁", 6, NodeKind::EQUALITYEXPRESSION},
+    {"😭😌", 6, NodeKind::EQUALITYEXPRESSION},
+    {"😁😌", 6, NodeKind::EQUALITYEXPRESSION},
+    {"➕", 7, NodeKind::ADDITIVEEXPRESSION},
+    {"➖", 7, NodeKind::ADDITIVEEXPRESSION},
+    {"+", 7, NodeKind::ADDITIVEEXPRESSION},
+    {"-", 7, NodeKind::ADDITIVEEXPRESSION},
+    {"✖", 8, NodeKind::MULTIPLICATIVEEXPRESSION},
+    {"➗", 8, NodeKind::MULTIPLICATIVEEXPRESSION},
+    {"📎", 8, NodeKind::MULTIPLICATIVEEXPRESSION},
+    {"*", 8, NodeKind::MULTIPLICATIVEEXPRESSION},
+    {"/", 8, NodeKind::MULTIPLICATIVEEXPRESSION},
+    {"%", 8, NodeKind::MULTIPLICATIVEEXPRESSION}
+};
+
+const BinaryOperator* findBinaryOperator(const LexToken& token, std::string_view text) {
+    if (token.type != TokenType::OPERATOR) return nullptr;
+    for (const auto& op : BINARY_OPERATORS) {
+        if (op.token == text) return &op;
     }
-    
-    return expr;
-}
-
-TreePtr Parser::parseInclusiveOrExpression() {
-    return parseExclusiveOrExpression();
-}
-
-TreePtr Parser::parseExclusiveOrExpression() {
-    return parseAndExpression();
+    return nullptr;
 }
 
-TreePtr Parser::parseAndExpression() {
-    return parseEqualityExpression();
+bool isUnaryOperator(std::string_view text) {
+    return text == "❗" || text == "〰" || text == "!" || text == "~";
 }
 
-TreePtr Parser::parseEqualityExpression() {
-    auto expr = parseAdditiveExpression();
-    
-    while (check("😌😌") || check("❗😌") || check("😭") || check("😁") || check("😭😌") || check("😁😌")) {
-        auto newExpr = std::make_shared<Tree>("equalityexpression");
-        newExpr->addChild(expr);
-        newExpr->addChild(advance());
-        newExpr->addChild(parseAdditiveExpression());
-        expr = newExpr;
-    }
-    
-    return expr;
-}
+} // namespace
 
-TreePtr Parser::parseAdditiveExpression() {
-    auto expr = parseMultiplicativeExpression();
+// Precedence climbing: operands are parsed once and only wrapped in a node
+// when an operator actually follows, so a bare name or literal costs a
+// single node and no pass-through levels.
+NodeId Parser::parseBinaryExpression(int minPrecedence) {
+    NodeId expr = parseCastExpression();
     
-    while (check("➕") || check("➖") || check("+") || check("-")) {
-        auto newExpr = std::make_shared<Tree>("additiveexpression");
-        newExpr->addChild(expr);
-        newExpr->addChild(advance());
-        newExpr->addChild(parseMultiplicativeExpression());
-        expr = newExpr;
-    }
-    
-    return expr;
-}
-
-TreePtr Parser::parseMultiplicativeExpression() {
-    auto expr = parseCastExpression();
-    
-    while (check("✖") || check("➗") || check("📎") || check("*") || check("/") || check("%")) {
-        auto newExpr = std::make_shared<Tree>("multiplicativeexpression");
-        newExpr->addChild(expr);
-        newExpr->addChild(advance());
-        newExpr->addChild(parseCastExpression());
-        expr = newExpr;
+    while (true) {
+        const LexToken& token = peek();
+        const BinaryOperator* op = findBinaryOperator(token, text(token));
+        if (!op || op->precedence < minPrecedence) break;
+        
+        Child opLeaf = leaf(advance());
+        NodeId right = parseBinaryExpression(op->precedence + 1);
+        expr = tree->addNode(op->kind, {nodeChild(expr), opLeaf, nodeChild(right)});
     }
     
     return expr;
 }
 
-TreePtr Parser::parseCastExpression() {
-    auto expr = std::make_shared<Tree>("castexpression");
-    
-    if (check("❗") || check("〰") || check("!") || check("~")) {
-        expr->addChild(advance());
-        expr->addChild(parseArgument());
-    } else {
-        expr->addChild(parseArgument());
+NodeId Parser::parseCastExpression() {
+    const LexToken& token = peek();
+    if (token.type == TokenType::OPERATOR && isUnaryOperator(text(token))) {
+        Child op = leaf(advance());
+        NodeId operand = parseArgument();
+        return tree->addNode(NodeKind::CASTEXPRESSION, {op, nodeChild(operand)});
     }
     
-    return expr;
+    return parseArgument();
 }
 
-TreePtr Parser::parseArgument() {
+NodeId Parser::parseArgument() {
     if (check("✔") || check("❌")) {
-        auto boolTree = std::make_shared<Tree>("boolean");
-        boolTree->addChild(advance());
-        return boolTree;
+        return literal(NodeKind::BOOLEAN, check("✔"));
     }
     
-    if (peek()->type == TokenType::NUMBER) {
-        auto numTree = std::make_shared<Tree>("number");
-        numTree->addChild(advance());
-        return numTree;
+    if (peek().type == TokenType::NUMBER) {
+        return literal(NodeKind::NUMBER, decodeNumber(peek()));
     }
     
-    if (peek()->type == TokenType::NAME) {
-        auto nameTree = std::make_shared<Tree>("name");
-        nameTree->addChild(advance());
-        return nameTree;
+    if (peek().type == TokenType::NAME) {
+        return wrap(NodeKind::NAME, leaf(advance()));
     }
     
-    if (peek()->type == TokenType::STRING) {
-        auto strTree = std::make_shared<Tree>("string");
-        strTree->addChild(advance());
-        return strTree;
+    if (peek().type == TokenType::STRING) {
+        return literal(NodeKind::STRING, std::string(text(peek())));
     }
     
     if (match("👉")) {
-        auto expr = parseExpression();
+        NodeId expr = parseExpression();
         advance(); // consume "👈"
         return expr;
     }
     
-    throw std::runtime_error("Unexpected token: " + peek()->value);
+    const LexToken& token = peek();
+    throw std::runtime_error("Unexpected token '" + std::string(text(token)) + "' at line " +
+                             std::to_string(token.line) + ", column " + std::to_string(token.column));
 }
 
-TreePtr Parser::parseSuite() {
-    auto suite = std::make_shared<Tree>("suite");
+NodeId Parser::parseSuite() {
+    size_t mark = pending.size();
     
     while (!check("🥂") && !isAtEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            suite->addChild(stmt);
-        }
+        NodeId stmt = parseStatement();
+        pending.push_back(nodeChild(stmt));
     }
     
-    return suite;
+    return addPending(NodeKind::SUITE, mark);
 }
 
-TreePtr Parser::parseForDecl() {
-    auto decl = std::make_shared<Tree>("for_decl");
-    
+NodeId Parser::parseForDecl() {
     if (check("📢")) {
-        decl->addChild(parseDeclareStatement());
-    } else if (peek()->type == TokenType::NAME && tokens.size() > current + 1 && tokens[current + 1]->value == "😌") {
-        decl->addChild(parseAssignmentStatement());
+        return wrap(NodeKind::FOR_DECL, nodeChild(parseDeclareStatement()));
+    } else if (peek().type == TokenType::NAME && checkNext("😌")) {
+        return wrap(NodeKind::FOR_DECL, nodeChild(parseAssignmentStatement()));
     }
     
-    return decl;
+    return tree->addNode(NodeKind::FOR_DECL);
 }
 
-TreePtr Parser::parseForTest() {
-    auto test = std::make_shared<Tree>("for_test");
-    
+NodeId Parser::parseForTest() {
     if (!check("👄")) {
-        test->addChild(parseExpression());
+        return wrap(NodeKind::FOR_TEST, nodeChild(parseExpression()));
     }
     
-    return test;
+    return tree->addNode(NodeKind::FOR_TEST);
 }
 
-TreePtr Parser::parseForUpdates() {
-    auto updates = std::make_shared<Tree>("for_updates");
-    
-    if (peek()->type == TokenType::NAME && tokens.size() > current + 1 && tokens[current + 1]->value == "😌") {
-        updates->addChild(parseAssignmentStatement());
+NodeId Parser::parseForUpdates() {
+    if (peek().type == TokenType::NAME && checkNext("😌")) {
+        return wrap(NodeKind::FOR_UPDATES, nodeChild(parseAssignmentStatement()));
     }
     
-    return updates;
+    return tree->addNode(NodeKind::FOR_UPDATES);
 }
@@ -0,0 +1,474 @@
+#include "ProgramCache.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "SourceBuffer.hpp"
+#if __has_include("FrontendVersion.hpp")
+#include "FrontendVersion.hpp"
+#endif
+
+namespace {
+
+// Hash of the front-end sources and of this file, generated by the build
+// (cmake/FrontendVersion.cmake), so entries are only ever read by a build
+// that compiles programs to the same trees and encodes them the same way.
+// A build without it has no version to key on and does not cache at all.
+#ifdef EMOJILANG_FRONTEND_VERSION
+constexpr bool VERSIONED = true;
+constexpr uint64_t VERSION = EMOJILANG_FRONTEND_VERSION;
+#else
+constexpr bool VERSIONED = false;
+constexpr uint64_t VERSION = 0;
+#endif
+
+constexpr char MAGIC[8] = {'E', 'M', 'O', 'C', 'A', 'C', 'H', 'E'};
+constexpr size_t HEADER_SIZE = 52;
+constexpr uint32_t OPTIMIZED = 1;
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashBytes(std::string_view bytes, uint64_t hash = FNV_OFFSET) {
+    for (char c : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Header fields are fixed-width and everything else a LEB128 varint, all
+// written byte by byte, so entries do not depend on the host's byte order or
+// on struct padding and small indices take a single byte.
+class Writer {
+public:
+    std::string bytes;
+
+    void u8(uint8_t value) { bytes += static_cast<char>(value); }
+    void u32(uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            u8(static_cast<uint8_t>(value >> shift));
+        }
+    }
+    void u64(uint64_t value) {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32));
+    }
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            u8(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        u8(static_cast<uint8_t>(value));
+    }
+    void text(std::string_view value) {
+        varint(value.size());
+        bytes += value;
+    }
+};
+
+// Reads past the end leave `ok` false and return zeros
+class Reader {
+public:
+    explicit Reader(std::string_view bytes) : bytes(bytes), position(0), ok(true) {}
+
+    uint8_t u8() {
+        if (position >= bytes.size()) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<uint8_t>(bytes[position++]);
+    }
+    uint32_t u32() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            value |= static_cast<uint32_t>(u8()) << shift;
+        }
+        return value;
+    }
+    uint64_t u64() {
+        uint64_t low = u32();
+        return low | static_cast<uint64_t>(u32()) << 32;
+    }
+    uint32_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = u8();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                if (value > UINT32_MAX) break;
+                return static_cast<uint32_t>(value);
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    std::string_view text() {
+        uint32_t length = varint();
+        if (!ok || length > bytes.size() - position) {
+            ok = false;
+            return {};
+        }
+        std::string_view value = bytes.substr(position, length);
+        position += length;
+        return value;
+    }
+    bool atEnd() const { return ok && position == bytes.size(); }
+    // Guards counts read from the entry against absurd allocations
+    bool fits(uint64_t count) const { return ok && count <= bytes.size() - position; }
+
+private:
+    std::string_view bytes;
+    size_t position;
+
+public:
+    bool ok;
+};
+
+bool isLiteral(NodeKind kind) {
+    return kind == NodeKind::NUMBER || kind == NodeKind::STRING || kind == NodeKind::BOOLEAN ||
+           kind == NodeKind::CONSTANT;
+}
+
+bool isElse(std::string_view keyword) {
+    return keyword == "else" || keyword == "🏁";
+}
+
+bool isNodeOf(const Tree& tree, const Child& child, NodeKind kind) {
+    return !child.isLeaf && tree.kind(child.index) == kind;
+}
+
+// Whether a node has the children its kind is built with by the Parser and
+// rewritten to by the Optimizer, which is what the engines index into
+// without checking
+bool hasShape(const Tree& tree, NodeId node) {
+    ChildRange children = tree.children(node);
+    size_t count = children.size();
+    auto onlyNodes = [&] {
+        for (const Child& child : children) {
+            if (child.isLeaf) return false;
+        }
+        return true;
+    };
+
+    switch (tree.kind(node)) {
+        case NodeKind::STMT:
+        case NodeKind::SUITE:
+        case NodeKind::DECLARE_STMT:
+        case NodeKind::FOR_DECL:
+        case NodeKind::FOR_UPDATES:
+            return onlyNodes();
+        case NodeKind::ASSIGNMENT_STMT:
+            return count == 2 && isNodeOf(tree, children[0], NodeKind::NAME) && !children[1].isLeaf;
+        case NodeKind::PRINT_STMT:
+        case NodeKind::SPAWN_STMT:
+        case NodeKind::EXP:
+            return count == 1 && !children[0].isLeaf;
+        case NodeKind::WHILE_STMT:
+            return count == 2 && onlyNodes();
+        case NodeKind::FOR_STMT:
+            return count == 4 && isNodeOf(tree, children[0], NodeKind::FOR_DECL) &&
+                   isNodeOf(tree, children[1], NodeKind::FOR_TEST) &&
+                   isNodeOf(tree, children[2], NodeKind::FOR_UPDATES) && !children[3].isLeaf;
+        case NodeKind::FOR_TEST:
+            return count <= 1 && onlyNodes();
+        case NodeKind::FLOW_STMT:
+            return count == 1 && (isNodeOf(tree, children[0], NodeKind::BREAK_STMT) ||
+                                  isNodeOf(tree, children[0], NodeKind::CONTINUE_STMT));
+        case NodeKind::BREAK_STMT:
+        case NodeKind::CONTINUE_STMT:
+        case NodeKind::JOIN_STMT:
+        case NodeKind::CONSTANT:
+            return count == 0;
+        case NodeKind::NAME:
+        case NodeKind::NUMBER:
+        case NodeKind::STRING:
+        case NodeKind::BOOLEAN:
+            return count == 1 && children[0].isLeaf;
+        case NodeKind::CASTEXPRESSION:
+            return (count == 1 && !children[0].isLeaf) || (count == 2 && children[0].isLeaf && !children[1].isLeaf);
+        case NodeKind::IF_STMT: {
+            // Arms of keyword, condition and body, then maybe else and body
+            size_t i = 0;
+            while (i < count) {
+                bool last = children[i].isLeaf && isElse(tree.leaf(children[i]).value);
+                size_t end = i + (last ? 2 : 3);
+                if (!children[i].isLeaf || end > count) return false;
+                for (size_t k = i + 1; k < end; ++k) {
+                    if (children[k].isLeaf) return false;
+                }
+                i = end;
+                if (last) break;
+            }
+            return count > 0 && i == count;
+        }
+        default:
+            // Binary expressions: operand, then operator leaf and operand pairs
+            if (count < 3 || count % 2 == 0) return false;
+            for (size_t i = 0; i < count; ++i) {
+                if (children[i].isLeaf != (i % 2 == 1)) return false;
+            }
+            return true;
+    }
+}
+
+// Checks the shape of every node reachable from the root. Nodes the
+// Optimizer left behind unreachable are never run and not checked.
+bool wellFormed(const Tree& tree) {
+    if (tree.nodeCount() == 0 || tree.kind(tree.root) != NodeKind::STMT) return false;
+    std::vector<bool> seen(tree.nodeCount());
+    std::vector<NodeId> pending{tree.root};
+    while (!pending.empty()) {
+        NodeId node = pending.back();
+        pending.pop_back();
+        if (seen[node]) continue;
+        seen[node] = true;
+        if (!hasShape(tree, node)) return false;
+        for (const Child& child : tree.children(node)) {
+            if (!child.isLeaf) pending.push_back(child.index);
+        }
+    }
+    return true;
+}
+
+std::string encode(const Tree& tree) {
+    Writer out;
+    out.varint(tree.root);
+    out.varint(tree.frameSize);
+
+    const std::vector<Value>& constants = tree.constants.all();
+    out.varint(constants.size());
+    for (const Value& value : constants) {
+        out.u8(static_cast<uint8_t>(value.type()));
+        if (value.isInt()) {
+            out.u32(static_cast<uint32_t>(value.asInt()));
+        } else if (value.isDouble()) {
+            double number = value.asDouble();
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            out.u64(bits);
+        } else if (value.isBool()) {
+            out.u8(value.asBool() ? 1 : 0);
+        } else if (value.isString()) {
+            out.text(value.asString());
+        }
+    }
+
+    // Leaves repeat a handful of operator and keyword spellings, so their
+    // text is written once and referred to by index
+    std::unordered_map<std::string_view, uint32_t> textIndices;
+    std::vector<std::string_view> texts;
+    std::vector<uint32_t> leafTexts(tree.leafCount());
+    for (uint32_t i = 0; i < tree.leafCount(); ++i) {
+        std::string_view text = tree.leaf(Child{i, true}).value;
+        auto inserted = textIndices.emplace(text, static_cast<uint32_t>(texts.size()));
+        if (inserted.second) {
+            texts.push_back(text);
+        }
+        leafTexts[i] = inserted.first->second;
+    }
+    out.varint(texts.size());
+    for (std::string_view text : texts) {
+        out.text(text);
+    }
+    out.varint(tree.leafCount());
+    for (uint32_t i = 0; i < tree.leafCount(); ++i) {
+        const Leaf& leaf = tree.leaf(Child{i, true});
+        out.u8(static_cast<uint8_t>(leaf.type));
+        out.varint(leaf.line);
+        out.varint(leaf.column);
+        out.varint(leafTexts[i]);
+    }
+
+    // Child slots abandoned by Tree::replace are not written. A child is
+    // written as its index shifted left once, with the low bit set for leaves.
+    out.varint(tree.nodeCount());
+    for (NodeId node = 0; node < tree.nodeCount(); ++node) {
+        out.u8(static_cast<uint8_t>(tree.kind(node)));
+        out.varint(tree.payload(node));
+        out.varint(tree.size(node));
+        for (const Child& child : tree.children(node)) {
+            out.varint(static_cast<uint64_t>(child.index) << 1 | (child.isLeaf ? 1 : 0));
+        }
+    }
+    return out.bytes;
+}
+
+// Rebuilds the tree with the same node, leaf and constant indices. Every
+// index is checked on the way, children must precede their parent (so there
+// are no cycles) and every reachable node must have its kind's shape.
+bool decode(std::string_view payload, Tree& tree) {
+    Reader in(payload);
+    tree.root = in.varint();
+    tree.frameSize = in.varint();
+
+    uint32_t constantCount = in.varint();
+    if (!in.fits(constantCount)) return false;
+    for (uint32_t i = 0; i < constantCount; ++i) {
+        Value value;
+        switch (static_cast<Value::Type>(in.u8())) {
+            case Value::Type::NONE:
+                break;
+            case Value::Type::INT:
+                value = static_cast<int>(in.u32());
+                break;
+            case Value::Type::DOUBLE: {
+                uint64_t bits = in.u64();
+                double number;
+                std::memcpy(&number, &bits, sizeof(number));
+                value = number;
+                break;
+            }
+            case Value::Type::BOOL:
+                value = in.u8() != 0;
+                break;
+            case Value::Type::STRING:
+                value = in.text();
+                break;
+            default:
+                return false;
+        }
+        if (!in.ok || tree.constants.add(value) != i) return false;
+    }
+
+    uint32_t textCount = in.varint();
+    if (!in.fits(textCount)) return false;
+    std::vector<std::string_view> texts(textCount);
+    for (std::string_view& text : texts) {
+        text = in.text();
+    }
+    uint32_t leafCount = in.varint();
+    if (!in.fits(leafCount)) return false;
+    for (uint32_t i = 0; i < leafCount; ++i) {
+        uint8_t type = in.u8();
+        uint32_t line = in.varint();
+        uint32_t column = in.varint();
+        uint32_t text = in.varint();
+        if (!in.ok || type > static_cast<uint8_t>(TokenType::END_OF_FILE) || text >= textCount) return false;
+        tree.addLeaf(static_cast<TokenType>(type), texts[text], line, column);
+    }
+
+    uint32_t nodeCount = in.varint();
+    if (!in.fits(nodeCount)) return false;
+    std::vector<Child> children;
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        uint8_t kind = in.u8();
+        uint32_t payload = in.varint();
+        uint32_t childCount = in.varint();
+        if (!in.fits(childCount) || kind > static_cast<uint8_t>(NodeKind::EXP)) return false;
+        children.clear();
+        for (uint32_t c = 0; c < childCount; ++c) {
+            uint32_t encoded = in.varint();
+            Child child{encoded >> 1, (encoded & 1) != 0};
+            // Children precede their parent, which also rules out cycles
+            if (child.index >= (child.isLeaf ? leafCount : i)) return false;
+            children.push_back(child);
+        }
+        NodeKind nodeKind = static_cast<NodeKind>(kind);
+        if ((nodeKind == NodeKind::NAME && payload >= tree.frameSize) ||
+            (isLiteral(nodeKind) && payload >= constantCount)) {
+            return false;
+        }
+        tree.setPayload(tree.addNode(nodeKind, children.data(), children.size()), payload);
+    }
+    return in.atEnd() && tree.root < nodeCount && wellFormed(tree);
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string ProgramCache::entryPath(std::string_view source, bool optimized) const {
+    Writer key;
+    key.u64(VERSION);
+    key.u32(optimized ? OPTIMIZED : 0);
+    uint64_t hash = hashBytes(source, hashBytes(key.bytes));
+
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4) {
+        name[i] = DIGITS[hash & 0xf];
+    }
+    return (std::filesystem::path(directory) / (name + ".emoc")).string();
+}
+
+bool ProgramCache::load(std::string_view source, bool optimized, Tree& tree) const {
+    std::string path = entryPath(source, optimized);
+    std::error_code error;
+    if (!VERSIONED || !std::filesystem::is_regular_file(path, error)) {
+        return false;
+    }
+    SourceBuffer entry;
+    try {
+        entry = SourceBuffer::fromFile(path);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    std::string_view bytes = entry.text();
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+    Reader header(bytes.substr(sizeof(MAGIC), HEADER_SIZE - sizeof(MAGIC)));
+    uint64_t version = header.u64();
+    uint32_t flags = header.u32();
+    uint64_t sourceHash = header.u64();
+    uint64_t sourceSize = header.u64();
+    uint64_t payloadSize = header.u64();
+    uint64_t payloadHash = header.u64();
+    std::string_view payload = bytes.substr(HEADER_SIZE);
+    // Another version, other source that happens to share the file name, or damage
+    if (version != VERSION || flags != (optimized ? OPTIMIZED : 0) || sourceSize != source.size() ||
+        sourceHash != hashBytes(source) || payloadSize != payload.size() || payloadHash != hashBytes(payload)) {
+        return false;
+    }
+
+    // Copied out of the mapping, which is unmapped when `entry` goes
+    Tree loaded;
+    if (!decode(payload, loaded)) {
+        return false;
+    }
+    tree = std::move(loaded);
+    return true;
+}
+
+void ProgramCache::store(std::string_view source, bool optimized, const Tree& tree) const {
+    if (!VERSIONED) {
+        return;
+    }
+    std::string payload = encode(tree);
+    Writer entry;
+    entry.bytes.append(MAGIC, sizeof(MAGIC));
+    entry.u64(VERSION);
+    entry.u32(optimized ? OPTIMIZED : 0);
+    entry.u64(hashBytes(source));
+    entry.u64(source.size());
+    entry.u64(payload.size());
+    entry.u64(hashBytes(payload));
+    entry.bytes += payload;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = entryPath(source, optimized);
+    // Unique per writer, so processes and threads storing the same entry do not collide
+    uint64_t unique = std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+        static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::string temporary = path + "." + std::to_string(unique) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(entry.bytes.data(), static_cast<std::streamsize>(entry.bytes.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
@@ -0,0 +1,209 @@
+#include "Resolver.hpp"
+#include <stdexcept>
+
+Resolver::Resolver() : tree(nullptr), loopDepth(0) {}
+
+void Resolver::resolve(Tree& program) {
+    symbols = SymbolTable();
+    symbols.addScope();
+    taskStarts.clear();
+    loopDepth = 0;
+    tree = &program;
+    
+    if (program.nodeCount() > 0) {
+        resolveStatement(program.root);
+    }
+    
+    program.frameSize = symbols.frameSize();
+    tree = nullptr;
+}
+
+void Resolver::resolve(Tree& program, NodeId statement) {
+    if (symbols.depth() == 0) {
+        symbols.addScope();
+    }
+    taskStarts.clear();
+    loopDepth = 0;
+    tree = &program;
+    
+    resolveStatement(statement);
+    
+    program.frameSize = symbols.frameSize();
+    tree = nullptr;
+}
+
+void Resolver::resolveStatement(NodeId node) {
+    switch (tree->kind(node)) {
+        case NodeKind::STMT:
+        case NodeKind::SUITE:
+            resolveStatements(node);
+            break;
+        case NodeKind::DECLARE_STMT:
+            resolveDeclare(node);
+            break;
+        case NodeKind::ASSIGNMENT_STMT:
+            resolveAssignment(node, false);
+            break;
+        case NodeKind::IF_STMT:
+            resolveIf(node);
+            break;
+        case NodeKind::WHILE_STMT:
+            resolveWhile(node);
+            break;
+        case NodeKind::FOR_STMT:
+            resolveFor(node);
+            break;
+        case NodeKind::SPAWN_STMT:
+            resolveSpawn(node);
+            break;
+        case NodeKind::FLOW_STMT:
+            if (!taskStarts.empty() && loopDepth == 0) {
+                throw std::runtime_error("Break or continue cannot leave a 🚀 block");
+            }
+            break;
+        case NodeKind::JOIN_STMT:
+            break;
+        default:
+            resolveExpression(node);
+            break;
+    }
+}
+
+void Resolver::resolveStatements(NodeId node) {
+    for (const Child& statement : tree->children(node)) {
+        resolveStatement(statement.index);
+    }
+}
+
+void Resolver::resolveDeclare(NodeId node) {
+    for (const Child& child : tree->children(node)) {
+        if (tree->kind(child.index) == NodeKind::ASSIGNMENT_STMT) {
+            resolveAssignment(child.index, true);
+        } else {
+            declare(child.index);
+        }
+    }
+}
+
+void Resolver::resolveAssignment(NodeId node, bool isDeclaration) {
+    auto children = tree->children(node);
+    
+    // The value is resolved first, so "📢 x 😌 x" reads an outer x
+    resolveExpression(children[1].index);
+    
+    if (isDeclaration) {
+        declare(children[0].index);
+    } else {
+        bind(children[0].index, "Assignment of undeclared variable '", "'");
+        if (!taskStarts.empty() && tree->payload(children[0].index) < taskStarts.back()) {
+            throw std::runtime_error("Assignment inside a 🚀 block to '" + nameOf(children[0].index) +
+                                     "', which is declared outside it and read-only there" +
+                                     position(children[0].index));
+        }
+    }
+}
+
+void Resolver::resolveIf(NodeId node) {
+    auto children = tree->children(node);
+    
+    size_t i = 0;
+    while (i < children.size()) {
+        std::string_view keyword = tree->leaf(children[i]).value;
+        bool isElse = keyword == "else" || keyword == "🏁";
+        
+        if (!isElse) {
+            resolveExpression(children[i + 1].index);
+        }
+        
+        symbols.addScope();
+        resolveStatements(children[i + (isElse ? 1 : 2)].index);
+        symbols.removeScope();
+        
+        i += isElse ? 2 : 3;
+    }
+}
+
+void Resolver::resolveWhile(NodeId node) {
+    auto children = tree->children(node);
+    
+    resolveExpression(children[0].index);
+    
+    symbols.addScope();
+    loopDepth++;
+    resolveStatements(children[1].index);
+    loopDepth--;
+    symbols.removeScope();
+}
+
+void Resolver::resolveFor(NodeId node) {
+    auto children = tree->children(node);
+    
+    symbols.addScope(); // for_decl variables
+    resolveStatements(children[0].index);
+    resolveStatements(children[1].index);
+    
+    symbols.addScope(); // loop body
+    loopDepth++;
+    resolveStatements(children[3].index);
+    loopDepth--;
+    symbols.removeScope();
+    
+    resolveStatements(children[2].index);
+    symbols.removeScope();
+}
+
+void Resolver::resolveSpawn(NodeId node) {
+    symbols.addScope();
+    taskStarts.push_back(symbols.scopeStart());
+    uint32_t outerLoops = loopDepth;
+    loopDepth = 0;
+    
+    resolveStatements(tree->children(node)[0].index);
+    
+    loopDepth = outerLoops;
+    taskStarts.pop_back();
+    symbols.removeScope();
+}
+
+void Resolver::resolveExpression(NodeId node) {
+    if (tree->kind(node) == NodeKind::NAME) {
+        bind(node, "'", "' is undeclared");
+        return;
+    }
+    
+    for (const Child& child : tree->children(node)) {
+        if (!child.isLeaf) {
+            resolveExpression(child.index);
+        }
+    }
+}
+
+void Resolver::declare(NodeId nameNode) {
+    std::string name = nameOf(nameNode);
+    if (symbols.isDeclaredInScope(name)) {
+        throw std::runtime_error("Redeclaration in same scope of '" + name + "'" + position(nameNode));
+    }
+    tree->setPayload(nameNode, symbols.addSymbol(name));
+}
+
+void Resolver::bind(NodeId nameNode, const std::string& errorPrefix, const std::string& errorSuffix) {
+    std::string name = nameOf(nameNode);
+    int32_t slot = symbols.getSlot(name);
+    if (slot == SymbolTable::NOT_FOUND) {
+        throw std::runtime_error(errorPrefix + name + errorSuffix + position(nameNode));
+    }
+    tree->setPayload(nameNode, static_cast<uint32_t>(slot));
+}
+
+std::string Resolver::nameOf(NodeId nameNode) const {
+    auto children = tree->children(nameNode);
+    return children.empty() ? std::string() : std::string(tree->leaf(children[0]).value);
+}
+
+std::string Resolver::position(NodeId nameNode) const {
+    auto children = tree->children(nameNode);
+    if (children.empty()) return "";
+    
+    const Leaf& token = tree->leaf(children[0]);
+    return " at line " + std::to_string(token.line) + ", column " + std::to_string(token.column);
+}
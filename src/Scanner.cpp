@@ -0,0 +1,626 @@
+#include "Scanner.hpp"
+#include <initializer_list>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EMOJILANG_HAVE_X86_SIMD 1
+#define EMOJILANG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+int utf8SequenceLength(const char* p, const char* end) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    size_t available = static_cast<size_t>(end - p);
+    if (available == 0) return 0;
+
+    unsigned char lead = s[0];
+    if (lead < 0x80) return 1;
+
+    int length;
+    unsigned char minSecond = 0x80;
+    unsigned char maxSecond = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) minSecond = 0xA0;      // overlong
+        if (lead == 0xED) maxSecond = 0x9F;      // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) minSecond = 0x90;      // overlong
+        if (lead == 0xF4) maxSecond = 0x8F;      // above U+10FFFF
+    } else {
+        return 0;
+    }
+
+    if (available < static_cast<size_t>(length)) return 0;
+    if (s[1] < minSecond || s[1] > maxSecond) return 0;
+    for (int i = 2; i < length; ++i) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+const char* validateUtf8(const char* p, const char* end) {
+    while (p < end) {
+        if (static_cast<unsigned char>(*p) < 0x80) {
+            ++p;
+            continue;
+        }
+        int length = utf8SequenceLength(p, end);
+        if (length == 0) return p;
+        p += length;
+    }
+    return nullptr;
+}
+
+namespace {
+
+inline bool isSpaceByte(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isIdentifierByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+inline bool isNumberByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || c == '.';
+}
+
+inline void noteNewlines(LinePosition& position, const char* chunk, uint32_t mask) {
+    if (mask == 0) return;
+    position.line += static_cast<uint32_t>(__builtin_popcount(mask));
+    position.lineStart = chunk + (31 - __builtin_clz(mask)) + 1;
+}
+
+// Runs between tokens are usually a byte or two long. The vector kernels settle
+// those with a short scalar probe before paying for a vector load.
+constexpr int PROBE_BYTES = 4;
+
+// ---------------------------------------------------------------------------
+// Scalar kernels; also used for the tails of the vector kernels.
+
+const char* scalarSkipWhitespace(const char* p, const char* end, LinePosition& position) {
+    while (p < end && isSpaceByte(static_cast<unsigned char>(*p))) {
+        if (*p == '\n') {
+            position.line++;
+            position.lineStart = p + 1;
+        }
+        ++p;
+    }
+    return p;
+}
+
+// The scalar and SSE2 "text" scanners below only record the first non-ASCII
+// byte they pass; validation then runs once over [firstHigh, stop) so
+// multi-byte sequences straddling a vector chunk boundary are judged as a
+// whole. The AVX2 scanners validate as they go instead.
+
+const char* scalarSkipToNewline(const char* p, const char* end, const char*& firstHigh) {
+    while (p < end && *p != '\n') {
+        if (!firstHigh && static_cast<unsigned char>(*p) >= 0x80) firstHigh = p;
+        ++p;
+    }
+    return p;
+}
+
+const char* scalarFindQuote(const char* p, const char* end, LinePosition& position, const char*& firstHigh) {
+    while (p < end && *p != '"') {
+        if (*p == '\n') {
+            position.line++;
+            position.lineStart = p + 1;
+        } else if (!firstHigh && static_cast<unsigned char>(*p) >= 0x80) {
+            firstHigh = p;
+        }
+        ++p;
+    }
+    return p;
+}
+
+const char* scalarScanIdentifier(const char* p, const char* end) {
+    while (p < end && isIdentifierByte(static_cast<unsigned char>(*p))) ++p;
+    return p;
+}
+
+const char* scalarScanNumber(const char* p, const char* end) {
+    while (p < end && isNumberByte(static_cast<unsigned char>(*p))) ++p;
+    return p;
+}
+
+#ifdef EMOJILANG_HAVE_X86_SIMD
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels (baseline on x86-64), 16 bytes per step.
+
+namespace sse2 {
+
+constexpr int WIDTH = 16;
+
+inline __m128i load(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline uint32_t movemask(__m128i v) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+inline uint32_t equalMask(__m128i v, char c) {
+    return movemask(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+// Bytes with lo <= v <= hi (unsigned), via wrapping subtract + saturating subtract.
+inline __m128i inRange(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    __m128i over = _mm_subs_epu8(shifted, _mm_set1_epi8(static_cast<char>(hi - lo)));
+    return _mm_cmpeq_epi8(over, _mm_setzero_si128());
+}
+
+inline uint32_t spaceMask(__m128i v) {
+    return movemask(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange(v, '\t', '\r')));
+}
+
+inline uint32_t identifierMask(__m128i v) {
+    __m128i letter = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i digit = inRange(v, '0', '9');
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return movemask(_mm_or_si128(_mm_or_si128(letter, digit), underscore));
+}
+
+inline uint32_t numberMask(__m128i v) {
+    return movemask(_mm_or_si128(inRange(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))));
+}
+
+const char* skipWhitespace(const char* p, const char* end, LinePosition& position) {
+    constexpr uint32_t all = (1u << WIDTH) - 1;
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isSpaceByte(static_cast<unsigned char>(*p))) return p;
+        if (*p == '\n') {
+            position.line++;
+            position.lineStart = p + 1;
+        }
+    }
+    while (end - p >= WIDTH) {
+        __m128i v = load(p);
+        uint32_t spaces = spaceMask(v);
+        uint32_t newlines = equalMask(v, '\n');
+        if (spaces == all) {
+            noteNewlines(position, p, newlines);
+            p += WIDTH;
+            continue;
+        }
+        int run = __builtin_ctz(~spaces);
+        noteNewlines(position, p, newlines & ((1u << run) - 1));
+        return p + run;
+    }
+    return scalarSkipWhitespace(p, end, position);
+}
+
+const char* skipToNewline(const char* p, const char* end, const char*& firstHigh) {
+    while (end - p >= WIDTH) {
+        __m128i v = load(p);
+        uint32_t newlines = equalMask(v, '\n');
+        uint32_t high = movemask(v);
+        if (newlines) {
+            int stop = __builtin_ctz(newlines);
+            high &= (1u << stop) - 1;
+            if (!firstHigh && high) firstHigh = p + __builtin_ctz(high);
+            return p + stop;
+        }
+        if (!firstHigh && high) firstHigh = p + __builtin_ctz(high);
+        p += WIDTH;
+    }
+    return scalarSkipToNewline(p, end, firstHigh);
+}
+
+const char* findQuote(const char* p, const char* end, LinePosition& position, const char*& firstHigh) {
+    while (end - p >= WIDTH) {
+        __m128i v = load(p);
+        uint32_t quotes = equalMask(v, '"');
+        uint32_t newlines = equalMask(v, '\n');
+        uint32_t high = movemask(v);
+        if (quotes) {
+            int stop = __builtin_ctz(quotes);
+            uint32_t before = (1u << stop) - 1;
+            noteNewlines(position, p, newlines & before);
+            high &= before;
+            if (!firstHigh && high) firstHigh = p + __builtin_ctz(high);
+            return p + stop;
+        }
+        noteNewlines(position, p, newlines);
+        if (!firstHigh && high) firstHigh = p + __builtin_ctz(high);
+        p += WIDTH;
+    }
+    return scalarFindQuote(p, end, position, firstHigh);
+}
+
+const char* scanIdentifier(const char* p, const char* end) {
+    constexpr uint32_t all = (1u << WIDTH) - 1;
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isIdentifierByte(static_cast<unsigned char>(*p))) return p;
+    }
+    while (end - p >= WIDTH) {
+        uint32_t mask = identifierMask(load(p));
+        if (mask != all) return p + __builtin_ctz(~mask);
+        p += WIDTH;
+    }
+    return scalarScanIdentifier(p, end);
+}
+
+const char* scanNumber(const char* p, const char* end) {
+    constexpr uint32_t all = (1u << WIDTH) - 1;
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isNumberByte(static_cast<unsigned char>(*p))) return p;
+    }
+    while (end - p >= WIDTH) {
+        uint32_t mask = numberMask(load(p));
+        if (mask != all) return p + __builtin_ctz(~mask);
+        p += WIDTH;
+    }
+    return scalarScanNumber(p, end);
+}
+
+} // namespace sse2
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels, 32 bytes per step. Only called after a runtime CPU check.
+
+namespace avx2 {
+
+constexpr int WIDTH = 32;
+
+EMOJILANG_TARGET_AVX2 inline __m256i load(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+EMOJILANG_TARGET_AVX2 inline uint32_t movemask(__m256i v) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+EMOJILANG_TARGET_AVX2 inline uint32_t equalMask(__m256i v, char c) {
+    return movemask(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+EMOJILANG_TARGET_AVX2 inline __m256i inRange(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    __m256i over = _mm256_subs_epu8(shifted, _mm256_set1_epi8(static_cast<char>(hi - lo)));
+    return _mm256_cmpeq_epi8(over, _mm256_setzero_si256());
+}
+
+EMOJILANG_TARGET_AVX2 inline uint32_t spaceMask(__m256i v) {
+    return movemask(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange(v, '\t', '\r')));
+}
+
+EMOJILANG_TARGET_AVX2 inline uint32_t identifierMask(__m256i v) {
+    __m256i letter = inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i digit = inRange(v, '0', '9');
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return movemask(_mm256_or_si256(_mm256_or_si256(letter, digit), underscore));
+}
+
+EMOJILANG_TARGET_AVX2 inline uint32_t numberMask(__m256i v) {
+    return movemask(_mm256_or_si256(inRange(v, '0', '9'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'))));
+}
+
+// Mask of the bits strictly below `bit` (bit may be 0..31).
+inline uint32_t below(int bit) {
+    return bit == 0 ? 0u : (~0u >> (32 - bit));
+}
+
+EMOJILANG_TARGET_AVX2 const char* skipWhitespace(const char* p, const char* end, LinePosition& position) {
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isSpaceByte(static_cast<unsigned char>(*p))) return p;
+        if (*p == '\n') {
+            position.line++;
+            position.lineStart = p + 1;
+        }
+    }
+    while (end - p >= WIDTH) {
+        __m256i v = load(p);
+        uint32_t spaces = spaceMask(v);
+        uint32_t newlines = equalMask(v, '\n');
+        if (spaces == ~0u) {
+            noteNewlines(position, p, newlines);
+            p += WIDTH;
+            continue;
+        }
+        int run = __builtin_ctz(~spaces);
+        noteNewlines(position, p, newlines & below(run));
+        return p + run;
+    }
+    return sse2::skipWhitespace(p, end, position);
+}
+
+EMOJILANG_TARGET_AVX2 const char* scanIdentifier(const char* p, const char* end) {
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isIdentifierByte(static_cast<unsigned char>(*p))) return p;
+    }
+    while (end - p >= WIDTH) {
+        uint32_t mask = identifierMask(load(p));
+        if (mask != ~0u) return p + __builtin_ctz(~mask);
+        p += WIDTH;
+    }
+    return sse2::scanIdentifier(p, end);
+}
+
+EMOJILANG_TARGET_AVX2 const char* scanNumber(const char* p, const char* end) {
+    for (int i = 0; i < PROBE_BYTES; ++i, ++p) {
+        if (p == end || !isNumberByte(static_cast<unsigned char>(*p))) return p;
+    }
+    while (end - p >= WIDTH) {
+        uint32_t mask = numberMask(load(p));
+        if (mask != ~0u) return p + __builtin_ctz(~mask);
+        p += WIDTH;
+    }
+    return sse2::scanNumber(p, end);
+}
+
+// UTF-8 validation after Keiser & Lemire, "Validating UTF-8 In Less Than One
+// Instruction Per Byte" (2021): classify each byte pair with three nibble
+// lookups and check the 3rd/4th continuation bytes with saturating compares.
+// It runs inside the comment and string scans, on the blocks they load
+// anyway, rather than as a second pass over the text.
+
+constexpr uint8_t TOO_SHORT = 1 << 0;
+constexpr uint8_t TOO_LONG = 1 << 1;
+constexpr uint8_t OVERLONG_3 = 1 << 2;
+constexpr uint8_t TOO_LARGE = 1 << 3;
+constexpr uint8_t SURROGATE = 1 << 4;
+constexpr uint8_t OVERLONG_2 = 1 << 5;
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6;
+constexpr uint8_t TWO_CONTS = 1 << 7;
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+EMOJILANG_TARGET_AVX2 inline __m256i table16(uint8_t t0, uint8_t t1, uint8_t t2, uint8_t t3,
+                                             uint8_t t4, uint8_t t5, uint8_t t6, uint8_t t7,
+                                             uint8_t t8, uint8_t t9, uint8_t t10, uint8_t t11,
+                                             uint8_t t12, uint8_t t13, uint8_t t14, uint8_t t15) {
+    return _mm256_setr_epi8(
+        static_cast<char>(t0), static_cast<char>(t1), static_cast<char>(t2), static_cast<char>(t3),
+        static_cast<char>(t4), static_cast<char>(t5), static_cast<char>(t6), static_cast<char>(t7),
+        static_cast<char>(t8), static_cast<char>(t9), static_cast<char>(t10), static_cast<char>(t11),
+        static_cast<char>(t12), static_cast<char>(t13), static_cast<char>(t14), static_cast<char>(t15),
+        static_cast<char>(t0), static_cast<char>(t1), static_cast<char>(t2), static_cast<char>(t3),
+        static_cast<char>(t4), static_cast<char>(t5), static_cast<char>(t6), static_cast<char>(t7),
+        static_cast<char>(t8), static_cast<char>(t9), static_cast<char>(t10), static_cast<char>(t11),
+        static_cast<char>(t12), static_cast<char>(t13), static_cast<char>(t14), static_cast<char>(t15));
+}
+
+// Bytes of `input` shifted right by N positions, pulling in the tail of `previous`.
+template <int N>
+EMOJILANG_TARGET_AVX2 inline __m256i previousBytes(__m256i input, __m256i previous) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+EMOJILANG_TARGET_AVX2 inline __m256i nibbleHigh(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+EMOJILANG_TARGET_AVX2 inline __m256i utf8Errors(__m256i input, __m256i previous) {
+    __m256i prev1 = previousBytes<1>(input, previous);
+    __m256i byte1High = _mm256_shuffle_epi8(table16(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4), nibbleHigh(prev1));
+    __m256i byte1Low = _mm256_shuffle_epi8(table16(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)));
+    __m256i byte2High = _mm256_shuffle_epi8(table16(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT), nibbleHigh(input));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+    
+    __m256i prev2 = previousBytes<2>(input, previous);
+    __m256i prev3 = previousBytes<3>(input, previous);
+    __m256i thirdByte = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 1)));
+    __m256i fourthByte = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 1)));
+    __m256i must23 = _mm256_cmpgt_epi8(_mm256_or_si256(thirdByte, fourthByte), _mm256_setzero_si256());
+    __m256i must23Marker = _mm256_and_si256(must23, _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must23Marker, special);
+}
+
+// The last, partial block at p, padded with zeros.
+EMOJILANG_TARGET_AVX2 inline __m256i loadPadded(const char* p, const char* end) {
+    alignas(32) char tail[WIDTH] = {};
+    for (int i = 0; p + i < end; ++i) tail[i] = p[i];
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+}
+
+// The first `length` bytes of v, the rest cleared so they read as ASCII.
+EMOJILANG_TARGET_AVX2 inline __m256i firstBytes(__m256i v, int length) {
+    const __m256i index = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                           16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    return _mm256_and_si256(v, _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(length)), index));
+}
+
+// Error state of the validation fused into the text scanners below. Blocks
+// before the first one with a non-ASCII byte are not checked: they can
+// neither be malformed nor leave a sequence open for the next block.
+struct Utf8Check {
+    __m256i previous;
+    __m256i error;
+    bool started;
+};
+
+// Checks the first `length` bytes of a block the scan passed over.
+EMOJILANG_TARGET_AVX2 inline void checkBlock(Utf8Check& check, __m256i v, int length) {
+    if (!check.started) {
+        if ((movemask(v) & below(length)) == 0) return;
+        check.started = true;
+    }
+    __m256i input = length < WIDTH ? firstBytes(v, length) : v;
+    check.error = _mm256_or_si256(check.error, utf8Errors(input, check.previous));
+    check.previous = input;
+}
+
+// First malformed byte of [start, stop), which the scan checked block by block.
+EMOJILANG_TARGET_AVX2 inline const char* checkedResult(Utf8Check& check, const char* start, const char* stop) {
+    if (!check.started) return nullptr;
+    // A zero block flushes sequences left incomplete at the stop
+    __m256i error = _mm256_or_si256(check.error, utf8Errors(_mm256_setzero_si256(), check.previous));
+    if (_mm256_testz_si256(error, error)) return nullptr;
+    return ::validateUtf8(start, stop); // locate the offending byte on the error path
+}
+
+EMOJILANG_TARGET_AVX2 const char* validatedSkipToNewline(const char* p, const char* end, const char*& invalidUtf8) {
+    const char* start = p;
+    Utf8Check check{_mm256_setzero_si256(), _mm256_setzero_si256(), false};
+    bool found = false;
+    while (!found && end - p >= WIDTH) {
+        __m256i v = load(p);
+        uint32_t newlines = equalMask(v, '\n');
+        int run = newlines ? __builtin_ctz(newlines) : WIDTH;
+        checkBlock(check, v, run);
+        p += run;
+        found = newlines != 0;
+    }
+    if (!found && p < end) {
+        __m256i v = loadPadded(p, end);
+        uint32_t newlines = equalMask(v, '\n');
+        int run = newlines ? __builtin_ctz(newlines) : static_cast<int>(end - p);
+        checkBlock(check, v, run);
+        p += run;
+    }
+    if (!invalidUtf8) invalidUtf8 = checkedResult(check, start, p);
+    return p;
+}
+
+EMOJILANG_TARGET_AVX2 const char* validatedFindQuote(const char* p, const char* end, LinePosition& position,
+                                                     const char*& invalidUtf8) {
+    const char* start = p;
+    Utf8Check check{_mm256_setzero_si256(), _mm256_setzero_si256(), false};
+    bool found = false;
+    while (!found && end - p >= WIDTH) {
+        __m256i v = load(p);
+        uint32_t quotes = equalMask(v, '"');
+        int run = quotes ? __builtin_ctz(quotes) : WIDTH;
+        noteNewlines(position, p, equalMask(v, '\n') & below(run));
+        checkBlock(check, v, run);
+        p += run;
+        found = quotes != 0;
+    }
+    if (!found && p < end) {
+        __m256i v = loadPadded(p, end);
+        uint32_t quotes = equalMask(v, '"');
+        int run = quotes ? __builtin_ctz(quotes) : static_cast<int>(end - p);
+        noteNewlines(position, p, equalMask(v, '\n') & below(run));
+        checkBlock(check, v, run);
+        p += run;
+    }
+    if (!invalidUtf8) invalidUtf8 = checkedResult(check, start, p);
+    return p;
+}
+
+} // namespace avx2
+
+#endif // EMOJILANG_HAVE_X86_SIMD
+
+using TextScan = const char* (*)(const char*, const char*, const char*&);
+using QuoteScan = const char* (*)(const char*, const char*, LinePosition&, const char*&);
+using Validate = const char* (*)(const char*, const char*);
+
+template <TextScan Scan, Validate Check>
+const char* validatedSkipToNewline(const char* p, const char* end, const char*& invalidUtf8) {
+    const char* firstHigh = nullptr;
+    const char* stop = Scan(p, end, firstHigh);
+    if (firstHigh && !invalidUtf8) invalidUtf8 = Check(firstHigh, stop);
+    return stop;
+}
+
+template <QuoteScan Scan, Validate Check>
+const char* validatedFindQuote(const char* p, const char* end, LinePosition& position, const char*& invalidUtf8) {
+    const char* firstHigh = nullptr;
+    const char* stop = Scan(p, end, position, firstHigh);
+    if (firstHigh && !invalidUtf8) invalidUtf8 = Check(firstHigh, stop);
+    return stop;
+}
+
+const ScanKernels SCALAR_KERNELS{
+    ScanLevel::SCALAR, "scalar",
+    scalarSkipWhitespace,
+    validatedSkipToNewline<scalarSkipToNewline, validateUtf8>,
+    validatedFindQuote<scalarFindQuote, validateUtf8>,
+    scalarScanIdentifier,
+    scalarScanNumber
+};
+
+#ifdef EMOJILANG_HAVE_X86_SIMD
+const ScanKernels SSE2_KERNELS{
+    ScanLevel::SSE2, "sse2",
+    sse2::skipWhitespace,
+    validatedSkipToNewline<sse2::skipToNewline, validateUtf8>,
+    validatedFindQuote<sse2::findQuote, validateUtf8>,
+    sse2::scanIdentifier,
+    sse2::scanNumber
+};
+
+const ScanKernels AVX2_KERNELS{
+    ScanLevel::AVX2, "avx2",
+    avx2::skipWhitespace,
+    avx2::validatedSkipToNewline,
+    avx2::validatedFindQuote,
+    avx2::scanIdentifier,
+    avx2::scanNumber
+};
+
+bool cpuHasSse2() {
+#if defined(__x86_64__) || defined(__SSE2__)
+    return true;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool cpuHasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+} // namespace
+
+const ScanKernels* ScanKernels::forLevel(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::SCALAR:
+            return &SCALAR_KERNELS;
+#ifdef EMOJILANG_HAVE_X86_SIMD
+        case ScanLevel::SSE2:
+            return cpuHasSse2() ? &SSE2_KERNELS : nullptr;
+        case ScanLevel::AVX2:
+            return cpuHasAvx2() ? &AVX2_KERNELS : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const ScanKernels& ScanKernels::best() {
+    static const ScanKernels* const chosen = [] {
+        for (ScanLevel level : {ScanLevel::AVX2, ScanLevel::SSE2}) {
+            if (const ScanKernels* kernels = forLevel(level)) return kernels;
+        }
+        return &SCALAR_KERNELS;
+    }();
+    return *chosen;
+}
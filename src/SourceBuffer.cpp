@@ -0,0 +1,105 @@
+#include "SourceBuffer.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EMOJILANG_HAVE_MMAP 1
+#endif
+
+SourceBuffer::SourceBuffer() : data(""), length(0), isMapped(false) {}
+
+SourceBuffer::SourceBuffer(std::string text) : data(nullptr), length(0), isMapped(false), owned(std::move(text)) {
+    data = owned.data();
+    length = owned.size();
+}
+
+SourceBuffer::~SourceBuffer() {
+    release();
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : data(other.data), length(other.length), isMapped(other.isMapped), owned(std::move(other.owned)) {
+    if (!isMapped) {
+        data = owned.data();
+    }
+    other.data = "";
+    other.length = 0;
+    other.isMapped = false;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        length = other.length;
+        isMapped = other.isMapped;
+        owned = std::move(other.owned);
+        data = isMapped ? other.data : owned.data();
+        other.data = "";
+        other.length = 0;
+        other.isMapped = false;
+    }
+    return *this;
+}
+
+SourceBuffer SourceBuffer::fromFile(const std::string& path) {
+#ifdef EMOJILANG_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open '" + path + "'");
+    }
+    
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat '" + path + "'");
+    }
+    
+    SourceBuffer buffer;
+    if (st.st_size > 0) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map '" + path + "'");
+        }
+        ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        buffer.data = static_cast<const char*>(mapping);
+        buffer.length = static_cast<size_t>(st.st_size);
+        buffer.isMapped = true;
+    }
+    ::close(fd);
+    return buffer;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open '" + path + "'");
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return SourceBuffer(contents.str());
+#endif
+}
+
+std::string_view SourceBuffer::text() const {
+    return std::string_view(data, length);
+}
+
+size_t SourceBuffer::size() const {
+    return length;
+}
+
+void SourceBuffer::release() {
+#ifdef EMOJILANG_HAVE_MMAP
+    if (isMapped) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+#endif
+    isMapped = false;
+    data = "";
+    length = 0;
+}
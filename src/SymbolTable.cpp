@@ -1,7 +1,7 @@
 #include "SymbolTable.hpp"
 #include <stdexcept>
 
-SymbolTable::SymbolTable(bool debug) : isDebug(debug) {}
+SymbolTable::SymbolTable(bool debug) : nextSlot(0), slotCount(0), isDebug(debug) {}
 
 void SymbolTable::debugSymbolTable() const {
     if (!isDebug) return;
@@ -9,62 +9,71 @@ void SymbolTable::debugSymbolTable() const {
     std::cout << "Symbol Table Debug:\n";
     for (size_t i = 0; i < table.size(); ++i) {
         std::cout << "Scope " << i << ": ";
-        for (const auto& pair : table[i]) {
-            std::cout << pair.first << " ";
+        for (const auto& pair : table[i].symbols) {
+            std::cout << pair.first << "@" << pair.second << " ";
         }
         std::cout << "\n";
     }
 }
 
 void SymbolTable::addScope() {
-    table.emplace_back();
+    table.push_back(Scope{{}, nextSlot});
 }
 
-void SymbolTable::addSymbol(const std::string& symbol, const Value& value) {
+uint32_t SymbolTable::addSymbol(const std::string& symbol) {
     if (table.empty()) {
         throw std::runtime_error("No scope available to add symbol");
     }
     
-    if (table.back().find(symbol) != table.back().end()) {
+    if (isDeclaredInScope(symbol)) {
         throw std::runtime_error("Redeclaration in same scope of '" + symbol + "'");
     }
     
-    // Initialize with default value if none provided
-    if (std::holds_alternative<std::monostate>(value)) {
-        table.back()[symbol] = Value(0);
-    } else {
-        table.back()[symbol] = value;
+    uint32_t slot = nextSlot++;
+    if (nextSlot > slotCount) {
+        slotCount = nextSlot;
     }
+    table.back().symbols.emplace(symbol, slot);
+    return slot;
+}
+
+bool SymbolTable::isDeclaredInScope(const std::string& symbol) const {
+    return !table.empty() && table.back().symbols.find(symbol) != table.back().symbols.end();
 }
 
 int SymbolTable::doesSymbolExist(const std::string& symbol) const {
     for (int i = static_cast<int>(table.size()) - 1; i >= 0; --i) {
-        if (table[i].find(symbol) != table[i].end()) {
+        if (table[i].symbols.find(symbol) != table[i].symbols.end()) {
             return i;
         }
     }
     return -1;
 }
 
-void SymbolTable::updateSymbol(const std::string& symbol, const Value& value) {
-    int tableId = doesSymbolExist(symbol);
-    if (tableId == -1) {
-        throw std::runtime_error("Assignment of undeclared variable '" + symbol + "'");
-    }
-    table[tableId][symbol] = value;
-}
-
-Value SymbolTable::getValue(const std::string& symbol) const {
+int32_t SymbolTable::getSlot(const std::string& symbol) const {
     int tableId = doesSymbolExist(symbol);
     if (tableId == -1) {
-        throw std::runtime_error("'" + symbol + "' is undeclared");
+        return NOT_FOUND;
     }
-    return table[tableId].at(symbol);
+    return static_cast<int32_t>(table[tableId].symbols.at(symbol));
 }
 
 void SymbolTable::removeScope() {
     if (table.empty()) {
         throw std::runtime_error("Internal exception: No scope to remove");
     }
+    nextSlot = table.back().firstSlot;
     table.pop_back();
 }
+
+uint32_t SymbolTable::scopeStart() const {
+    return table.empty() ? 0 : table.back().firstSlot;
+}
+
+uint32_t SymbolTable::frameSize() const {
+    return slotCount;
+}
+
+size_t SymbolTable::depth() const {
+    return table.size();
+}
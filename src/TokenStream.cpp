@@ -0,0 +1,111 @@
+#include "TokenStream.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Offset of the first byte of the line a token sits on.
+size_t lineStartOf(const LexToken& token) {
+    return token.offset + 1 - token.column;
+}
+
+} // namespace
+
+TokenStream::TokenStream(std::string_view source)
+    : input(nullptr), chunkSize(0), window(source), inputDone(true), lexer(source),
+      ring{}, head(0), count(0), previous{0, 0, 1, 1, TokenType::END_OF_FILE} {}
+
+TokenStream::TokenStream(std::istream& input, size_t chunkSize)
+    : input(&input), chunkSize(std::max<size_t>(chunkSize, 1)), inputDone(false), lexer(std::string_view()),
+      ring{}, head(0), count(0), previous{0, 0, 1, 1, TokenType::END_OF_FILE} {
+    refill(LexerState{0, 1, 0});
+}
+
+const LexToken& TokenStream::peek(size_t ahead) {
+    if (ahead >= LOOKAHEAD) {
+        throw std::logic_error("TokenStream lookahead exceeded");
+    }
+    while (count <= ahead) {
+        // END_OF_FILE repeats forever once reached
+        if (count > 0 && ring[(head + count - 1) % LOOKAHEAD].type == TokenType::END_OF_FILE) {
+            return ring[(head + count - 1) % LOOKAHEAD];
+        }
+        ring[(head + count) % LOOKAHEAD] = lexOne();
+        count++;
+    }
+    return ring[(head + ahead) % LOOKAHEAD];
+}
+
+LexToken TokenStream::advance() {
+    const LexToken& token = peek();
+    if (token.type == TokenType::END_OF_FILE) return token;
+    previous = token;
+    head = (head + 1) % LOOKAHEAD;
+    count--;
+    return previous;
+}
+
+std::string_view TokenStream::text(const LexToken& token) const {
+    return token.text(window);
+}
+
+LexToken TokenStream::lexOne() {
+    while (true) {
+        LexToken token = lexer.next();
+        if (inputDone) return token;
+        
+        if (token.type == TokenType::END_OF_FILE) {
+            refill(lexer.state());
+        } else if (token.type == TokenType::STRING && lexer.truncated()) {
+            // Re-lex the literal from its opening quote once more text is in
+            refill(LexerState{token.offset - 1, token.line, lineStartOf(token)});
+        } else {
+            return token;
+        }
+    }
+}
+
+void TokenStream::refill(LexerState resume) {
+    // Keep the lines of every token that may still be looked at, so their
+    // offsets and columns stay meaningful after the shift
+    size_t keepFrom = std::min(resume.lineStart, lineStartOf(previous));
+    for (size_t i = 0; i < count; ++i) {
+        keepFrom = std::min(keepFrom, lineStartOf(ring[(head + i) % LOOKAHEAD]));
+    }
+    keepFrom = std::min(keepFrom, buffer.size());
+    
+    buffer.erase(0, keepFrom);
+    for (size_t i = 0; i < count; ++i) {
+        ring[(head + i) % LOOKAHEAD].offset -= static_cast<uint32_t>(keepFrom);
+    }
+    previous.offset = previous.offset >= keepFrom ? previous.offset - static_cast<uint32_t>(keepFrom) : 0;
+    resume.pos -= keepFrom;
+    resume.lineStart -= keepFrom;
+    
+    // Read until the new text contains a line break (or the input ends)
+    size_t lexEnd = buffer.size();
+    while (true) {
+        size_t oldSize = buffer.size();
+        buffer.resize(oldSize + chunkSize);
+        input->read(&buffer[oldSize], static_cast<std::streamsize>(chunkSize));
+        buffer.resize(oldSize + static_cast<size_t>(input->gcount()));
+        
+        if (!*input) {
+            if (!input->eof()) {
+                throw std::runtime_error("Error while reading program text");
+            }
+            inputDone = true;
+            lexEnd = buffer.size();
+            break;
+        }
+        
+        size_t newline = buffer.rfind('\n');
+        if (newline != std::string::npos && newline >= oldSize) {
+            lexEnd = newline + 1;
+            break;
+        }
+    }
+    
+    window = std::string_view(buffer.data(), lexEnd);
+    lexer = Lexer(window, resume);
+}
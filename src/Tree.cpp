@@ -1,60 +1,110 @@
 #include "Tree.hpp"
-#include <sstream>
 
-Tree::Tree(const std::string& data_name) : data(data_name) {}
+const char* nodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::STMT: return "stmt";
+        case NodeKind::SUITE: return "suite";
+        case NodeKind::DECLARE_STMT: return "declare_stmt";
+        case NodeKind::ASSIGNMENT_STMT: return "assignment_stmt";
+        case NodeKind::PRINT_STMT: return "print_stmt";
+        case NodeKind::IF_STMT: return "if_stmt";
+        case NodeKind::WHILE_STMT: return "while_stmt";
+        case NodeKind::FOR_STMT: return "for_stmt";
+        case NodeKind::FOR_DECL: return "for_decl";
+        case NodeKind::FOR_TEST: return "for_test";
+        case NodeKind::FOR_UPDATES: return "for_updates";
+        case NodeKind::FLOW_STMT: return "flow_stmt";
+        case NodeKind::BREAK_STMT: return "break_stmt";
+        case NodeKind::CONTINUE_STMT: return "continue_stmt";
+        case NodeKind::SPAWN_STMT: return "spawn_stmt";
+        case NodeKind::JOIN_STMT: return "join_stmt";
+        case NodeKind::NAME: return "name";
+        case NodeKind::NUMBER: return "number";
+        case NodeKind::STRING: return "string";
+        case NodeKind::BOOLEAN: return "boolean";
+        case NodeKind::CONSTANT: return "constant";
+        case NodeKind::CASTEXPRESSION: return "castexpression";
+        case NodeKind::MULTIPLICATIVEEXPRESSION: return "multiplicativeexpression";
+        case NodeKind::ADDITIVEEXPRESSION: return "additiveexpression";
+        case NodeKind::EQUALITYEXPRESSION: return "equalityexpression";
+        case NodeKind::ANDEXPRESSION: return "andexpression";
+        case NodeKind::EXCLUSIVEOREXPRESSION: return "exclusiveorexpression";
+        case NodeKind::INCLUSIVEOREXPRESSION: return "inclusiveorexpression";
+        case NodeKind::LOGICALANDEXPRESSION: return "logicalandexpression";
+        case NodeKind::LOGICALOREXPRESSION: return "logicalorexpression";
+        case NodeKind::EXP: return "exp";
+    }
+    return "?";
+}
 
-Tree::Tree(const std::string& data_name, std::vector<TreeNode> child_nodes) 
-    : data(data_name), children(std::move(child_nodes)) {}
+Tree::Tree() : root(0), frameSize(0) {}
 
-void Tree::addChild(TreeNode child) {
-    children.push_back(child);
+NodeId Tree::addNode(NodeKind kind, std::initializer_list<Child> children) {
+    return addNode(kind, children.begin(), children.size());
 }
 
-void Tree::addChild(const std::string& token_value) {
-    auto token = std::make_shared<Token>(TokenType::STRING, token_value);
-    children.push_back(token);
+NodeId Tree::addNode(NodeKind kind, const Child* children, size_t count) {
+    Node node{kind, static_cast<uint32_t>(childSlots.size()), static_cast<uint32_t>(count), 0};
+    childSlots.insert(childSlots.end(), children, children + count);
+    nodes.push_back(node);
+    return static_cast<NodeId>(nodes.size() - 1);
 }
 
-void Tree::addChild(TokenPtr token) {
-    children.push_back(token);
+void Tree::replace(NodeId node, NodeKind kind, std::initializer_list<Child> children) {
+    replace(node, kind, children.begin(), children.size());
 }
 
-void Tree::addChild(TreePtr tree) {
-    children.push_back(tree);
+void Tree::replace(NodeId node, NodeKind kind, const Child* children, size_t count) {
+    // `children` may point into childSlots itself, so copy it out before growing
+    std::vector<Child> copy(children, children + count);
+    nodes[node].kind = kind;
+    nodes[node].firstChild = static_cast<uint32_t>(childSlots.size());
+    nodes[node].childCount = static_cast<uint32_t>(count);
+    childSlots.insert(childSlots.end(), copy.begin(), copy.end());
 }
 
-std::string Tree::pretty(int indent) const {
-    std::stringstream ss;
-    std::string indentStr(indent * 2, ' ');
-    ss << indentStr << data << "\n";
-    
-    for (const auto& child : children) {
-        ss << prettyNode(child, indent + 1);
-    }
-    
-    return ss.str();
+Child Tree::addLeaf(TokenType type, std::string_view value, uint32_t line, uint32_t column) {
+    leaves.push_back(Leaf{strings.store(value), type, line, column});
+    return Child{static_cast<uint32_t>(leaves.size() - 1), true};
 }
 
-std::string Tree::prettyNode(const TreeNode& node, int indent) const {
-    std::string indentStr(indent * 2, ' ');
-    
-    if (std::holds_alternative<TreePtr>(node)) {
-        return std::get<TreePtr>(node)->pretty(indent);
-    } else if (std::holds_alternative<TokenPtr>(node)) {
-        return indentStr + std::get<TokenPtr>(node)->value + "\n";
-    }
-    
-    return "";
+void Tree::clear() {
+    root = 0;
+    frameSize = 0;
+    constants.clear();
+    nodes.clear();
+    childSlots.clear();
+    leaves.clear();
+    strings.clear();
 }
 
-size_t Tree::size() const {
-    return children.size();
+std::string Tree::pretty(int indent) const {
+    if (nodes.empty()) return "";
+    return pretty(root, indent);
 }
 
-TreeNode& Tree::operator[](size_t index) {
-    return children[index];
+std::string Tree::pretty(NodeId node, int indent) const {
+    std::string out;
+    prettyNode(out, nodeChild(node), indent);
+    return out;
 }
 
-const TreeNode& Tree::operator[](size_t index) const {
-    return children[index];
+void Tree::prettyNode(std::string& out, Child child, int indent) const {
+    out.append(indent * 2, ' ');
+
+    if (child.isLeaf) {
+        out += leaf(child).value;
+        out += '\n';
+        return;
+    }
+
+    out += nodeKindName(kind(child.index));
+    if (kind(child.index) == NodeKind::CONSTANT) {
+        out += ' ';
+        out += constants[payload(child.index)].toString();
+    }
+    out += '\n';
+    for (const Child& grandchild : children(child.index)) {
+        prettyNode(out, grandchild, indent + 1);
+    }
 }
@@ -0,0 +1,118 @@
+#include "Value.hpp"
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <stdexcept>
+
+StringData* StringData::create(std::string_view text) {
+    void* memory = ::operator new(sizeof(StringData) + text.size());
+    StringData* data = new (memory) StringData{{1}, static_cast<uint32_t>(text.size())};
+    std::memcpy(const_cast<char*>(data->chars()), text.data(), text.size());
+    return data;
+}
+
+void StringData::release() {
+    if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->~StringData();
+        ::operator delete(this);
+    }
+}
+
+size_t Value::tagOffset() {
+    return offsetof(Value, tag);
+}
+
+size_t Value::payloadOffset() {
+    return offsetof(Value, data);
+}
+
+std::string Value::toString() const {
+    switch (tag) {
+        case Type::NONE: return "0";
+        case Type::INT: return std::to_string(data.integer);
+        case Type::DOUBLE: return std::to_string(data.real);
+        case Type::BOOL: return data.boolean ? "true" : "false";
+        case Type::STRING: return std::string(asString());
+    }
+    return "";
+}
+
+double Value::stringToDouble() const {
+    try {
+        return std::stod(std::string(asString()));
+    } catch (const std::exception&) {
+        return 0.0;
+    }
+}
+
+bool Value::stringToBool() const {
+    std::string_view str = asString();
+    return !str.empty() && str != "false" && str != "0";
+}
+
+int Value::stringToInt() const {
+    try {
+        return std::stoi(std::string(asString()));
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+CompareOp compareOpFromText(std::string_view op) {
+    if (op == "==" || op == "😌😌") return CompareOp::EQ;
+    if (op == "!=" || op == "❗😌") return CompareOp::NE;
+    if (op == "<" || op == "😭") return CompareOp::LT;
+    if (op == "<=" || op == "😭😌") return CompareOp::LE;
+    if (op == ">" || op == "😁") return CompareOp::GT;
+    if (op == ">=" || op == "😁😌") return CompareOp::GE;
+    throw std::runtime_error("Unknown comparison operator '" + std::string(op) + "'");
+}
+
+void throwModuloByZero() {
+    throw std::runtime_error("Modulo by zero");
+}
+
+bool compareMixed(CompareOp op, const Value& left, const Value& right) {
+    bool leftNumber = left.isInt() || left.isDouble();
+    bool rightNumber = right.isInt() || right.isDouble();
+    if (leftNumber && rightNumber) {
+        return compareSame(op, left.toDouble(), right.toDouble());
+    }
+    if (left.isBool() && right.isBool()) {
+        return compareSame(op, left.asBool(), right.asBool());
+    }
+    if (left.isString() && right.isString()) {
+        return compareSame(op, left.asString(), right.asString());
+    }
+    
+    if (op == CompareOp::EQ) return left.toString() == right.toString();
+    if (op == CompareOp::NE) return left.toString() != right.toString();
+    return compareSame(op, left.toDouble(), right.toDouble());
+}
+
+uint32_t ConstantPool::add(const Value& value) {
+    // Keyed on type and exact contents, so 1, 1.0 and "1" stay distinct
+    std::string key(1, static_cast<char>('0' + static_cast<int>(value.type())));
+    if (value.isDouble()) {
+        double number = value.asDouble();
+        key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    } else {
+        key += value.toString();
+    }
+    
+    auto it = indices.find(key);
+    if (it != indices.end()) {
+        return it->second;
+    }
+    
+    uint32_t index = static_cast<uint32_t>(values.size());
+    values.push_back(value);
+    indices.emplace(std::move(key), index);
+    return index;
+}
+
+void ConstantPool::clear() {
+    values.clear();
+    indices.clear();
+}
@@ -0,0 +1,169 @@
+#include "VirtualMachine.hpp"
+#include <algorithm>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EMOJILANG_COMPUTED_GOTO 1
+#endif
+
+namespace {
+
+// Integer operands stay integers, anything else is promoted to double;
+// this mirrors the tree-walking interpreter.
+template <typename IntOp, typename DoubleOp>
+inline void arithmetic(Value& result, const Value& left, const Value& right, IntOp intOp, DoubleOp doubleOp) {
+    if (left.isInt() && right.isInt()) {
+        result.setInt(intOp(left.asInt(), right.asInt()));
+    } else {
+        result.setDouble(doubleOp(left.toDouble(), right.toDouble()));
+    }
+}
+
+inline void compare(Value& result, CompareOp op, const Value& left, const Value& right) {
+    result.setBool(compareValues(op, left, right));
+}
+
+} // namespace
+
+VirtualMachine::VirtualMachine(std::ostream& output) : output(output) {}
+
+void VirtualMachine::run(const BytecodeProgram& program) {
+    registers.assign(program.registerCount, Value{});
+    std::copy(program.constants.begin(), program.constants.end(), registers.begin());
+    
+    Value* R = registers.data();
+    const Instruction* code = program.code.data();
+    const Instruction* ip = code;
+    
+#ifdef EMOJILANG_COMPUTED_GOTO
+    // Must follow the declaration order of OpCode
+    static const void* const dispatchTable[] = {
+        &&op_MOVE, &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_MOD,
+        &&op_EQ, &&op_NE, &&op_LT, &&op_LE, &&op_GT, &&op_GE,
+        &&op_BAND, &&op_BOR, &&op_BXOR, &&op_AND, &&op_OR, &&op_NOT, &&op_BNOT,
+        &&op_JUMP, &&op_JUMP_IF_FALSE, &&op_PRINT, &&op_HALT
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(OpCode::HALT) + 1,
+                  "dispatch table out of sync with OpCode");
+#define DISPATCH() goto *dispatchTable[static_cast<size_t>(ip->op)]
+#define TARGET(name) op_##name
+#else
+#define DISPATCH() goto dispatch
+#define TARGET(name) case OpCode::name
+#endif
+#define NEXT() do { ++ip; DISPATCH(); } while (0)
+    
+    DISPATCH();
+#ifndef EMOJILANG_COMPUTED_GOTO
+dispatch:
+    switch (ip->op) {
+#endif
+    TARGET(MOVE): {
+        R[ip->a] = R[ip->b];
+        NEXT();
+    }
+    TARGET(ADD): {
+        arithmetic(R[ip->a], R[ip->b], R[ip->c],
+                   [](int l, int r) { return addInt(l, r); }, [](double l, double r) { return l + r; });
+        NEXT();
+    }
+    TARGET(SUB): {
+        arithmetic(R[ip->a], R[ip->b], R[ip->c],
+                   [](int l, int r) { return subtractInt(l, r); }, [](double l, double r) { return l - r; });
+        NEXT();
+    }
+    TARGET(MUL): {
+        arithmetic(R[ip->a], R[ip->b], R[ip->c],
+                   [](int l, int r) { return multiplyInt(l, r); }, [](double l, double r) { return l * r; });
+        NEXT();
+    }
+    TARGET(DIV): {
+        R[ip->a].setDouble(R[ip->b].toDouble() / R[ip->c].toDouble());
+        NEXT();
+    }
+    TARGET(MOD): {
+        R[ip->a].setInt(moduloInt(R[ip->b].toInt(), R[ip->c].toInt()));
+        NEXT();
+    }
+    TARGET(EQ): {
+        compare(R[ip->a], CompareOp::EQ, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(NE): {
+        compare(R[ip->a], CompareOp::NE, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(LT): {
+        compare(R[ip->a], CompareOp::LT, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(LE): {
+        compare(R[ip->a], CompareOp::LE, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(GT): {
+        compare(R[ip->a], CompareOp::GT, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(GE): {
+        compare(R[ip->a], CompareOp::GE, R[ip->b], R[ip->c]);
+        NEXT();
+    }
+    TARGET(BAND): {
+        R[ip->a].setInt(R[ip->b].toInt() & R[ip->c].toInt());
+        NEXT();
+    }
+    TARGET(BOR): {
+        R[ip->a].setInt(R[ip->b].toInt() | R[ip->c].toInt());
+        NEXT();
+    }
+    TARGET(BXOR): {
+        R[ip->a].setInt(R[ip->b].toInt() ^ R[ip->c].toInt());
+        NEXT();
+    }
+    TARGET(AND): {
+        bool left = R[ip->b].toBool();
+        bool right = R[ip->c].toBool();
+        R[ip->a].setBool(left && right);
+        NEXT();
+    }
+    TARGET(OR): {
+        bool left = R[ip->b].toBool();
+        bool right = R[ip->c].toBool();
+        R[ip->a].setBool(left || right);
+        NEXT();
+    }
+    TARGET(NOT): {
+        R[ip->a].setBool(!R[ip->b].toBool());
+        NEXT();
+    }
+    TARGET(BNOT): {
+        R[ip->a].setInt(~R[ip->b].toInt());
+        NEXT();
+    }
+    TARGET(JUMP): {
+        ip = code + ip->b;
+        DISPATCH();
+    }
+    TARGET(JUMP_IF_FALSE): {
+        if (!R[ip->a].toBool()) {
+            ip = code + ip->b;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    TARGET(PRINT): {
+        output << R[ip->a].toString() << '\n';
+        NEXT();
+    }
+    TARGET(HALT): {
+        output.flush();
+        return;
+    }
+#ifndef EMOJILANG_COMPUTED_GOTO
+    }
+#endif
+    
+#undef NEXT
+#undef TARGET
+#undef DISPATCH
+}
@@ -1,29 +1,142 @@
 #include <iostream>
-#include <fstream>
 #include <filesystem>
+#include <sstream>
+#include <fstream>
 #include <vector>
 #include <string>
+#include <stdexcept>
+#include <thread>
 
-#include "Parser.hpp"
-#include "EmojiTransformer.hpp"
-#include "EmojiInterpreter.hpp"
+#include "SourceBuffer.hpp"
+#include "BytecodeCompiler.hpp"
+#include "VirtualMachine.hpp"
+#include "IrBuilder.hpp"
+#include "IrOptimizer.hpp"
+#include "IrLowering.hpp"
+#include "CppEmitter.hpp"
+#include "ClosureCompiler.hpp"
+#include "BatchRunner.hpp"
+#include "EmojiProgram.hpp"
 
 int main(int argc, char* argv[]) {
     try {
-        Parser parser;
-        
         std::cout << "STATUS: Parser Generated Successfully" << std::endl;
         std::cout << "-----------------------------------------------------------------------------" << std::endl;
         
         std::vector<std::string> testFileNames;
         bool isTest = true;
+        bool streamMode = false;
+        bool dumpBytecode = false;
+        bool dumpIr = false;
+        bool reduceModulo = false;
+        bool checkJit = false;
+        CompileOptions compileOptions;
+        RunOptions runOptions;
+        runOptions.reportParallel = true;
+        std::string engine = "tree";
+        std::string emitCppPath;
+        size_t jobs = 0;
         
-        if (argc > 1) {
-            for (int i = 1; i < argc; i++) {
-                testFileNames.push_back(argv[i]);
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--stream") {
+                streamMode = true;
+            } else if (arg.rfind("--engine=", 0) == 0) {
+                engine = arg.substr(9);
+                if (engine != "tree" && engine != "vm" && engine != "ssa" && engine != "closure") {
+                    std::cerr << "Unknown engine " << engine << " (expected tree, vm, ssa or closure)" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--dump-bytecode") {
+                dumpBytecode = true;
+            } else if (arg == "--dump-ir") {
+                dumpIr = true;
+            } else if (arg == "--reduce-modulo") {
+                reduceModulo = true;
+            } else if (arg == "--emit-cpp") {
+                if (i + 1 >= argc) {
+                    std::cerr << "--emit-cpp needs an output file" << std::endl;
+                    return 1;
+                }
+                emitCppPath = argv[++i];
+            } else if (arg == "--no-optimize") {
+                compileOptions.optimize = false;
+            } else if (arg == "--no-jit") {
+                runOptions.jit = false;
+            } else if (arg.rfind("--jit-threshold=", 0) == 0) {
+                runOptions.jitThreshold = static_cast<uint32_t>(std::stoul(arg.substr(16)));
+            } else if (arg == "--trace-tiering") {
+                runOptions.traceTiering = true;
+            } else if (arg == "--no-specialize") {
+                runOptions.specialize = false;
+            } else if (arg == "--no-counted-loops") {
+                runOptions.countedLoops = false;
+            } else if (arg == "--check-jit") {
+                checkJit = true;
+            } else if (arg == "--parallel-loops" || arg.rfind("--parallel-loops=", 0) == 0) {
+                runOptions.parallelThreads = arg == "--parallel-loops" ? std::thread::hardware_concurrency()
+                                                                       : std::stoul(arg.substr(17));
+                if (runOptions.parallelThreads == 0) {
+                    runOptions.parallelThreads = 1;
+                }
+            } else if (arg.rfind("--task-threads=", 0) == 0) {
+                runOptions.taskThreads = std::stoul(arg.substr(15));
+                if (runOptions.taskThreads == 0) {
+                    std::cerr << "--task-threads needs at least one thread" << std::endl;
+                    return 1;
+                }
+            } else if (arg.rfind("--cache-dir=", 0) == 0) {
+                compileOptions.cacheDirectory = arg.substr(12);
+                if (compileOptions.cacheDirectory.empty()) {
+                    std::cerr << "--cache-dir needs a directory" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--jobs" || arg.rfind("--jobs=", 0) == 0) {
+                std::string count;
+                if (arg == "--jobs") {
+                    if (i + 1 >= argc) {
+                        std::cerr << "--jobs needs a thread count" << std::endl;
+                        return 1;
+                    }
+                    count = argv[++i];
+                } else {
+                    count = arg.substr(7);
+                }
+                jobs = std::stoul(count);
+                if (jobs == 0) {
+                    std::cerr << "--jobs needs at least one thread" << std::endl;
+                    return 1;
+                }
+            } else if (arg.rfind("--", 0) == 0) {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return 1;
+            } else {
+                testFileNames.push_back(arg);
+                isTest = false;
             }
-            isTest = false;
-        } else {
+        }
+        
+        if (streamMode && engine != "tree") {
+            std::cerr << "--stream is only supported by the tree engine" << std::endl;
+            return 1;
+        }
+        
+        if (jobs > 0 && streamMode) {
+            std::cerr << "--jobs cannot be combined with --stream" << std::endl;
+            return 1;
+        }
+        
+        if (!compileOptions.cacheDirectory.empty() && streamMode) {
+            std::cerr << "--cache-dir cannot be combined with --stream" << std::endl;
+            return 1;
+        }
+        
+        if (!emitCppPath.empty() && (streamMode || testFileNames.size() != 1)) {
+            std::cerr << "--emit-cpp translates exactly one file and cannot be streamed" << std::endl;
+            return 1;
+        }
+        
+        if (isTest) {
             // Load test files from tests directory
             std::filesystem::path testsDir("tests");
             if (std::filesystem::exists(testsDir) && std::filesystem::is_directory(testsDir)) {
@@ -35,59 +148,140 @@ int main(int argc, char* argv[]) {
             }
         }
         
-        for (const std::string& fileName : testFileNames) {
-            std::string text;
-            std::string fullPath;
+        const std::string separator = "-----------------------------------------------------------------------------";
+        
+        // Compiles one file through EmojiProgram and runs it on the selected
+        // engine. Program output and STATUS lines go to `out`, errors to `err`.
+        auto runFile = [&](const std::string& fileName, std::ostream& out, std::ostream& err) {
+            if (fileName.size() < 4 || fileName.substr(fileName.size() - 4) != ".emo") {
+                out << "Please give a valid file to execute... that ends with .emo" << std::endl;
+                return false;
+            }
+            std::string fullPath = isTest ? "tests/" + fileName : fileName;
             
+            SourceBuffer source;
             try {
-                if (fileName.size() >= 4 && fileName.substr(fileName.size() - 4) == ".emo") {
-                    if (isTest) {
-                        fullPath = "tests/" + fileName;
-                    } else {
-                        fullPath = fileName;
-                    }
-                    
-                    std::ifstream file(fullPath);
-                    if (!file.is_open()) {
-                        std::cerr << "STATUS: error in reading the file " << fullPath << std::endl;
-                        continue;
-                    }
-                    
-                    std::string line;
-                    while (std::getline(file, line)) {
-                        text += line + "\n";
-                    }
-                    file.close();
-                } else {
-                    std::cout << "Please give a valid file to execute... that ends with .emo" << std::endl;
-                    continue;
-                }
+                source = SourceBuffer::fromFile(fullPath);
             } catch (const std::exception& e) {
-                std::cerr << "STATUS: error in reading the file " << fullPath << std::endl;
-                continue;
+                err << "STATUS: error in reading the file " << fullPath << std::endl;
+                return false;
             }
             
-            text += "\n";
-            
             try {
-                TreePtr tree = parser.parse(text);
-                std::cout << "STATUS: " << fileName << " Parsed Successfully" << std::endl;
+                EmojiProgram program = EmojiProgram::compile(source.text(), compileOptions);
+                const Tree& tree = program.syntaxTree();
+                out << "STATUS: " << fileName << " Parsed Successfully" << std::endl;
                 
-                // Transform emojis to plain text
-                EmojiTransformer transformer;
-                transformer.visit(tree);
+                // Translate the program to C++ instead of running it
+                if (!emitCppPath.empty()) {
+                    std::ofstream output(emitCppPath, std::ios::binary);
+                    if (!output.is_open()) {
+                        throw std::runtime_error("cannot write " + emitCppPath);
+                    }
+                    output << CppEmitter().emit(tree, fileName);
+                    out << "STATUS: " << fileName << " translated to " << emitCppPath << std::endl;
+                    out << separator << std::endl;
+                    return true;
+                }
                 
                 // Execute the program
-                EmojiInterpreter interpreter(tree);
-                interpreter.start();
+                if (engine == "vm") {
+                    BytecodeProgram program = BytecodeCompiler().compile(tree);
+                    if (dumpBytecode) {
+                        out << program.disassemble();
+                    }
+                    VirtualMachine vm(out);
+                    vm.run(program);
+                } else if (engine == "ssa") {
+                    IrFunction function = IrBuilder().build(tree);
+                    function.verify();
+                    if (compileOptions.optimize) {
+                        IrOptimizer(reduceModulo).optimize(function);
+                        function.verify();
+                    }
+                    if (dumpIr) {
+                        out << function.dump();
+                    }
+                    BytecodeProgram program = IrLowering().lower(function);
+                    if (dumpBytecode) {
+                        out << program.disassemble();
+                    }
+                    VirtualMachine vm(out);
+                    vm.run(program);
+                } else if (engine == "closure") {
+                    ClosureCompiler().compile(tree).run(out);
+                } else if (checkJit) {
+                    // Differential check: the same program with and without the
+                    // JIT, including the error a failing run stops with
+                    auto capture = [&](bool enableJit) {
+                        std::ostringstream output;
+                        RunOptions options = runOptions;
+                        options.jit = enableJit;
+                        try {
+                            program.run(output, options);
+                        } catch (const std::exception& e) {
+                            output << "ERROR: " << e.what() << std::endl;
+                        }
+                        return output.str();
+                    };
+                    std::string expected = capture(false);
+                    std::string actual = capture(true);
+                    out << actual;
+                    if (actual != expected) {
+                        throw std::runtime_error("JIT output differs from the interpreter");
+                    }
+                    out << "STATUS: " << fileName << " JIT output matches the interpreter" << std::endl;
+                } else {
+                    program.run(out, runOptions);
+                }
                 
-                std::cout << "STATUS: " << fileName << " ran without any interrupt" << std::endl;
-                std::cout << "-----------------------------------------------------------------------------" << std::endl;
+                out << "STATUS: " << fileName << " ran without any interrupt" << std::endl;
+                out << separator << std::endl;
+                return true;
                 
             } catch (const std::exception& e) {
-                std::cerr << "ERROR in " << fileName << ": " << e.what() << std::endl;
-                std::cout << "-----------------------------------------------------------------------------" << std::endl;
+                err << "ERROR in " << fileName << ": " << e.what() << std::endl;
+                out << separator << std::endl;
+                return false;
             }
+        };
+        
+        if (jobs > 0) {
+            // Every file is compiled and run on its own on the pool
+            size_t failed = BatchRunner(jobs).run(testFileNames, runFile, std::cout, std::cerr);
+            return failed == 0 ? 0 : 1;
+        }
+        
+        bool failed = false;
+        for (const std::string& fileName : testFileNames) {
+            if (streamMode && fileName.size() >= 4 && fileName.substr(fileName.size() - 4) == ".emo") {
+                // Execute each top-level statement as soon as it has been parsed
+                std::string fullPath = isTest ? "tests/" + fileName : fileName;
+                std::ifstream file(fullPath, std::ios::binary);
+                if (!file.is_open()) {
+                    std::cerr << "STATUS: error in reading the file " << fullPath << std::endl;
+                    failed = true;
+                    continue;
+                }
+                
+                try {
+                    EmojiProgram::runStream(file, std::cout, compileOptions, runOptions);
+                    std::cout << "STATUS: " << fileName << " Parsed Successfully" << std::endl;
+                    std::cout << "STATUS: " << fileName << " ran without any interrupt" << std::endl;
+                } catch (const std::exception& e) {
+                    std::cerr << "ERROR in " << fileName << ": " << e.what() << std::endl;
+                    failed = true;
+                }
+                std::cout << separator << std::endl;
+                continue;
+            }
+            
+            if (!runFile(fileName, std::cout, std::cerr)) {
+                failed = true;
+            }
+        }
+        if (failed) {
+            return 1;
         }
         
     } catch (const std::exception& e) {
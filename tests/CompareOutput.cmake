@@ -0,0 +1,51 @@
+# Runs one program for ctest and compares what it prints with the files next
+# to it: standard output with <name>.out, and standard error with the regular
+# expression in <name>.err (standard error must be empty without one).
+#
+#   cmake -DEMOJILANG=<interpreter> -DPROGRAM=<name>.emo [-DARGS="<options>"]
+#         [-DCXX=<compiler> -DWORK_DIR=<dir>] -P CompareOutput.cmake
+#
+# With CXX the program is translated with --emit-cpp, compiled and run
+# instead, and the STATUS lines of <name>.out are not compared. A run that
+# dies on a signal fails whatever it printed.
+
+get_filename_component(directory "${PROGRAM}" DIRECTORY)
+get_filename_component(name "${PROGRAM}" NAME_WE)
+file(READ "${directory}/${name}.out" expected)
+set(expectedError "")
+if(EXISTS "${directory}/${name}.err")
+    file(STRINGS "${directory}/${name}.err" expectedError LIMIT_COUNT 1)
+endif()
+
+if(CXX)
+    set(source "${WORK_DIR}/${name}.cpp")
+    set(binary "${WORK_DIR}/${name}")
+    execute_process(COMMAND "${EMOJILANG}" --emit-cpp "${source}" "${PROGRAM}"
+                    RESULT_VARIABLE result OUTPUT_QUIET)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "--emit-cpp failed on ${PROGRAM}: ${result}")
+    endif()
+    execute_process(COMMAND "${CXX}" -std=c++17 -O1 "${source}" -o "${binary}" RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "emitted C++ for ${PROGRAM} does not compile")
+    endif()
+    set(command "${binary}")
+    string(REGEX REPLACE "(STATUS: |-----)[^\n]*\n" "" expected "${expected}")
+else()
+    separate_arguments(options UNIX_COMMAND "${ARGS}")
+    set(command "${EMOJILANG}" ${options} "${PROGRAM}")
+endif()
+
+execute_process(COMMAND ${command} OUTPUT_VARIABLE output ERROR_VARIABLE error RESULT_VARIABLE result)
+if(NOT result MATCHES "^[0-9]+$")
+    message(FATAL_ERROR "${PROGRAM} did not exit normally: ${result}")
+endif()
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "${PROGRAM} printed\n${output}\ninstead of\n${expected}")
+endif()
+if(expectedError STREQUAL "" AND NOT error STREQUAL "")
+    message(FATAL_ERROR "${PROGRAM} reported\n${error}")
+endif()
+if(NOT error MATCHES "${expectedError}")
+    message(FATAL_ERROR "${PROGRAM} reported\n${error}\ninstead of an error matching '${expectedError}'")
+endif()